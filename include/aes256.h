@@ -4,16 +4,134 @@
 #ifndef _AES256_H
 #define _AES256_H
 
+#include <stddef.h>
 #include <stdint.h>
 
-#define AES256_KEY_SIZE     32
+#define AES256_KEY_SIZE         32
+#define AES256_BLOCK_SIZE       16
+
+/* Number of blocks processed by a single pass of the bit-sliced engine */
+#define AES256_PARALLEL_BLOCKS  4
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Bit-sliced implementation of AES256 encryption engine.
+ * @brief The expanded AES256 key schedule.
+ * 
+ * @note The key schedule is computed once by aes256_init() and
+ * can then be used to process any number of blocks under the
+ * same key. It contains key material and shall be wiped with
+ * crypto_memzero() once it is no longer needed.
+ *
+ * The backend is selected by aes256_init() from the CPU features.
+ * The portable backend stores the 15 round keys in bit-sliced form,
+ * each one replicated over the four block lanes of the engine. The
+ * AES-NI and the SSSE3 vector-permute backends store the 15
+ * encryption round keys followed by the 15 decryption round keys.
+ */
+typedef struct
+{
+    union
+    {
+        uint64_t sk[120];
+        uint64_t rk[60];
+    } keys;
+    uint32_t backend;
+} aes256_key_schedule;
+
+/**
+ * @brief Expands an AES256 key into its key schedule.
+ * 
+ * @param ctx The output key schedule
+ * @param key The encryption key, 32 bytes
+ */
+void aes256_init(aes256_key_schedule *ctx, const uint8_t *key);
+
+/**
+ * @brief Encrypts a single block with an expanded key schedule.
+ * 
+ * @param ctx The key schedule initialised by aes256_init()
+ * @param out The output ciphertext block, 16 bytes
+ * @param in The input plaintext block, 16 bytes
+ */
+void aes256_encrypt_block(const aes256_key_schedule *ctx,
+                          uint8_t *out,
+                          const uint8_t *in);
+
+/**
+ * @brief Decrypts a single block with an expanded key schedule.
+ * 
+ * @param ctx The key schedule initialised by aes256_init()
+ * @param out The output plaintext block, 16 bytes
+ * @param in The input ciphertext block, 16 bytes
+ */
+void aes256_decrypt_block(const aes256_key_schedule *ctx,
+                          uint8_t *out,
+                          const uint8_t *in);
+
+/**
+ * @brief Encrypts consecutive blocks with an expanded key schedule.
+ *
+ * The blocks are processed AES256_PARALLEL_BLOCKS at a time, callers
+ * should therefore batch as many blocks as possible in one call.
+ * It is acceptable for out and in to be the same buffer.
+ *
+ * @param ctx The key schedule initialised by aes256_init()
+ * @param out The output ciphertext, num_blocks * 16 bytes
+ * @param in The input plaintext, num_blocks * 16 bytes
+ * @param num_blocks The number of blocks
+ */
+void aes256_encrypt_blocks(const aes256_key_schedule *ctx,
+                           uint8_t *out,
+                           const uint8_t *in,
+                           size_t num_blocks);
+
+/**
+ * @brief Decrypts consecutive blocks with an expanded key schedule.
+ *
+ * It is acceptable for out and in to be the same buffer.
+ *
+ * @param ctx The key schedule initialised by aes256_init()
+ * @param out The output plaintext, num_blocks * 16 bytes
+ * @param in The input ciphertext, num_blocks * 16 bytes
+ * @param num_blocks The number of blocks
+ */
+void aes256_decrypt_blocks(const aes256_key_schedule *ctx,
+                           uint8_t *out,
+                           const uint8_t *in,
+                           size_t num_blocks);
+
+/**
+ * @brief Encrypts a few blocks under each of several keys.
+ *
+ * The bit-sliced engine processes the keys AES256_PARALLEL_BLOCKS at
+ * a time, one key per block lane, and expands their key schedules
+ * side by side. This is much faster than aes256_init() followed by
+ * aes256_encrypt_blocks() for each key when every key only encrypts
+ * a couple of blocks. With the AES-NI and the vector-permute backends,
+ * whose key expansion is cheap, the keys are processed one by one.
+ * It is acceptable for out and in to be the same buffer.
+ *
+ * @param out The output ciphertext, num_keys * num_blocks * 16 bytes,
+ *            the blocks of key n starting at n * num_blocks * 16
+ * @param in The input plaintext, in the same layout as out
+ * @param keys The encryption keys, num_keys * 32 bytes
+ * @param num_keys The number of keys
+ * @param num_blocks The number of blocks per key
+ */
+void aes256_encrypt_multi_key(uint8_t *out,
+                              const uint8_t *in,
+                              const uint8_t *keys,
+                              size_t num_keys,
+                              size_t num_blocks);
+
+/**
+ * @brief AES256 encryption of a single block with a one-off key schedule.
+ *
+ * @note Despite the name, the block goes through the backend
+ * aes256_init() selects, AES-NI, vector-permute or bit-sliced.
  * 
  * @param out The output ciphertext block, 16 bytes
  * @param in The input plaintext block, 16 bytes
@@ -24,7 +142,10 @@ void aes256_bitslice_encrypt(uint8_t *out,
                              const uint8_t *key);
 
 /**
- * @brief Bit-sliced implementation of AES256 decryption engine.
+ * @brief AES256 decryption of a single block with a one-off key schedule.
+ *
+ * @note Despite the name, the block goes through the backend
+ * aes256_init() selects, AES-NI, vector-permute or bit-sliced.
  * 
  * @param out The output plaintext block, 16 bytes
  * @param in The input ciphertext block, 16 bytes
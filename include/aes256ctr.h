@@ -6,14 +6,86 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "aes256.h"
 
 #define AES256CTR_KEY_SIZE      32
 #define AES256CTR_IV_SIZE       16
 
+/* Number of counter blocks handed to the AES engine per call */
+#define AES256CTR_BATCH_BLOCKS  (2 * AES256_PARALLEL_BLOCKS)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief The state of an incremental AES-256 CTR computation.
+ *
+ * @note The 128-bit big-endian counter block is kept as two 64-bit
+ * words, iv_hi:iv_lo being the initial counter and block the index of
+ * the next keystream block. The keystream is generated
+ * AES256CTR_BATCH_BLOCKS blocks at a time and the unused part of a
+ * batch is kept in stream for the next call.
+ */
+typedef struct
+{
+    aes256_key_schedule key;
+    uint64_t iv_hi;
+    uint64_t iv_lo;
+    uint64_t block;
+    uint8_t stream[AES256CTR_BATCH_BLOCKS * AES256_BLOCK_SIZE];
+    size_t stream_pos;
+    size_t stream_len;
+} aes256ctr_ctx;
+
+/**
+ * @brief Initialises an AES-256 CTR context at the start of the
+ * keystream.
+ *
+ * @param ctx The context
+ * @param key The encryption key, 32 bytes
+ * @param iv The initialisation vector, i.e. the first counter block,
+ *           16 bytes
+ */
+void aes256ctr_init(aes256ctr_ctx *ctx,
+                    const uint8_t *key,
+                    const uint8_t *iv);
+
+/**
+ * @brief Moves to the start of a keystream block.
+ *
+ * The keystream block at block_offset is generated from the counter
+ * block iv + block_offset, modulo 2^128, so that a message may be
+ * split in block-aligned parts which are processed independently,
+ * e.g. by different threads, or resumed.
+ *
+ * @param ctx The context initialised by aes256ctr_init()
+ * @param block_offset The index of the keystream block
+ */
+void aes256ctr_seek(aes256ctr_ctx *ctx, uint64_t block_offset);
+
+/**
+ * @brief Encrypts or decrypts the next part of the message.
+ *
+ * @note It is acceptable for out and in to be the same buffer.
+ *
+ * @param ctx The context initialised by aes256ctr_init()
+ * @param out The pointer to the output, len bytes
+ * @param in The pointer to the input, len bytes
+ * @param len The size of the input in bytes
+ */
+void aes256ctr_update(aes256ctr_ctx *ctx,
+                      uint8_t *out,
+                      const uint8_t *in,
+                      size_t len);
+
+/**
+ * @brief Wipes an AES-256 CTR context.
+ *
+ * @param ctx The context
+ */
+void aes256ctr_final(aes256ctr_ctx *ctx);
+
 /**
  * @brief AES-256 CTR encrypt method.
  * 
@@ -32,6 +104,31 @@ int32_t aes256ctr_encrypt(uint8_t *c,
                           const uint8_t *iv,
                           const uint8_t *key);
 
+/**
+ * @brief AES-256 CTR encrypt method for several short messages, each
+ * under its own key and IV.
+ *
+ * The keys are processed AES256_PARALLEL_BLOCKS at a time by
+ * aes256_encrypt_multi_key(), which shares the cost of the key
+ * expansion between them. It is meant for messages of a few blocks,
+ * e.g. the wrapping of a secret for many recipients. It is acceptable
+ * for c and msg to be the same buffer.
+ *
+ * @param c The pointer to the output ciphertexts, num_keys * msg_len
+ *          bytes, the ciphertext of message n starting at n * msg_len
+ * @param msg The pointer to the input plaintexts, in the same layout
+ * @param msg_len The size of each plaintext message in bytes
+ * @param ivs The initialisation vectors, num_keys * 16 bytes
+ * @param keys The encryption keys, num_keys * 32 bytes
+ * @param num_keys The number of messages and keys
+ */
+void aes256ctr_encrypt_multi_key(uint8_t *c,
+                                 const uint8_t *msg,
+                                 size_t msg_len,
+                                 const uint8_t *ivs,
+                                 const uint8_t *keys,
+                                 size_t num_keys);
+
 /**
  * @brief AES-256 CTR decrypt method.
  * 
@@ -6,20 +6,138 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include "aes256.h"
+#include "ghash.h"
 
 #define AES256GCM_KEY_SIZE      32
 #define AES256GCM_NONCE_SIZE    12
 #define AES256GCM_TAG_SIZE      16
 
+/* Number of counter blocks handed to the AES engine per call */
+#define AES256GCM_BATCH_BLOCKS  (2 * AES256_PARALLEL_BLOCKS)
+
+/* Maximum number of threads used by the parallel methods */
+#define AES256GCM_MAX_THREADS   16
+
+/* Minimum message size per thread of the parallel methods, shorter
+ * messages are processed with fewer threads */
+#define AES256GCM_MIN_THREAD_BYTES  32768
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief The state of an incremental AES-256 GCM computation.
+ *
+ * @note The context is set up by aes256gcm_init(), fed with the AAD
+ * and then with the message, in any number of calls of any size,
+ * and wiped by aes256gcm_encrypt_final() or aes256gcm_decrypt_verify().
+ * All AAD must be supplied before the first message byte.
+ */
+typedef struct
+{
+    aes256_key_schedule key;
+    ghash_key ghash;
+    uint8_t J[16];
+    uint8_t tag_mask[16];
+    uint8_t accum[16];
+    uint8_t hash_buffer[16];
+    uint8_t stream[AES256GCM_BATCH_BLOCKS * AES256_BLOCK_SIZE];
+    size_t hash_buffer_len;
+    size_t stream_pos;
+    size_t stream_len;
+    uint64_t aad_len;
+    uint64_t msg_len;
+    uint32_t counter;
+    uint32_t phase;
+} aes256gcm_ctx;
+
+/**
+ * @brief Initialises an incremental AES-256 GCM computation.
+ *
+ * @param ctx The context to be initialised
+ * @param key The pointer to the encryption key, 32 bytes
+ * @param nonce The pointer to the nonce, 12 bytes
+ */
+void aes256gcm_init(aes256gcm_ctx *ctx,
+                    const uint8_t *key,
+                    const uint8_t *nonce);
+
+/**
+ * @brief Authenticates additional data.
+ *
+ * @param ctx The context initialised by aes256gcm_init()
+ * @param aad The pointer to the AAD
+ * @param aad_len The size of the AAD in bytes
+ * @return 0 on success, -1 if message data was already processed
+ */
+int32_t aes256gcm_update_aad(aes256gcm_ctx *ctx,
+                             const uint8_t *aad,
+                             size_t aad_len);
+
+/**
+ * @brief Encrypts the next part of the message.
+ *
+ * @note It is acceptable for c and msg to be the same buffer.
+ *
+ * @param ctx The context initialised by aes256gcm_init()
+ * @param c The pointer to the output ciphertext, msg_len bytes
+ * @param msg The pointer to the input plaintext
+ * @param msg_len The size of the plaintext in bytes
+ * @return 0 on success, -1 if the GCM message size limit is exceeded
+ */
+int32_t aes256gcm_encrypt_update(aes256gcm_ctx *ctx,
+                                 uint8_t *c,
+                                 const uint8_t *msg,
+                                 size_t msg_len);
+
+/**
+ * @brief Completes the encryption and outputs the tag.
+ *
+ * @note The context is wiped.
+ *
+ * @param ctx The context
+ * @param tag The pointer to the output tag, 16 bytes
+ */
+void aes256gcm_encrypt_final(aes256gcm_ctx *ctx, uint8_t *tag);
+
+/**
+ * @brief Decrypts the next part of the message.
+ *
+ * @note The plaintext is released before the tag is verified, it
+ * must not be used until aes256gcm_decrypt_verify() succeeds.
+ * It is acceptable for msg and c to be the same buffer.
+ *
+ * @param ctx The context initialised by aes256gcm_init()
+ * @param msg The pointer to the output plaintext, c_len bytes
+ * @param c The pointer to the input ciphertext, without the tag
+ * @param c_len The size of the ciphertext in bytes
+ * @return 0 on success, -1 if the GCM message size limit is exceeded
+ */
+int32_t aes256gcm_decrypt_update(aes256gcm_ctx *ctx,
+                                 uint8_t *msg,
+                                 const uint8_t *c,
+                                 size_t c_len);
+
+/**
+ * @brief Completes the decryption and verifies the tag.
+ *
+ * @note The context is wiped.
+ *
+ * @param ctx The context
+ * @param tag The pointer to the expected tag, 16 bytes
+ * @return 0 if the tag is valid, -1 otherwise
+ */
+int32_t aes256gcm_decrypt_verify(aes256gcm_ctx *ctx, const uint8_t *tag);
+
 /**
  * @brief AES-256 GCM with 16-byte tag encrypt method.
  * 
  * @param c The pointer to the output ciphertext
- * @param c_len The pointer to the ciphertext size in bytes
+ * @param c_len The pointer to the ciphertext size in bytes, set to 0
+ *              on failure
  * @param msg The pointer to the input plaintext message
  * @param msg_len The size of the plaintext message in bytes
  * @param aad The pointer to the AAD
@@ -59,6 +177,101 @@ int32_t aes256gcm_decrypt(uint8_t *msg,
                           const uint8_t *nonce,
                           const uint8_t *key);
 
+/**
+ * @brief AES-256 GCM with 16-byte tag single-pass decrypt method.
+ *
+ * Unlike aes256gcm_decrypt(), which authenticates the ciphertext
+ * before decrypting it in a second pass, GHASH and the decryption
+ * are interleaved in a single pass over the ciphertext. The output
+ * buffer is therefore written before the tag is verified, and is
+ * wiped if the verification fails.
+ *
+ * @param msg The pointer to the output plaintext message
+ * @param msg_len The pointer to the plaintext size in bytes
+ * @param c The pointer to the input ciphertext
+ * @param c_len The size of ciphertext in bytes
+ * @param aad The pointer to the AAD
+ * @param aad_len The size of the AAD in bytes
+ * @param nonce The pointer to the nonce, 12 bytes
+ * @param key The pointer to the encryption key, 32 bytes
+ * @return 0 on success, non-zero otherwise
+ */
+int32_t aes256gcm_decrypt_single_pass(uint8_t *msg,
+                                      size_t *msg_len,
+                                      const uint8_t *c,
+                                      size_t c_len,
+                                      const uint8_t *aad,
+                                      size_t aad_len,
+                                      const uint8_t *nonce,
+                                      const uint8_t *key);
+
+/**
+ * @brief AES-256 GCM with 16-byte tag multi-threaded encrypt method.
+ *
+ * The message is split into num_threads ranges of whole blocks which
+ * are encrypted and hashed concurrently, each with its own counter
+ * range, and the partial GHASH values are combined with powers of H.
+ * The output is identical to the output of aes256gcm_encrypt().
+ *
+ * @param c The pointer to the output ciphertext
+ * @param c_len The pointer to the ciphertext size in bytes, set to 0
+ *              on failure
+ * @param msg The pointer to the input plaintext message
+ * @param msg_len The size of the plaintext message in bytes
+ * @param aad The pointer to the AAD
+ * @param aad_len The size of the AAD in bytes
+ * @param nonce The pointer to the nonce, 12 bytes
+ * @param key The pointer to the encryption key, 32 bytes
+ * @param num_threads The number of threads, including the calling
+ *                    thread, at most AES256GCM_MAX_THREADS are used
+ *                    and at most one per AES256GCM_MIN_THREAD_BYTES
+ * @return 0 on success, non-zero otherwise
+ */
+int32_t aes256gcm_encrypt_parallel(uint8_t *c,
+                                   size_t *c_len,
+                                   const uint8_t *msg,
+                                   size_t msg_len,
+                                   const uint8_t *aad,
+                                   size_t aad_len,
+                                   const uint8_t *nonce,
+                                   const uint8_t *key,
+                                   uint32_t num_threads);
+
+/**
+ * @brief AES-256 GCM with 16-byte tag multi-threaded decrypt method.
+ *
+ * The ciphertext is split as in aes256gcm_encrypt_parallel(). Unless
+ * single_pass is set, the ciphertext is authenticated before it is
+ * decrypted in a second parallel pass, as aes256gcm_decrypt() does.
+ * With single_pass, each range is hashed and decrypted in one pass
+ * and the output buffer is wiped if the verification fails, as
+ * aes256gcm_decrypt_single_pass() does.
+ *
+ * @param msg The pointer to the output plaintext message
+ * @param msg_len The pointer to the plaintext size in bytes
+ * @param c The pointer to the input ciphertext
+ * @param c_len The size of ciphertext in bytes
+ * @param aad The pointer to the AAD
+ * @param aad_len The size of the AAD in bytes
+ * @param nonce The pointer to the nonce, 12 bytes
+ * @param key The pointer to the encryption key, 32 bytes
+ * @param num_threads The number of threads, including the calling
+ *                    thread, at most AES256GCM_MAX_THREADS are used
+ *                    and at most one per AES256GCM_MIN_THREAD_BYTES
+ * @param single_pass Whether to decrypt in a single pass
+ * @return 0 on success, non-zero otherwise
+ */
+int32_t aes256gcm_decrypt_parallel(uint8_t *msg,
+                                   size_t *msg_len,
+                                   const uint8_t *c,
+                                   size_t c_len,
+                                   const uint8_t *aad,
+                                   size_t aad_len,
+                                   const uint8_t *nonce,
+                                   const uint8_t *key,
+                                   uint32_t num_threads,
+                                   bool single_pass);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,66 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#ifndef _CPU_FEATURES_H
+#define _CPU_FEATURES_H
+
+#include <stdint.h>
+
+#define CPU_FEATURE_SSSE3       0x00000001
+#define CPU_FEATURE_AESNI       0x00000002
+#define CPU_FEATURE_PCLMUL      0x00000004
+#define CPU_FEATURE_AVX2        0x00000008
+
+/**
+ * VGP_X86_INTRINSICS is defined when the compiler can emit x86 SIMD
+ * instructions on a per-function basis, VGP_TARGET(x) then enables
+ * the instruction set extensions x for a single function.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define VGP_X86_INTRINSICS      1
+#define VGP_TARGET(x)           __attribute__((target(x)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define VGP_X86_INTRINSICS      1
+#define VGP_TARGET(x)
+#else
+#define VGP_TARGET(x)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Returns the CPU features usable by the library.
+ *
+ * The features are detected once with CPUID, features which
+ * require operating system support (AVX2) are only reported
+ * if the OS saves the corresponding register state.
+ *
+ * @return bit-mask of CPU_FEATURE_* values
+ */
+uint32_t cpu_features(void);
+
+/**
+ * @brief Prevents the library from using some CPU features.
+ *
+ * Key schedules and contexts initialised before the call keep
+ * the backend they were initialised with.
+ *
+ * @param features bit-mask of CPU_FEATURE_* values to be disabled,
+ * 0 enables all the detected features again
+ */
+void cpu_features_disable(uint32_t features);
+
+/**
+ * @brief Returns the number of online logical processors.
+ *
+ * @return the number of processors, at least 1
+ */
+uint32_t cpu_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,7 +5,9 @@
 #define _CURVE25519_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "rand.h"
 
 #define CURVE25519_POINT_SIZE           32
 #define CURVE25519_SCALAR_SIZE          32
@@ -29,6 +31,24 @@ extern "C" {
  */
 bool curve25519_dh(uint8_t *q, const uint8_t *n, const uint8_t *p);
 
+/**
+ * @brief Performs up to four curve25519 Diffie-Hellman exchanges of
+ * one scalar with as many points, in parallel when AVX2 is available.
+ *
+ * @note q[j] = [n].p[j] for j < count
+ *
+ * @param q The count scalar multiplication outputs, 32 bytes each
+ * @param n The scalar value, 32 bytes
+ * @param p The count curve25519 points, 32 bytes each
+ * @param count The number of points, from 1 to 4
+ * @return true on success
+ * @return false on failure, e.g one of the points is invalid
+ */
+bool curve25519_dh_x4(uint8_t *const *q,
+                      const uint8_t *n,
+                      const uint8_t *const *p,
+                      size_t count);
+
 /**
  * @brief Creates a curve25519 public-key from a private-key.
  * 
@@ -49,6 +69,20 @@ bool curve25519_public_key_from_private_key(uint8_t *q, const uint8_t *n);
  */
 bool curve25519_random_keypair(uint8_t* public_key, uint8_t* private_key);
 
+/**
+ * @brief Creates a curve25519 random key-pair with a given random
+ * number generator provider.
+ * 
+ * @param public_key Output public-key array, 32 bytes
+ * @param private_key Output private-key array, 32 bytes
+ * @param rng The provider, or NULL to use bdap_randombytes
+ * @return true on success
+ * @return false on failure, e.g. invalid key-pair
+ */
+bool curve25519_random_keypair_ex(uint8_t* public_key,
+                                  uint8_t* private_key,
+                                  const bdap_rng* rng);
+
 #ifdef __cplusplus
 }
 #endif
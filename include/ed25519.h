@@ -4,7 +4,10 @@
 #ifndef _ED25519_H
 #define _ED25519_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include "rand.h"
 
 #define ED25519_PRIVATE_KEY_SEED_SIZE   32
 #define ED25519_PRIVATE_KEY_SIZE        64
@@ -36,6 +39,16 @@ void ed25519_seeded_keypair(uint8_t* pk,
  */
 void ed25519_keypair(uint8_t* pk, uint8_t* sk);
 
+/**
+ * @brief Randomly generates an Ed25519 public/private key-pair with
+ * a given random number generator provider.
+ *
+ * @param pk the pointer to the output public-key, 32 bytes
+ * @param sk the pointer to the output private-key, 64 bytes
+ * @param rng The provider, or NULL to use bdap_randombytes
+ */
+void ed25519_keypair_ex(uint8_t* pk, uint8_t* sk, const bdap_rng* rng);
+
 /**
  * @brief Creates a Ed25519 public-key from a private-key seed.
  * 
@@ -55,6 +68,25 @@ void ed25519_public_key_from_private_key_seed(uint8_t *p,
 int32_t ed25519_to_curve25519_public_key(uint8_t *curve25519_pk,
                                          const uint8_t *ed25519_pk);
 
+/**
+ * @brief Converts n Ed25519 public-keys to Curve25519 public-keys with
+ * a single field inversion.
+ * 
+ * @note The outputs must not overlap each other or the inputs.
+ * 
+ * @param curve25519_pk the n output Curve25519 public-keys, zeroed
+ * when invalid
+ * @param ed25519_pk the n input Ed25519 public-keys
+ * @param valid the n output flags, true if the key was converted,
+ * required as the backward pass relies on them
+ * @param n the number of keys
+ * @return 0 if every key was converted, non-zero otherwise
+ */
+int32_t ed25519_to_curve25519_public_keys(uint8_t *const *curve25519_pk,
+                                          const uint8_t *const *ed25519_pk,
+                                          bool *valid,
+                                          size_t n);
+
 /**
  * @brief Converts Ed25519 private-key to Curve25519 private-key
  * 
@@ -7,6 +7,30 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include "rand.h"
+
+/**
+ * Option flags of bdap_decrypt_ex().
+ *
+ * BDAP_DECRYPT_SINGLE_PASS decrypts the payload in a single pass
+ * over the ciphertext, authenticating it while it is decrypted into
+ * the plaintext buffer. The plaintext buffer is wiped if the
+ * authentication fails. Without the flag, the payload is first
+ * authenticated and only then decrypted.
+ */
+#define BDAP_DECRYPT_SINGLE_PASS    0x00000001
+
+/**
+ * Option flags of bdap_encrypt_ex() and bdap_decrypt_ex().
+ *
+ * BDAP_ENCRYPT_PARALLEL and BDAP_DECRYPT_PARALLEL process payloads of
+ * at least BDAP_PARALLEL_THRESHOLD bytes with one thread per online
+ * processor. The ciphertext is identical to the one produced without
+ * the flag.
+ */
+#define BDAP_ENCRYPT_PARALLEL       0x00000002
+#define BDAP_DECRYPT_PARALLEL       0x00000002
+#define BDAP_PARALLEL_THRESHOLD     (1024 * 1024)
 
 #ifdef __cplusplus
 extern "C" {
@@ -83,6 +107,38 @@ bool bdap_encrypt(uint8_t* ciphertext,
                   const size_t plaintext_size,
                   const char** error_message);
 
+/**
+ * @brief Performs BDAP end-to-end encryption on a piece of
+ * plaintext for a group of recipients, with options.
+ * 
+ * @note This method behaves as bdap_encrypt(uint8_t*, const uint16_t,
+ * const uint8_t**, const uint8_t*, const size_t, const char**) when
+ * {@code flags} is zero and {@code rng} is NULL. The provider
+ * generates the ephemeral key-pair and the secret.
+ * 
+ * @param ciphertext the output ciphertext pointer
+ * @param num_recipients the number of recipients
+ * @param ed25519_public_key the pointer to an array of
+ *                           recipient's public-keys
+ * @param plaintext the input plaintext pointer
+ * @param plaintext_size the plaintext size in bytes
+ * @param flags a combination of BDAP_ENCRYPT_* option flags
+ * @param rng the random number generator provider,
+ *            or NULL to use bdap_randombytes
+ * @param error_message the pointer to the error message
+ *                      in the event of error
+ * @return true on success
+ * @return false otherwise
+ */
+bool bdap_encrypt_ex(uint8_t* ciphertext,
+                     const uint16_t num_recipients,
+                     const uint8_t** ed25519_public_key,
+                     const uint8_t* plaintext,
+                     const size_t plaintext_size,
+                     const uint32_t flags,
+                     const bdap_rng* rng,
+                     const char** error_message);
+
 /**
  * @brief Performs BDAP end-to-end decryption on a piece of
  * ciphertext.
@@ -118,6 +174,32 @@ bool bdap_decrypt(uint8_t* plaintext,
                   const size_t ciphertext_size,
                   const char** error_message);
 
+/**
+ * @brief Performs BDAP end-to-end decryption on a piece of
+ * ciphertext, with options.
+ * 
+ * @note This method behaves as bdap_decrypt(uint8_t*, const uint8_t*,
+ * const uint8_t*, const size_t, const char**) when {@code flags}
+ * is zero.
+ * 
+ * @param plaintext the output plaintext pointer 
+ * @param ed25519_private_key_seed the pointer to the decryption
+ *                                 private-key seed
+ * @param ciphertext the input ciphertext pointer
+ * @param ciphertext_size the ciphertext size in bytes
+ * @param flags a combination of BDAP_DECRYPT_* option flags
+ * @param error_message the pointer to the error message
+ *                      in the event of error
+ * @return true on success
+ * @return false otherwise
+ */
+bool bdap_decrypt_ex(uint8_t* plaintext,
+                     const uint8_t* ed25519_private_key_seed,
+                     const uint8_t* ciphertext,
+                     const size_t ciphertext_size,
+                     const uint32_t flags,
+                     const char** error_message);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,8 +10,12 @@
 #define BDAP_X25519_PUBLIC_KEY_DERIVATION_FAILED    3
 #define BDAP_X25519_KEYPAIR_FAILED                  4
 #define BDAP_X25519_DH_FAILED                       5
+/* Reserved: the shake256_ctx key derivation cannot fail, so the code is
+ * no longer returned. Kept so the codes after it stay unchanged. */
 #define BDAP_AESCTR_KEY_DERIVATION_FAILED           6
 #define BDAP_AESGCM_KEY_DERIVATION_FAILED           7
+/* Reserved: the multi-key CTR pass cannot fail, so the code is no
+ * longer returned. Kept so the codes after it stay unchanged. */
 #define BDAP_AESCTR_ENCRYPT_FAILED                  8
 #define BDAP_AESCTR_DECRYPT_FAILED                  9
 #define BDAP_AESGCM_ENCRYPT_FAILED                  10
@@ -19,6 +23,7 @@
 #define BDAP_NO_VALID_RECIPIENT                     12
 #define BDAP_MEMORY_PROTECTION_FAILED               13
 #define BDAP_INVALID_CIPHERTEXT                     14
+#define BDAP_MEMORY_ALLOCATION_FAILED               15
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,6 +11,37 @@
 extern "C" {
 #endif
 
+/**
+ * Targets with a 128-bit integer type use the radix 2^51 representation
+ * of fe_51.c, unless VGP_FE_25_5 is defined.
+ */
+#if defined(__SIZEOF_INT128__) && !defined(VGP_FE_25_5)
+#define VGP_FE_51
+#endif
+
+/**
+ * Targets with a 128-bit integer type invert with the safegcd algorithm
+ * of fe_safegcd.c, unless VGP_FE_INV_FERMAT is defined.
+ */
+#if defined(__SIZEOF_INT128__) && !defined(VGP_FE_INV_FERMAT)
+#define VGP_FE_SAFEGCD
+#endif
+
+#if defined(VGP_FE_51)
+
+/**
+ * @brief fe represents a field element in the field of Z(2^255-19).
+ *
+ * A field element h is represented as an array of five 64-bit integers
+ * { h[0], h[1], ..., h[4] } where
+ * h[0] + 2^51 h[1] + 2^102 h[2] + 2^153 h[3] + 2^204 h[4].
+ *
+ * Reference: SUPERCOP amd64-51-30k implementation of x25519
+ */
+typedef uint64_t fe[5];
+
+#else
+
 /**
  * @brief fe represents a field element in the field of Z(2^255-19).
  * 
@@ -22,6 +53,8 @@ extern "C" {
  */
 typedef int32_t fe[10];
 
+#endif
+
 /**
  * @brief Zeros a field element h.
  * 
@@ -129,11 +162,22 @@ void fe_pow_2e252m3(fe x, const fe z);
 /**
  * @brief Inverts a field element.
  * 
+ * @note Uses fe_safegcd.c when VGP_FE_SAFEGCD is defined, otherwise
+ * fe_inv_fermat.
+ * 
  * @param x The output of inversion
  * @param z The field element to be inverted
  */
 void fe_inv(fe x, const fe z);
 
+/**
+ * @brief Inverts a field element by raising it to the power p - 2.
+ * 
+ * @param x The output of inversion
+ * @param z The field element to be inverted
+ */
+void fe_inv_fermat(fe x, const fe z);
+
 /**
  * @brief Negate a field element v.
  * 
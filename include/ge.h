@@ -4,10 +4,14 @@
 #ifndef _GE_H
 #define _GE_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "fe.h"
 
+/* The number of group elements sharing one inversion in ge_are_on_main_subgroup */
+#define GE_SUBGROUP_BATCH_SIZE  16
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -106,6 +110,30 @@ int32_t ge_frombytes(ge_p3* h, const uint8_t* P);
  */
 bool ge_is_on_main_subgroup(const ge_p3* h);
 
+/**
+ * @brief Checks whether or not each of the group-elements lies on the
+ * main subgroup, sharing one field inversion per GE_SUBGROUP_BATCH_SIZE
+ * elements.
+ * 
+ * @param result the n output flags, true if the group element lies on
+ * the main subgroup
+ * @param h the n group elements
+ * @param n the number of group elements
+ */
+void ge_are_on_main_subgroup(bool *result, const ge_p3 *h, size_t n);
+
+/**
+ * @brief Checks whether or not the group-element lies on the main subgroup
+ * by multiplying it by the group order.
+ * 
+ * @note Slower than ge_is_on_main_subgroup, kept as its reference.
+ * 
+ * @param h the group element
+ * @return true if the group element lies on the main subgroup
+ * @return false otherwise
+ */
+bool ge_is_on_main_subgroup_mul_l(const ge_p3* h);
+
 #ifdef __cplusplus
 }
 #endif
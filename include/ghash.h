@@ -0,0 +1,78 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#ifndef _GHASH_H
+#define _GHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GHASH_BLOCK_SIZE    16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The GHASH key, i.e. the hash subkey H and the state
+ * derived from it.
+ *
+ * @note The key is computed once by ghash_init() and selects the
+ * carry-less multiply backend when the CPU supports it. h_words
+ * holds the halves of H and of its bit-reversal for the portable
+ * backend, h_pow the powers H^1..H^4 for the hardware backend. It is
+ * derived from the AES key and shall be wiped with crypto_memzero()
+ * once it is no longer needed.
+ */
+typedef struct
+{
+    uint8_t h[16];
+    uint64_t h_words[6];
+    uint8_t h_pow[4][16];
+    uint32_t backend;
+} ghash_key;
+
+/**
+ * @brief Initialises a GHASH key from the hash subkey H.
+ *
+ * @param key The output GHASH key
+ * @param h The hash subkey H = E(K, 0^128), 16 bytes
+ */
+void ghash_init(ghash_key *key, const uint8_t *h);
+
+/**
+ * @brief Absorbs data into a GHASH accumulator.
+ *
+ * Computes y = (y + X_i) * H for each 16-byte block X_i of data.
+ * A trailing partial block is zero-padded, so data which is not
+ * a multiple of 16 bytes must be passed in a single call.
+ *
+ * @param key The GHASH key initialised by ghash_init()
+ * @param y The input/output accumulator, 16 bytes
+ * @param data The input data
+ * @param len The length of data in bytes
+ */
+void ghash_update(const ghash_key *key,
+                  uint8_t *y,
+                  const uint8_t *data,
+                  size_t len);
+
+/**
+ * @brief Multiplies a GHASH accumulator by a power of H.
+ *
+ * Computes y = y * H^n, which allows partial GHASH values computed
+ * over consecutive parts of the data to be combined: the value of
+ * the first part is multiplied by H^n, where n is the number of
+ * blocks of the second part, and added to the value of the second.
+ *
+ * @param key The GHASH key initialised by ghash_init()
+ * @param y The input/output accumulator, 16 bytes
+ * @param n The exponent, which is not secret
+ */
+void ghash_mul_power(const ghash_key *key, uint8_t *y, uint64_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#ifndef _KECCAKF1600_H
+#define _KECCAKF1600_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The Keccak-f[1600] permutation.
+ *
+ * The state is made of the 25 lanes A[x + 5*y] as 64-bit words, the
+ * byte i of the sponge being the byte i % 8 of lane i / 8 starting
+ * from the least significant one.
+ *
+ * @param state The input/output state, 25 lanes
+ */
+void keccakf1600(uint64_t *state);
+
+/**
+ * @brief Four independent Keccak-f[1600] permutations.
+ *
+ * The four states are interleaved lane by lane, lane i of state j
+ * being state[4*i + j], so that each lane of the four states can be
+ * loaded in a single vector register.
+ *
+ * @param state The input/output states, 100 words
+ */
+void keccakf1600_x4(uint64_t *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
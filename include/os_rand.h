@@ -6,6 +6,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,12 +25,28 @@ void os_randominit(const uint8_t* seed, size_t seed_size);
 /**
  * @brief Randomly generates a block of {@code buf_size} bytes
  * using native OS random-number generator.
+ *
+ * On Linux the vgetrandom() function of the vDSO is used when the
+ * kernel provides it, otherwise short requests are served from a
+ * per-thread pool refilled by the getrandom system call.
  * 
  * @param buf The pointer to the generated random block
  * @param buf_size The length of the random block in bytes
  */
 void os_randombytes(uint8_t *buf, size_t buf_size);
 
+/**
+ * @brief Prevents os_randombytes() from using the vgetrandom() function
+ * of the vDSO, so that the getrandom pool serves short requests as on
+ * kernels without it. Meant for tests.
+ *
+ * @note A no-op on platforms other than Linux.
+ *
+ * @param disable true to use the getrandom pool, false to use
+ * vgetrandom() again when the kernel provides it
+ */
+void os_rand_disable_vgetrandom(bool disable);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,6 +6,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "shake256_rand.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -15,8 +16,8 @@ extern "C" {
  * @brief A function pointer for initialising a random number generator.
  * 
  * @note By default, this function pointer points to
- * os_randominit(const uint8_t, size_t) method, but it can be
- * overwritten with use_shake256_rand() method.
+ * thread_randominit(const uint8_t, size_t) method, but it can be
+ * overwritten with use_os_rand() or use_shake256_rand() method.
  *
  * @param seed the pointer to the seed
  * @param seed_size the size of the seed in bytes
@@ -28,8 +29,10 @@ extern void (*bdap_randominit) (const uint8_t* seed, size_t seed_size);
  * {@code buf_size} bytes.
  * 
  * @note By default, this function pointer points to
- * os_randombytes(uint8_t, size_t) method, but it can be overwritten
- * with use_shake256_rand() method.
+ * thread_randombytes(uint8_t, size_t) method, but it can be
+ * overwritten with use_os_rand() or use_shake256_rand() method.
+ * The pointers are process-wide and shall only be switched while no
+ * other thread uses them.
  * 
  * @param buf The pointer to the generated random block
  * @param buf_size The length of the random block in bytes
@@ -40,9 +43,10 @@ extern void (*bdap_randombytes)(uint8_t *buf, size_t buf_size);
  * @brief Sets up the function pointers above to use SHAKE256-based
  * random number generator.
  * 
- * @note The SHAKE256-based random number generators shall only be
- * used for testing purposes. Don't use it in live/production code,
- * unless you know what you are doing.
+ * @note The process-wide SHAKE256-based random number generator is
+ * deterministic and not thread-safe, it shall only be used for
+ * testing purposes. Don't use it in live/production code, unless
+ * you know what you are doing.
  */
 void use_shake256_rand();
 
@@ -52,6 +56,65 @@ void use_shake256_rand();
  */
 void use_os_rand();
 
+/**
+ * @brief Sets up the function pointers above to use the per-thread
+ * random number generators, which is the default.
+ *
+ * @note Each thread uses its own SHAKE256-based generator seeded from
+ * the OS random number generator, so concurrent callers share no
+ * mutable state.
+ */
+void use_thread_rand();
+
+/**
+ * @brief A random number generator provider.
+ *
+ * @note A provider is passed explicitly to the *_ex() functions which
+ * accept one, so that each subsystem or thread may use a generator of
+ * its own. The randombytes function is called with the state pointer,
+ * the provider does not own the state and the caller shall keep it
+ * alive and not share it between threads without synchronisation.
+ */
+typedef struct
+{
+    void (*randombytes)(void *state, uint8_t *buf, size_t buf_size);
+    void *state;
+} bdap_rng;
+
+/**
+ * @brief Generates a random block of {@code buf_size} bytes with a
+ * provider.
+ *
+ * @param rng The provider, or NULL to use bdap_randombytes
+ * @param buf The pointer to the generated random block
+ * @param buf_size The length of the random block in bytes
+ */
+void bdap_rng_randombytes(const bdap_rng *rng, uint8_t *buf, size_t buf_size);
+
+/**
+ * @brief Sets up a provider using the OS random number generator.
+ *
+ * @param rng The provider to be set up
+ */
+void bdap_rng_os(bdap_rng *rng);
+
+/**
+ * @brief Sets up a provider using a deterministic SHAKE256-based
+ * generator owned by the caller.
+ *
+ * @note The output is the same as that of shake256_randombytes()
+ * after shake256_randominit() with the same seed.
+ *
+ * @param rng The provider to be set up
+ * @param ctx The generator state, seeded by this function
+ * @param seed the pointer to the seed
+ * @param seed_size the size of the seed in bytes
+ */
+void bdap_rng_shake256(bdap_rng *rng,
+                       shake256_rand_ctx *ctx,
+                       const uint8_t *seed,
+                       size_t seed_size);
+
 #ifdef __cplusplus
 }
 #endif
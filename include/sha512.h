@@ -8,11 +8,48 @@
 #include <stddef.h>
 
 #define SHA512_DIGEST_SIZE      64
+#define SHA512_BLOCK_SIZE       128
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Incremental SHA512 context.
+ */
+typedef struct
+{
+    uint64_t state[8];
+    uint64_t bytes;
+    uint8_t buf[SHA512_BLOCK_SIZE];
+    size_t buf_len;
+} sha512_ctx;
+
+/**
+ * @brief Initialises a SHA512 context.
+ *
+ * @param ctx the context
+ */
+void sha512_init(sha512_ctx *ctx);
+
+/**
+ * @brief Hashes {@code in_len} more bytes of input.
+ *
+ * @param ctx the context
+ * @param in the input
+ * @param in_len the size of the input in bytes
+ */
+void sha512_update(sha512_ctx *ctx, const uint8_t *in, size_t in_len);
+
+/**
+ * @brief Writes the hash of all the input to {@code out} and wipes
+ * the context.
+ *
+ * @param ctx the context
+ * @param out the pointer to the {@code SHA512_DIGEST_SIZE} byte hash
+ */
+void sha512_final(sha512_ctx *ctx, uint8_t *out);
+
 /**
  * @brief Generates the SHA512 hash of an input block of
  * {@code in_len} bytes.
@@ -25,6 +62,18 @@ void sha512(uint8_t* out,
             const uint8_t* in,
             size_t in_len);
 
+/**
+ * @brief Generates the SHA512 hashes of four input blocks of
+ * {@code in_len} bytes each, in parallel when AVX2 is available.
+ *
+ * @param out the pointers to the four output hash values
+ * @param in the pointers to the four inputs
+ * @param in_len the size of each input block in bytes
+ */
+void sha512_x4(uint8_t *const *out,
+               const uint8_t *const *in,
+               size_t in_len);
+
 #ifdef __cplusplus
 }
 #endif
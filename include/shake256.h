@@ -7,10 +7,65 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#define SHAKE256_RATE       136
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief An incremental SHAKE-256 context.
+ *
+ * @note The input is absorbed with shake256_absorb(), possibly in
+ * several calls, the padding is applied by shake256_finalize() and
+ * the output is then read with shake256_squeeze(), possibly in several
+ * calls which continue the same output stream. The state depends on
+ * the input and shall be wiped with crypto_memzero() once it is no
+ * longer needed when the input is secret.
+ */
+typedef struct
+{
+    uint64_t a[25];
+    size_t pos;
+    uint32_t finalized;
+} shake256_ctx;
+
+/**
+ * @brief Initialises a SHAKE-256 context.
+ *
+ * @param ctx The context to be initialised
+ */
+void shake256_init(shake256_ctx *ctx);
+
+/**
+ * @brief Absorbs the next part of the input.
+ *
+ * Shall not be called once the context is finalised.
+ *
+ * @param ctx The context initialised by shake256_init()
+ * @param in The pointer to the input
+ * @param in_len The length of the input in bytes
+ */
+void shake256_absorb(shake256_ctx *ctx, const uint8_t *in, size_t in_len);
+
+/**
+ * @brief Pads the absorbed input and switches the context to squeezing.
+ *
+ * @param ctx The context initialised by shake256_init()
+ */
+void shake256_finalize(shake256_ctx *ctx);
+
+/**
+ * @brief Reads the next part of the output stream.
+ *
+ * The context is finalised first if it was not already.
+ *
+ * @param ctx The context initialised by shake256_init()
+ * @param out The output buffer
+ * @param out_len The number of bytes to be read
+ */
+void shake256_squeeze(shake256_ctx *ctx, uint8_t *out, size_t out_len);
+
 /**
  * @brief FIPS-202 SHAKE-256 extandable output function (XOF).
  * 
@@ -25,6 +80,79 @@ int32_t shake256(uint8_t* out,
                  const uint8_t *in,
                  size_t in_len);
 
+/**
+ * @brief Four SHAKE-256 contexts processed in parallel.
+ *
+ * @note The four sponges absorb inputs of the same length and are
+ * squeezed by the same amounts, their states are interleaved as
+ * expected by keccakf1600_x4(). The same wiping rule as shake256_ctx
+ * applies.
+ */
+typedef struct
+{
+    uint64_t a[100];
+    size_t pos;
+    uint32_t finalized;
+} shake256_x4_ctx;
+
+/**
+ * @brief Initialises a times-4 SHAKE-256 context.
+ *
+ * @param ctx The context to be initialised
+ */
+void shake256_x4_init(shake256_x4_ctx *ctx);
+
+/**
+ * @brief Absorbs the next part of each of the four inputs.
+ *
+ * Shall not be called once the context is finalised.
+ *
+ * @param ctx The context initialised by shake256_x4_init()
+ * @param in The pointers to the four inputs
+ * @param in_len The length of each input in bytes
+ */
+void shake256_x4_absorb(shake256_x4_ctx *ctx,
+                        const uint8_t *const *in,
+                        size_t in_len);
+
+/**
+ * @brief Pads the four inputs and switches the context to squeezing.
+ *
+ * @param ctx The context initialised by shake256_x4_init()
+ */
+void shake256_x4_finalize(shake256_x4_ctx *ctx);
+
+/**
+ * @brief Reads the next part of each of the four output streams.
+ *
+ * The context is finalised first if it was not already.
+ *
+ * @param ctx The context initialised by shake256_x4_init()
+ * @param out The pointers to the four output buffers
+ * @param out_len The number of bytes to be read into each buffer
+ */
+void shake256_x4_squeeze(shake256_x4_ctx *ctx,
+                         uint8_t *const *out,
+                         size_t out_len);
+
+/**
+ * @brief Four SHAKE-256 computations in a single pass.
+ *
+ * Equivalent to shake256(out[j], out_len, in[j], in_len) for j from
+ * 0 to 3, the permutations run in parallel with AVX2 when the CPU
+ * supports it.
+ *
+ * @param out The pointers to the four output buffers
+ * @param out_len The expected output length in bytes
+ * @param in The pointers to the four inputs
+ * @param in_len The length of each input in bytes
+ * @return 0 on success, non-zero otherwise
+ */
+int32_t shake256_x4(uint8_t *const *out,
+                    size_t out_len,
+                    const uint8_t *const *in,
+                    size_t in_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,13 +6,59 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "shake256.h"
+
+#define SHAKE256_RAND_RATCHET_INTERVAL  4096
+#define SHAKE256_RAND_RATCHET_KEY_SIZE  64
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Initialises the SHAKE256-based random number generator.
+ * @brief The state of a SHAKE256-based random number generator.
+ *
+ * @note The state determines all the future output and shall be wiped
+ * with crypto_memzero() once it is no longer needed.
+ */
+typedef struct
+{
+    shake256_ctx state;
+    size_t bytes_since_ratchet;
+} shake256_rand_ctx;
+
+/**
+ * @brief Seeds a SHAKE256-based random number generator.
+ *
+ * The seed is absorbed into a SHAKE256 sponge whose output stream is
+ * then returned by shake256_rand_generate(), the state being ratcheted
+ * every SHAKE256_RAND_RATCHET_INTERVAL bytes of output. The first
+ * SHAKE256_RAND_RATCHET_INTERVAL bytes are thus those of SHAKE256(seed).
+ *
+ * @param ctx The generator to be seeded
+ * @param seed the pointer to the seed
+ * @param seed_size the size of the seed in bytes
+ */
+void shake256_rand_init(shake256_rand_ctx *ctx,
+                        const uint8_t *seed,
+                        size_t seed_size);
+
+/**
+ * @brief Generates the next {@code buf_size} bytes of a generator.
+ *
+ * @param ctx The generator seeded by shake256_rand_init()
+ * @param buf The pointer to the generated random block
+ * @param buf_size The length of the random block in bytes
+ */
+void shake256_rand_generate(shake256_rand_ctx *ctx,
+                            uint8_t *buf,
+                            size_t buf_size);
+
+/**
+ * @brief Initialises the process-wide SHAKE256-based random number
+ * generator, see shake256_rand_init().
+ *
+ * @note The process-wide generator is not thread-safe.
  * 
  * @param seed the pointer to the seed
  * @param seed_size the size of the seed in bytes
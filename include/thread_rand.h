@@ -0,0 +1,44 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#ifndef _THREAD_RAND_H
+#define _THREAD_RAND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reseeds the calling thread's random number generator.
+ *
+ * The generator is reseeded from the OS random-number generator, the
+ * seed is only mixed in as additional input, so the output does not
+ * become deterministic.
+ *
+ * @param seed the pointer to the seed, may be NULL if seed_size is 0
+ * @param seed_size the size of the seed in bytes
+ */
+void thread_randominit(const uint8_t* seed, size_t seed_size);
+
+/**
+ * @brief Randomly generates a block of {@code buf_size} bytes
+ * using the calling thread's random number generator.
+ *
+ * Each thread owns a SHAKE256-based generator, seeded from the OS
+ * random-number generator on first use, then reseeded every
+ * megabyte of output and in the child process after a fork(). No
+ * mutable state is shared between threads, so no lock is taken.
+ *
+ * @param buf The pointer to the generated random block
+ * @param buf_size The length of the random block in bytes
+ */
+void thread_randombytes(uint8_t *buf, size_t buf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,342 +1,1573 @@
 // Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
 // See LICENSE.md file for license, copying and use information.
 
+/**
+ * @file aes256.c
+ *
+ * @brief Constant-time bit-sliced implementation of AES256.
+ *
+ * The implementation follows the 64-bit bit-sliced design of
+ * BearSSL's aes_ct64 by Thomas Pornin (MIT license). Four blocks
+ * are processed in parallel, each 64-bit word q[i] holding the bit
+ * i of all sixteen bytes of the four blocks. The S-box is the
+ * Boyar-Peralta circuit, so neither the key schedule nor the
+ * rounds perform any secret-dependent memory access.
+ *
+ * On x86 CPUs with the AES instructions, a pipelined AES-NI backend
+ * is selected at run-time instead, and on x86 CPUs with SSSE3 but
+ * without AES-NI, a constant-time vector-permute backend.
+ */
+
 #include <string.h>
 #include "aes256.h"
+#include "cpu_features.h"
 #include "utils.h"
 
-static uint8_t mult(uint8_t c, uint8_t d)
+#if defined(VGP_X86_INTRINSICS)
+#include <immintrin.h>
+#endif
+
+#define AES256_ROUNDS       14
+
+#define AES256_BACKEND_BITSLICE     0
+#define AES256_BACKEND_AESNI        1
+#define AES256_BACKEND_VPAES        2
+
+/* Number of blocks in flight in the AES-NI pipeline */
+#define AESNI_PARALLEL_BLOCKS       8
+
+static uint32_t little_endian_load32(const uint8_t *x)
+{
+    return ((uint32_t)x[0])
+        | (((uint32_t)x[1]) <<  8)
+        | (((uint32_t)x[2]) << 16)
+        | (((uint32_t)x[3]) << 24);
+}
+
+static void little_endian_store32(uint8_t *x, uint32_t u)
+{
+    x[0] = u & 0xFF; u >>= 8;
+    x[1] = u & 0xFF; u >>= 8;
+    x[2] = u & 0xFF; u >>= 8;
+    x[3] = u & 0xFF;
+}
+
+/**
+ * @brief Bit-sliced AES S-box, Boyar-Peralta circuit.
+ *
+ * @param q The bit-sliced state, 8 words
+ */
+static void bitslice_sbox(uint64_t *q)
+{
+    uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+    uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    uint64_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    uint64_t y20, y21;
+    uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    uint64_t z10, z11, z12, z13, z14, z15, z16, z17;
+    uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    uint64_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    uint64_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    uint64_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    uint64_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    uint64_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    uint64_t t60, t61, t62, t63, t64, t65, t66, t67;
+    uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    /* Top linear transformation */
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9  = x0 ^ x3;
+    y8  = x0 ^ x5;
+    t0  = x1 ^ x2;
+    y1  = t0 ^ x7;
+    y4  = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2  = y1 ^ x0;
+    y5  = y1 ^ x6;
+    y3  = y5 ^ y8;
+    t1  = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6  = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7  = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    /* Non-linear section */
+    t2  = y12 & y15;
+    t3  = y3 & y6;
+    t4  = t3 ^ t2;
+    t5  = y4 & x7;
+    t6  = t5 ^ t2;
+    t7  = y13 & y16;
+    t8  = y5 & y1;
+    t9  = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0  = t44 & y15;
+    z1  = t37 & y6;
+    z2  = t33 & x7;
+    z3  = t43 & y16;
+    z4  = t40 & y1;
+    z5  = t29 & y7;
+    z6  = t42 & y11;
+    z7  = t45 & y17;
+    z8  = t41 & y10;
+    z9  = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    /* Bottom linear transformation */
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0  = t59 ^ t63;
+    s6  = t56 ^ ~t62;
+    s7  = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3  = t53 ^ t66;
+    s4  = t51 ^ t66;
+    s5  = t47 ^ t65;
+    s1  = t64 ^ ~s3;
+    s2  = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/**
+ * @brief Bit-sliced inverse AES S-box.
+ *
+ * The inverse S-box is computed as the inverse affine transform,
+ * followed by the forward S-box, followed by the inverse affine
+ * transform again.
+ *
+ * @param q The bit-sliced state, 8 words
+ */
+static void bitslice_inv_sbox(uint64_t *q)
+{
+    uint64_t q0, q1, q2, q3, q4, q5, q6, q7;
+
+    q0 = ~q[0];
+    q1 = ~q[1];
+    q2 =  q[2];
+    q3 =  q[3];
+    q4 =  q[4];
+    q5 = ~q[5];
+    q6 = ~q[6];
+    q7 =  q[7];
+    q[7] = q1 ^ q4 ^ q6;
+    q[6] = q0 ^ q3 ^ q5;
+    q[5] = q7 ^ q2 ^ q4;
+    q[4] = q6 ^ q1 ^ q3;
+    q[3] = q5 ^ q0 ^ q2;
+    q[2] = q4 ^ q7 ^ q1;
+    q[1] = q3 ^ q6 ^ q0;
+    q[0] = q2 ^ q5 ^ q7;
+
+    bitslice_sbox(q);
+
+    q0 = ~q[0];
+    q1 = ~q[1];
+    q2 =  q[2];
+    q3 =  q[3];
+    q4 =  q[4];
+    q5 = ~q[5];
+    q6 = ~q[6];
+    q7 =  q[7];
+    q[7] = q1 ^ q4 ^ q6;
+    q[6] = q0 ^ q3 ^ q5;
+    q[5] = q7 ^ q2 ^ q4;
+    q[4] = q6 ^ q1 ^ q3;
+    q[3] = q5 ^ q0 ^ q2;
+    q[2] = q4 ^ q7 ^ q1;
+    q[1] = q3 ^ q6 ^ q0;
+    q[0] = q2 ^ q5 ^ q7;
+}
+
+#define SWAPN(cl, ch, s, x, y) { \
+    uint64_t a, b; \
+    a = (x); \
+    b = (y); \
+    (x) = (a & (uint64_t)(cl)) | ((b & (uint64_t)(cl)) << (s)); \
+    (y) = ((a & (uint64_t)(ch)) >> (s)) | (b & (uint64_t)(ch)); \
+    }
+
+#define SWAP2(x, y) SWAPN(0x5555555555555555ULL, 0xAAAAAAAAAAAAAAAAULL, 1, x, y)
+#define SWAP4(x, y) SWAPN(0x3333333333333333ULL, 0xCCCCCCCCCCCCCCCCULL, 2, x, y)
+#define SWAP8(x, y) SWAPN(0x0F0F0F0F0F0F0F0FULL, 0xF0F0F0F0F0F0F0F0ULL, 4, x, y)
+
+/**
+ * @brief Transposes the state to and from the bit-sliced
+ * representation. The operation is its own inverse.
+ *
+ * @param q The state, 8 words
+ */
+static void ortho(uint64_t *q)
+{
+    SWAP2(q[0], q[1]);
+    SWAP2(q[2], q[3]);
+    SWAP2(q[4], q[5]);
+    SWAP2(q[6], q[7]);
+
+    SWAP4(q[0], q[2]);
+    SWAP4(q[1], q[3]);
+    SWAP4(q[4], q[6]);
+    SWAP4(q[5], q[7]);
+
+    SWAP8(q[0], q[4]);
+    SWAP8(q[1], q[5]);
+    SWAP8(q[2], q[6]);
+    SWAP8(q[3], q[7]);
+}
+
+static void interleave_in(uint64_t *q0, uint64_t *q1, const uint32_t *w)
+{
+    uint64_t x0, x1, x2, x3;
+
+    x0 = w[0];
+    x1 = w[1];
+    x2 = w[2];
+    x3 = w[3];
+    x0 |= (x0 << 16);
+    x1 |= (x1 << 16);
+    x2 |= (x2 << 16);
+    x3 |= (x3 << 16);
+    x0 &= 0x0000FFFF0000FFFFULL;
+    x1 &= 0x0000FFFF0000FFFFULL;
+    x2 &= 0x0000FFFF0000FFFFULL;
+    x3 &= 0x0000FFFF0000FFFFULL;
+    x0 |= (x0 << 8);
+    x1 |= (x1 << 8);
+    x2 |= (x2 << 8);
+    x3 |= (x3 << 8);
+    x0 &= 0x00FF00FF00FF00FFULL;
+    x1 &= 0x00FF00FF00FF00FFULL;
+    x2 &= 0x00FF00FF00FF00FFULL;
+    x3 &= 0x00FF00FF00FF00FFULL;
+    *q0 = x0 | (x2 << 8);
+    *q1 = x1 | (x3 << 8);
+}
+
+static void interleave_out(uint32_t *w, uint64_t q0, uint64_t q1)
+{
+    uint64_t x0, x1, x2, x3;
+
+    x0 =  q0       & 0x00FF00FF00FF00FFULL;
+    x1 =  q1       & 0x00FF00FF00FF00FFULL;
+    x2 = (q0 >> 8) & 0x00FF00FF00FF00FFULL;
+    x3 = (q1 >> 8) & 0x00FF00FF00FF00FFULL;
+    x0 |= (x0 >> 8);
+    x1 |= (x1 >> 8);
+    x2 |= (x2 >> 8);
+    x3 |= (x3 >> 8);
+    x0 &= 0x0000FFFF0000FFFFULL;
+    x1 &= 0x0000FFFF0000FFFFULL;
+    x2 &= 0x0000FFFF0000FFFFULL;
+    x3 &= 0x0000FFFF0000FFFFULL;
+    w[0] = (uint32_t)x0 | (uint32_t)(x0 >> 16);
+    w[1] = (uint32_t)x1 | (uint32_t)(x1 >> 16);
+    w[2] = (uint32_t)x2 | (uint32_t)(x2 >> 16);
+    w[3] = (uint32_t)x3 | (uint32_t)(x3 >> 16);
+}
+
+static void add_round_key(uint64_t *q, const uint64_t *sk)
+{
+    q[0] ^= sk[0];
+    q[1] ^= sk[1];
+    q[2] ^= sk[2];
+    q[3] ^= sk[3];
+    q[4] ^= sk[4];
+    q[5] ^= sk[5];
+    q[6] ^= sk[6];
+    q[7] ^= sk[7];
+}
+
+static void shift_rows(uint64_t *q)
 {
     int32_t i;
-    uint8_t f[8];
-    uint8_t g[8];
-    uint8_t h[15];
-    uint8_t result;
-
-    crypto_memzero(h, sizeof(h));
-    f[0] = 1 & c;        g[0] = 1 & d;
-    f[1] = 1 & (c >> 1); g[1] = 1 & (d >> 1);
-    f[2] = 1 & (c >> 2); g[2] = 1 & (d >> 2);
-    f[3] = 1 & (c >> 3); g[3] = 1 & (d >> 3);
-    f[4] = 1 & (c >> 4); g[4] = 1 & (d >> 4);
-    f[5] = 1 & (c >> 5); g[5] = 1 & (d >> 5);
-    f[6] = 1 & (c >> 6); g[6] = 1 & (d >> 6);
-    f[7] = 1 & (c >> 7); g[7] = 1 & (d >> 7);
+    uint64_t x;
 
     for (i = 0; i < 8; ++i)
     {
-        h[i]     ^= f[i] & g[0];
-        h[i + 1] ^= f[i] & g[1];
-        h[i + 2] ^= f[i] & g[2];
-        h[i + 3] ^= f[i] & g[3];
-        h[i + 4] ^= f[i] & g[4];
-        h[i + 5] ^= f[i] & g[5];
-        h[i + 6] ^= f[i] & g[6];
-        h[i + 7] ^= f[i] & g[7];
+        x = q[i];
+        q[i] = (x & 0x000000000000FFFFULL)
+            | ((x & 0x00000000FFF00000ULL) >>  4)
+            | ((x & 0x00000000000F0000ULL) << 12)
+            | ((x & 0x0000FF0000000000ULL) >>  8)
+            | ((x & 0x000000FF00000000ULL) <<  8)
+            | ((x & 0xF000000000000000ULL) >> 12)
+            | ((x & 0x0FFF000000000000ULL) <<  4);
     }
+}
+
+static void inv_shift_rows(uint64_t *q)
+{
+    int32_t i;
+    uint64_t x;
+
+    for (i = 0; i < 8; ++i)
+    {
+        x = q[i];
+        q[i] = (x & 0x000000000000FFFFULL)
+            | ((x & 0x000000000FFF0000ULL) <<  4)
+            | ((x & 0x00000000F0000000ULL) >> 12)
+            | ((x & 0x000000FF00000000ULL) <<  8)
+            | ((x & 0x0000FF0000000000ULL) >>  8)
+            | ((x & 0x000F000000000000ULL) << 12)
+            | ((x & 0xFFF0000000000000ULL) >>  4);
+    }
+}
+
+static uint64_t rotr32(uint64_t x)
+{
+    return (x << 32) | (x >> 32);
+}
+
+static void mix_columns(uint64_t *q)
+{
+    uint64_t q0, q1, q2, q3, q4, q5, q6, q7;
+    uint64_t r0, r1, r2, r3, r4, r5, r6, r7;
+
+    q0 = q[0];
+    q1 = q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = q[5];
+    q6 = q[6];
+    q7 = q[7];
+    r0 = (q0 >> 16) | (q0 << 48);
+    r1 = (q1 >> 16) | (q1 << 48);
+    r2 = (q2 >> 16) | (q2 << 48);
+    r3 = (q3 >> 16) | (q3 << 48);
+    r4 = (q4 >> 16) | (q4 << 48);
+    r5 = (q5 >> 16) | (q5 << 48);
+    r6 = (q6 >> 16) | (q6 << 48);
+    r7 = (q7 >> 16) | (q7 << 48);
+
+    q[0] = q7 ^ r7 ^ r0 ^ rotr32(q0 ^ r0);
+    q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ rotr32(q1 ^ r1);
+    q[2] = q1 ^ r1 ^ r2 ^ rotr32(q2 ^ r2);
+    q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ rotr32(q3 ^ r3);
+    q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ rotr32(q4 ^ r4);
+    q[5] = q4 ^ r4 ^ r5 ^ rotr32(q5 ^ r5);
+    q[6] = q5 ^ r5 ^ r6 ^ rotr32(q6 ^ r6);
+    q[7] = q6 ^ r6 ^ r7 ^ rotr32(q7 ^ r7);
+}
+
+static void inv_mix_columns(uint64_t *q)
+{
+    uint64_t q0, q1, q2, q3, q4, q5, q6, q7;
+    uint64_t r0, r1, r2, r3, r4, r5, r6, r7;
+
+    q0 = q[0];
+    q1 = q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = q[5];
+    q6 = q[6];
+    q7 = q[7];
+    r0 = (q0 >> 16) | (q0 << 48);
+    r1 = (q1 >> 16) | (q1 << 48);
+    r2 = (q2 >> 16) | (q2 << 48);
+    r3 = (q3 >> 16) | (q3 << 48);
+    r4 = (q4 >> 16) | (q4 << 48);
+    r5 = (q5 >> 16) | (q5 << 48);
+    r6 = (q6 >> 16) | (q6 << 48);
+    r7 = (q7 >> 16) | (q7 << 48);
+
+    q[0] = q5 ^ q6 ^ q7 ^ r0 ^ r5 ^ r7
+        ^ rotr32(q0 ^ q5 ^ q6 ^ r0 ^ r5);
+    q[1] = q0 ^ q5 ^ r0 ^ r1 ^ r5 ^ r6 ^ r7
+        ^ rotr32(q1 ^ q5 ^ q7 ^ r1 ^ r5 ^ r6);
+    q[2] = q0 ^ q1 ^ q6 ^ r1 ^ r2 ^ r6 ^ r7
+        ^ rotr32(q0 ^ q2 ^ q6 ^ r2 ^ r6 ^ r7);
+    q[3] = q0 ^ q1 ^ q2 ^ q5 ^ q6 ^ r0 ^ r2 ^ r3 ^ r5
+        ^ rotr32(q0 ^ q1 ^ q3 ^ q5 ^ q6 ^ q7 ^ r0 ^ r3 ^ r5 ^ r7);
+    q[4] = q1 ^ q2 ^ q3 ^ q5 ^ r1 ^ r3 ^ r4 ^ r5 ^ r6 ^ r7
+        ^ rotr32(q1 ^ q2 ^ q4 ^ q5 ^ q7 ^ r1 ^ r4 ^ r5 ^ r6);
+    q[5] = q2 ^ q3 ^ q4 ^ q6 ^ r2 ^ r4 ^ r5 ^ r6 ^ r7
+        ^ rotr32(q2 ^ q3 ^ q5 ^ q6 ^ r2 ^ r5 ^ r6 ^ r7);
+    q[6] = q3 ^ q4 ^ q5 ^ q7 ^ r3 ^ r5 ^ r6 ^ r7
+        ^ rotr32(q3 ^ q4 ^ q6 ^ q7 ^ r3 ^ r6 ^ r7);
+    q[7] = q4 ^ q5 ^ q6 ^ r4 ^ r6 ^ r7
+        ^ rotr32(q4 ^ q5 ^ q7 ^ r4 ^ r7);
+}
+
+static void bitslice_encrypt(const uint64_t *sk, uint64_t *q)
+{
+    int32_t round;
 
-    for (i = 6; i >= 0; --i)
+    add_round_key(q, sk);
+    for (round = 1; round < AES256_ROUNDS; ++round)
     {
-        h[i + 0] ^= h[i + 8];
-        h[i + 1] ^= h[i + 8];
-        h[i + 3] ^= h[i + 8];
-        h[i + 4] ^= h[i + 8];
-        h[i + 8] ^= h[i + 8];
-    }
-
-    result  = h[0];
-    result |= h[1] << 1;
-    result |= h[2] << 2;
-    result |= h[3] << 3;
-    result |= h[4] << 4;
-    result |= h[5] << 5;
-    result |= h[6] << 6;
-    result |= h[7] << 7;
-
-    return result;
-}
-
-static uint8_t sqr(uint8_t c)
+        bitslice_sbox(q);
+        shift_rows(q);
+        mix_columns(q);
+        add_round_key(q, sk + (round << 3));
+    }
+    bitslice_sbox(q);
+    shift_rows(q);
+    add_round_key(q, sk + (AES256_ROUNDS << 3));
+}
+
+static void bitslice_decrypt(const uint64_t *sk, uint64_t *q)
 {
-    return mult(c, c);
-}
-
-static uint8_t dbl(uint8_t c)
+    int32_t round;
+
+    add_round_key(q, sk + (AES256_ROUNDS << 3));
+    for (round = AES256_ROUNDS - 1; round > 0; --round)
+    {
+        inv_shift_rows(q);
+        bitslice_inv_sbox(q);
+        add_round_key(q, sk + (round << 3));
+        inv_mix_columns(q);
+    }
+    inv_shift_rows(q);
+    bitslice_inv_sbox(q);
+    add_round_key(q, sk);
+}
+
+/**
+ * @brief Applies the S-box to each byte of up to 16 words with a
+ * single pass of the bit-sliced S-box.
+ */
+static void sub_words(uint32_t *x, size_t num_words)
 {
-    return mult(c, 2);
+    uint64_t q[8];
+    size_t i;
+
+    memset(q, 0, sizeof(q));
+    for (i = 0; i < num_words; ++i)
+    {
+        q[i >> 1] |= (uint64_t)x[i] << (32 * (i & 1));
+    }
+    ortho(q);
+    bitslice_sbox(q);
+    ortho(q);
+    for (i = 0; i < num_words; ++i)
+    {
+        x[i] = (uint32_t)(q[i >> 1] >> (32 * (i & 1)));
+    }
+    crypto_memzero(q, sizeof(q));
+}
+
+/**
+ * @brief Loads up to four blocks into the bit-sliced state.
+ *
+ * Missing blocks are filled with zeros.
+ */
+static void load_blocks(uint64_t *q, const uint8_t *in, size_t num_blocks)
+{
+    uint32_t w[16];
+    size_t i;
+
+    memset(w, 0, sizeof(w));
+    for (i = 0; i < 4 * num_blocks; ++i)
+    {
+        w[i] = little_endian_load32(in + 4 * i);
+    }
+    for (i = 0; i < 4; ++i)
+    {
+        interleave_in(&q[i], &q[i + 4], w + (i << 2));
+    }
+    ortho(q);
+
+    crypto_memzero(w, sizeof(w));
 }
 
-static uint8_t inv(uint8_t c)
-{
-    /* c^3 = c^2 * c */
-    uint8_t c_pow_3 = mult(sqr(c), c);
-    /* c^7 = (c^3)^2 * c */
-    uint8_t c_pow_7 = mult(sqr(c_pow_3), c);
-    /* c^63 = (((c^7)^2)^2)^2 * c^7 */
-    uint8_t c_pow_63 = mult(sqr(sqr(sqr(c_pow_7))), c_pow_7);
-    /* c^127 = (c^63)^2 * c */
-    uint8_t c_pow_127 = mult(sqr(c_pow_63), c);
-    /* The inverse of c, c^-1 = c^254 = (c^127)^2 */
-    return sqr(c_pow_127);
+static void store_blocks(uint8_t *out, uint64_t *q, size_t num_blocks)
+{
+    uint32_t w[16];
+    size_t i;
+
+    ortho(q);
+    for (i = 0; i < 4; ++i)
+    {
+        interleave_out(w + (i << 2), q[i], q[i + 4]);
+    }
+    for (i = 0; i < 4 * num_blocks; ++i)
+    {
+        little_endian_store32(out + 4 * i, w[i]);
+    }
+
+    crypto_memzero(w, sizeof(w));
 }
 
-static uint8_t byte_sub(uint8_t c)
+#if defined(VGP_X86_INTRINSICS)
+
+#define AESNI_EXPAND_EVEN(t1, t2) { \
+    __m128i t4; \
+    t2 = _mm_shuffle_epi32(t2, 0xff); \
+    t4 = _mm_slli_si128(t1, 4); \
+    t1 = _mm_xor_si128(t1, t4); \
+    t4 = _mm_slli_si128(t4, 4); \
+    t1 = _mm_xor_si128(t1, t4); \
+    t4 = _mm_slli_si128(t4, 4); \
+    t1 = _mm_xor_si128(t1, t4); \
+    t1 = _mm_xor_si128(t1, t2); \
+    }
+
+#define AESNI_EXPAND_ODD(t1, t3) { \
+    __m128i t2, t4; \
+    t4 = _mm_aeskeygenassist_si128(t1, 0x00); \
+    t2 = _mm_shuffle_epi32(t4, 0xaa); \
+    t4 = _mm_slli_si128(t3, 4); \
+    t3 = _mm_xor_si128(t3, t4); \
+    t4 = _mm_slli_si128(t4, 4); \
+    t3 = _mm_xor_si128(t3, t4); \
+    t4 = _mm_slli_si128(t4, 4); \
+    t3 = _mm_xor_si128(t3, t4); \
+    t3 = _mm_xor_si128(t3, t2); \
+    }
+
+#define AESNI_EXPAND_ROUND(rk, i, t1, t2, t3, rcon) { \
+    t2 = _mm_aeskeygenassist_si128(t3, rcon); \
+    AESNI_EXPAND_EVEN(t1, t2); \
+    rk[i] = t1; \
+    AESNI_EXPAND_ODD(t1, t3); \
+    rk[i + 1] = t3; \
+    }
+
+/**
+ * @brief AES-NI key expansion, the encryption round keys are followed
+ * by the decryption round keys of the equivalent inverse cipher.
+ */
+VGP_TARGET("aes")
+static void aesni_init(aes256_key_schedule *ctx, const uint8_t *key)
 {
-    uint8_t f[8];
-    uint8_t h[8];
-    uint8_t result;
+    __m128i rk[2 * (AES256_ROUNDS + 1)];
+    __m128i t1, t2, t3;
+    int32_t i;
 
-    c = inv(c);
-    f[0] = 1 & c;
-    f[1] = 1 & (c >> 1);
-    f[2] = 1 & (c >> 2);
-    f[3] = 1 & (c >> 3);
-    f[4] = 1 & (c >> 4);
-    f[5] = 1 & (c >> 5);
-    f[6] = 1 & (c >> 6);
-    f[7] = 1 & (c >> 7);
+    t1 = _mm_loadu_si128((const __m128i *)key);
+    t3 = _mm_loadu_si128((const __m128i *)(key + 16));
+    rk[0] = t1;
+    rk[1] = t3;
+    AESNI_EXPAND_ROUND(rk,  2, t1, t2, t3, 0x01);
+    AESNI_EXPAND_ROUND(rk,  4, t1, t2, t3, 0x02);
+    AESNI_EXPAND_ROUND(rk,  6, t1, t2, t3, 0x04);
+    AESNI_EXPAND_ROUND(rk,  8, t1, t2, t3, 0x08);
+    AESNI_EXPAND_ROUND(rk, 10, t1, t2, t3, 0x10);
+    AESNI_EXPAND_ROUND(rk, 12, t1, t2, t3, 0x20);
+    t2 = _mm_aeskeygenassist_si128(t3, 0x40);
+    AESNI_EXPAND_EVEN(t1, t2);
+    rk[14] = t1;
 
-    h[0] = f[0] ^ f[4] ^ f[5] ^ f[6] ^ f[7] ^ 1;
-    h[1] = f[1] ^ f[5] ^ f[6] ^ f[7] ^ f[0] ^ 1;
-    h[2] = f[2] ^ f[6] ^ f[7] ^ f[0] ^ f[1];
-    h[3] = f[3] ^ f[7] ^ f[0] ^ f[1] ^ f[2];
-    h[4] = f[4] ^ f[0] ^ f[1] ^ f[2] ^ f[3];
-    h[5] = f[5] ^ f[1] ^ f[2] ^ f[3] ^ f[4] ^ 1;
-    h[6] = f[6] ^ f[2] ^ f[3] ^ f[4] ^ f[5] ^ 1;
-    h[7] = f[7] ^ f[3] ^ f[4] ^ f[5] ^ f[6];
+    rk[15] = rk[AES256_ROUNDS];
+    for (i = 1; i < AES256_ROUNDS; ++i)
+    {
+        rk[15 + i] = _mm_aesimc_si128(rk[AES256_ROUNDS - i]);
+    }
+    rk[15 + AES256_ROUNDS] = rk[0];
 
-    result  = h[0];
-    result |= h[1] << 1;
-    result |= h[2] << 2;
-    result |= h[3] << 3;
-    result |= h[4] << 4;
-    result |= h[5] << 5;
-    result |= h[6] << 6;
-    result |= h[7] << 7;
+    for (i = 0; i < 2 * (AES256_ROUNDS + 1); ++i)
+    {
+        _mm_storeu_si128((__m128i *)ctx->keys.rk + i, rk[i]);
+    }
 
-    return result;
+    crypto_memzero(rk, sizeof(rk));
 }
 
-static uint8_t inv_byte_sub(uint8_t c)
+VGP_TARGET("aes")
+static void aesni_encrypt_blocks(const aes256_key_schedule *ctx,
+                                 uint8_t *out,
+                                 const uint8_t *in,
+                                 size_t num_blocks)
 {
-    uint8_t h[8];
-    uint8_t f[8];
+    __m128i rk[AES256_ROUNDS + 1];
+    __m128i b[AESNI_PARALLEL_BLOCKS];
+    int32_t i, round;
 
-    h[0] = 1 & c;
-    h[1] = 1 & (c >> 1);
-    h[2] = 1 & (c >> 2);
-    h[3] = 1 & (c >> 3);
-    h[4] = 1 & (c >> 4);
-    h[5] = 1 & (c >> 5);
-    h[6] = 1 & (c >> 6);
-    h[7] = 1 & (c >> 7);
+    for (i = 0; i <= AES256_ROUNDS; ++i)
+    {
+        rk[i] = _mm_loadu_si128((const __m128i *)ctx->keys.rk + i);
+    }
+
+    while (num_blocks >= AESNI_PARALLEL_BLOCKS)
+    {
+        for (i = 0; i < AESNI_PARALLEL_BLOCKS; ++i)
+        {
+            b[i] = _mm_loadu_si128((const __m128i *)in + i);
+            b[i] = _mm_xor_si128(b[i], rk[0]);
+        }
+        for (round = 1; round < AES256_ROUNDS; ++round)
+        {
+            for (i = 0; i < AESNI_PARALLEL_BLOCKS; ++i)
+            {
+                b[i] = _mm_aesenc_si128(b[i], rk[round]);
+            }
+        }
+        for (i = 0; i < AESNI_PARALLEL_BLOCKS; ++i)
+        {
+            b[i] = _mm_aesenclast_si128(b[i], rk[AES256_ROUNDS]);
+            _mm_storeu_si128((__m128i *)out + i, b[i]);
+        }
 
-    h[0] ^= 1;
-    h[1] ^= 1;
-    h[5] ^= 1;
-    h[6] ^= 1;
-    f[0] = h[2] ^ h[5] ^ h[7];
-    f[1] = h[3] ^ h[6] ^ h[0];
-    f[2] = h[4] ^ h[7] ^ h[1];
-    f[3] = h[5] ^ h[0] ^ h[2];
-    f[4] = h[6] ^ h[1] ^ h[3];
-    f[5] = h[7] ^ h[2] ^ h[4];
-    f[6] = h[0] ^ h[3] ^ h[5];
-    f[7] = h[1] ^ h[4] ^ h[6];
+        in += AESNI_PARALLEL_BLOCKS * AES256_BLOCK_SIZE;
+        out += AESNI_PARALLEL_BLOCKS * AES256_BLOCK_SIZE;
+        num_blocks -= AESNI_PARALLEL_BLOCKS;
+    }
 
-    c = f[0];
-    c |= f[1] << 1;
-    c |= f[2] << 2;
-    c |= f[3] << 3;
-    c |= f[4] << 4;
-    c |= f[5] << 5;
-    c |= f[6] << 6;
-    c |= f[7] << 7;
+    while (num_blocks > 0)
+    {
+        b[0] = _mm_loadu_si128((const __m128i *)in);
+        b[0] = _mm_xor_si128(b[0], rk[0]);
+        for (round = 1; round < AES256_ROUNDS; ++round)
+        {
+            b[0] = _mm_aesenc_si128(b[0], rk[round]);
+        }
+        b[0] = _mm_aesenclast_si128(b[0], rk[AES256_ROUNDS]);
+        _mm_storeu_si128((__m128i *)out, b[0]);
 
-    return inv(c);
+        in += AES256_BLOCK_SIZE;
+        out += AES256_BLOCK_SIZE;
+        --num_blocks;
+    }
 }
 
-void expand_key(uint8_t *expanded, const uint8_t *key)
+VGP_TARGET("aes")
+static void aesni_decrypt_blocks(const aes256_key_schedule *ctx,
+                                 uint8_t *out,
+                                 const uint8_t *in,
+                                 size_t num_blocks)
 {
-    int32_t idx;
-    uint8_t t[4];
-    uint8_t round_constant;
-
-    for (idx = 0; idx < 8; ++idx)
-    {
-        expanded[      idx] = key[4*idx    ];
-        expanded[ 60 + idx] = key[4*idx + 1];
-        expanded[120 + idx] = key[4*idx + 2];
-        expanded[180 + idx] = key[4*idx + 3];
-    }
-
-    round_constant = 1;
-    for (idx = 8; idx < 60; ++idx)
-    {
-        if (idx & 3) 
-        {
-            t[0] = expanded[      (idx - 1)];
-            t[1] = expanded[ 60 + (idx - 1)];
-            t[2] = expanded[120 + (idx - 1)];
-            t[3] = expanded[180 + (idx - 1)];
-        }
-        else if (idx & 7) 
-        {
-            t[0] = byte_sub(expanded[      (idx - 1)]);
-            t[1] = byte_sub(expanded[ 60 + (idx - 1)]);
-            t[2] = byte_sub(expanded[120 + (idx - 1)]);
-            t[3] = byte_sub(expanded[180 + (idx - 1)]);
+    __m128i rk[AES256_ROUNDS + 1];
+    __m128i b[AESNI_PARALLEL_BLOCKS];
+    int32_t i, round;
+
+    for (i = 0; i <= AES256_ROUNDS; ++i)
+    {
+        rk[i] = _mm_loadu_si128((const __m128i *)ctx->keys.rk
+                                + AES256_ROUNDS + 1 + i);
+    }
+
+    while (num_blocks >= AESNI_PARALLEL_BLOCKS)
+    {
+        for (i = 0; i < AESNI_PARALLEL_BLOCKS; ++i)
+        {
+            b[i] = _mm_loadu_si128((const __m128i *)in + i);
+            b[i] = _mm_xor_si128(b[i], rk[0]);
         }
-        else
+        for (round = 1; round < AES256_ROUNDS; ++round)
+        {
+            for (i = 0; i < AESNI_PARALLEL_BLOCKS; ++i)
+            {
+                b[i] = _mm_aesdec_si128(b[i], rk[round]);
+            }
+        }
+        for (i = 0; i < AESNI_PARALLEL_BLOCKS; ++i)
+        {
+            b[i] = _mm_aesdeclast_si128(b[i], rk[AES256_ROUNDS]);
+            _mm_storeu_si128((__m128i *)out + i, b[i]);
+        }
+
+        in += AESNI_PARALLEL_BLOCKS * AES256_BLOCK_SIZE;
+        out += AESNI_PARALLEL_BLOCKS * AES256_BLOCK_SIZE;
+        num_blocks -= AESNI_PARALLEL_BLOCKS;
+    }
+
+    while (num_blocks > 0)
+    {
+        b[0] = _mm_loadu_si128((const __m128i *)in);
+        b[0] = _mm_xor_si128(b[0], rk[0]);
+        for (round = 1; round < AES256_ROUNDS; ++round)
         {
-            t[0]  = byte_sub(expanded[ 60 + (idx - 1)]);
-            t[1]  = byte_sub(expanded[120 + (idx - 1)]);
-            t[2]  = byte_sub(expanded[180 + (idx - 1)]);
-            t[3]  = byte_sub(expanded[      (idx - 1)]);
-            t[0] ^= round_constant;
-            round_constant = dbl(round_constant);
+            b[0] = _mm_aesdec_si128(b[0], rk[round]);
         }
-        expanded[      idx] = t[0] ^ expanded[      (idx - 8)];
-        expanded[ 60 + idx] = t[1] ^ expanded[ 60 + (idx - 8)];
-        expanded[120 + idx] = t[2] ^ expanded[120 + (idx - 8)];
-        expanded[180 + idx] = t[3] ^ expanded[180 + (idx - 8)];
+        b[0] = _mm_aesdeclast_si128(b[0], rk[AES256_ROUNDS]);
+        _mm_storeu_si128((__m128i *)out, b[0]);
+
+        in += AES256_BLOCK_SIZE;
+        out += AES256_BLOCK_SIZE;
+        --num_blocks;
     }
 }
 
-void aes256_bitslice_encrypt(uint8_t *out,
-                             const uint8_t *in,
-                             const uint8_t *key)
+/**
+ * Vector-permute backend, after M. Hamburg, "Accelerating AES with
+ * Vector Permute Instructions" (CHES 2009).
+ *
+ * The state is kept in a basis where each byte is a pair (i, k) of
+ * elements of GF(2^4), the high and low nibble, representing
+ * a.i.t + k in GF(2^4)[t]/(t^2 + t + 1/a). The inversion in GF(2^8)
+ * then only needs inversions in GF(2^4), which are 16-entry lookups
+ * done with pshufb on all the bytes at once, the value 0x80 standing
+ * for infinity as pshufb maps any index with its top bit set to 0.
+ * The S-box output, composed with the change of basis and with the
+ * doubling of MixColumns, is again a pair of 16-entry lookups. The
+ * constant of the affine transformation is folded into the round
+ * keys. No memory is indexed by secret data.
+ */
+
+/* Change from the AES basis to the state basis, images of the low
+ * and of the high nibble */
+static const uint8_t vpaes_ipt_lo[16] = {
+    0x00, 0x01, 0x37, 0x36, 0xD0, 0xD1, 0xE7, 0xE6,
+    0xD2, 0xD3, 0xE5, 0xE4, 0x02, 0x03, 0x35, 0x34
+};
+
+static const uint8_t vpaes_ipt_hi[16] = {
+    0x00, 0xBB, 0x7B, 0xC0, 0xBF, 0x04, 0xC4, 0x7F,
+    0xC8, 0x73, 0xB3, 0x08, 0x77, 0xCC, 0x0C, 0xB7
+};
+
+/* 1/x and a/x in GF(2^4), 0x80 being infinity */
+static const uint8_t vpaes_inv[16] = {
+    0x80, 0x01, 0x08, 0x0D, 0x0F, 0x06, 0x05, 0x0E,
+    0x02, 0x0C, 0x0B, 0x0A, 0x09, 0x03, 0x07, 0x04
+};
+
+static const uint8_t vpaes_inva[16] = {
+    0x80, 0x02, 0x01, 0x0C, 0x08, 0x0B, 0x0D, 0x0A,
+    0x04, 0x0E, 0x07, 0x05, 0x03, 0x06, 0x09, 0x0F
+};
+
+/* S-box outputs without the affine constant, indexed by io and jo:
+ * S in the state basis, 2.S in the state basis, S in the AES basis */
+static const uint8_t vpaes_sb1u[16] = {
+    0x00, 0x52, 0x21, 0x11, 0xEC, 0x9F, 0x30, 0xBE,
+    0xFD, 0x43, 0x8E, 0xDC, 0x73, 0xAF, 0xCD, 0x62
+};
+
+static const uint8_t vpaes_sb1t[16] = {
+    0x00, 0xC9, 0x98, 0xA0, 0xB4, 0xE5, 0x38, 0x7D,
+    0x14, 0x69, 0x45, 0x8C, 0x51, 0xDD, 0x2C, 0xF1
+};
+
+static const uint8_t vpaes_sb2u[16] = {
+    0x00, 0x38, 0x1C, 0x21, 0xC7, 0xE3, 0x3D, 0xFF,
+    0xE6, 0x19, 0xC2, 0xFA, 0x24, 0xDE, 0xDB, 0x05
+};
+
+static const uint8_t vpaes_sb2t[16] = {
+    0x00, 0x68, 0x0E, 0xA8, 0x0D, 0x6B, 0xA6, 0x65,
+    0xA5, 0xC0, 0xC3, 0xAB, 0x66, 0xCD, 0x03, 0xCE
+};
+
+static const uint8_t vpaes_sbou[16] = {
+    0x00, 0xFA, 0x6A, 0x35, 0xBB, 0x2B, 0x5F, 0x41,
+    0x8E, 0xCF, 0x1E, 0xE4, 0x90, 0x74, 0xD1, 0xA5
+};
+
+static const uint8_t vpaes_sbot[16] = {
+    0x00, 0x81, 0x76, 0x99, 0xFD, 0x0A, 0xEF, 0x7C,
+    0x64, 0x18, 0x93, 0x12, 0xF7, 0xE5, 0x8B, 0x6E
+};
+
+/* Change from the AES basis to the state basis of the inverse
+ * cipher, which includes the inverse of the affine transformation */
+static const uint8_t vpaes_dipt_lo[16] = {
+    0x00, 0x5A, 0xA3, 0xF9, 0xA8, 0xF2, 0x0B, 0x51,
+    0x33, 0x69, 0x90, 0xCA, 0x9B, 0xC1, 0x38, 0x62
+};
+
+static const uint8_t vpaes_dipt_hi[16] = {
+    0x00, 0x63, 0x6C, 0x0F, 0x44, 0x27, 0x28, 0x4B,
+    0xAA, 0xC9, 0xC6, 0xA5, 0xEE, 0x8D, 0x82, 0xE1
+};
+
+/* Inverse S-box outputs multiplied by 14, 11, 13 and 9 in the state
+ * basis, and in the AES basis */
+static const uint8_t vpaes_dsbeu[16] = {
+    0x00, 0xEB, 0xCD, 0x91, 0x3B, 0x1D, 0x5C, 0xD0,
+    0xAA, 0x7A, 0x8C, 0x67, 0x26, 0x41, 0xF6, 0xB7
+};
+
+static const uint8_t vpaes_dsbet[16] = {
+    0x00, 0xF7, 0xE1, 0xEF, 0xCB, 0xDD, 0x0E, 0x3C,
+    0x24, 0x18, 0x32, 0xC5, 0x16, 0xD3, 0x2A, 0xF9
+};
+
+static const uint8_t vpaes_dsbbu[16] = {
+    0x00, 0xF6, 0x8C, 0x3B, 0x1D, 0x67, 0xB7, 0xEB,
+    0x26, 0xCD, 0x5C, 0xAA, 0x7A, 0xD0, 0x91, 0x41
+};
+
+static const uint8_t vpaes_dsbbt[16] = {
+    0x00, 0x2A, 0x32, 0xCB, 0xDD, 0xC5, 0xF9, 0xF7,
+    0x16, 0xE1, 0x0E, 0x24, 0x18, 0x3C, 0xEF, 0xD3
+};
+
+static const uint8_t vpaes_dsbdu[16] = {
+    0x00, 0x2C, 0xF0, 0x52, 0x4E, 0x92, 0xA2, 0x62,
+    0x1C, 0x7E, 0xC0, 0xEC, 0xDC, 0x30, 0xBE, 0x8E
+};
+
+static const uint8_t vpaes_dsbdt[16] = {
+    0x00, 0x08, 0x07, 0x4A, 0xAF, 0xA0, 0x4D, 0xA7,
+    0xE5, 0x42, 0xEA, 0xE2, 0x0F, 0xED, 0xA8, 0x45
+};
+
+static const uint8_t vpaes_dsb9u[16] = {
+    0x00, 0x63, 0x13, 0x6A, 0x84, 0xF4, 0x79, 0xE7,
+    0xEE, 0x09, 0x9E, 0xFD, 0x70, 0x8D, 0x97, 0x1A
+};
+
+static const uint8_t vpaes_dsb9t[16] = {
+    0x00, 0x9F, 0x99, 0xCE, 0x5B, 0x5D, 0x57, 0xC4,
+    0x95, 0x51, 0x93, 0x0C, 0x06, 0x0A, 0xC2, 0xC8
+};
+
+static const uint8_t vpaes_dsbou[16] = {
+    0x00, 0x9C, 0x1D, 0x8E, 0x44, 0xC5, 0x93, 0xD8,
+    0xCA, 0x12, 0x4B, 0xD7, 0x81, 0x56, 0x59, 0x0F
+};
+
+static const uint8_t vpaes_dsbot[16] = {
+    0x00, 0x6F, 0xC2, 0x99, 0x6B, 0xC6, 0x5B, 0x04,
+    0xF2, 0xF6, 0x5F, 0x30, 0xAD, 0x9D, 0xA9, 0x34
+};
+
+/* ShiftRows, InvShiftRows and the rotation of the rows of each
+ * column by one byte */
+static const uint8_t vpaes_sr[16] = {
+    0x00, 0x05, 0x0A, 0x0F, 0x04, 0x09, 0x0E, 0x03,
+    0x08, 0x0D, 0x02, 0x07, 0x0C, 0x01, 0x06, 0x0B
+};
+
+static const uint8_t vpaes_isr[16] = {
+    0x00, 0x0D, 0x0A, 0x07, 0x04, 0x01, 0x0E, 0x0B,
+    0x08, 0x05, 0x02, 0x0F, 0x0C, 0x09, 0x06, 0x03
+};
+
+static const uint8_t vpaes_rot1[16] = {
+    0x01, 0x02, 0x03, 0x00, 0x05, 0x06, 0x07, 0x04,
+    0x09, 0x0A, 0x0B, 0x08, 0x0D, 0x0E, 0x0F, 0x0C
+};
+
+
+/* The constant 0x05 of the inverse affine transformation in the
+ * state basis of the inverse cipher */
+#define VPAES_C05       0xD1
+
+/* Number of blocks interleaved by the vector-permute backend */
+#define VPAES_PARALLEL_BLOCKS       4
+
+#define VPAES_LOAD(t)   _mm_loadu_si128((const __m128i *)vpaes_##t)
+
+/**
+ * @brief Applies the linear map given by its images of the low and
+ * high nibbles to each byte.
+ */
+VGP_TARGET("ssse3")
+static inline __m128i vpaes_transform(__m128i x, __m128i lo, __m128i hi)
+{
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    lo = _mm_shuffle_epi8(lo, _mm_and_si128(x, mask));
+    hi = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+
+    return _mm_xor_si128(lo, hi);
+}
+
+/**
+ * @brief Inverts each byte of the state in GF(2^8).
+ *
+ * With j = i + k, the inverse is given by the pair
+ * io = 1/(1/i + a/k) + j and jo = 1/(1/j + a/k) + i, which the
+ * output tables map to the result.
+ */
+VGP_TARGET("ssse3")
+static inline void vpaes_invert(__m128i x, __m128i *io, __m128i *jo)
 {
-    uint8_t expanded[240];
-    uint8_t state[16];
-    uint8_t new_state[16];
-    uint8_t a[4];
-    int32_t idx, round;
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i inv = VPAES_LOAD(inv);
+    __m128i i, j, k, ak, iak, jak;
 
-    expand_key(expanded, key);
+    i = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+    k = _mm_and_si128(x, mask);
+    j = _mm_xor_si128(i, k);
+    ak = _mm_shuffle_epi8(VPAES_LOAD(inva), k);
+    iak = _mm_xor_si128(_mm_shuffle_epi8(inv, i), ak);
+    jak = _mm_xor_si128(_mm_shuffle_epi8(inv, j), ak);
+    *io = _mm_xor_si128(_mm_shuffle_epi8(inv, iak), j);
+    *jo = _mm_xor_si128(_mm_shuffle_epi8(inv, jak), i);
+}
+
+VGP_TARGET("ssse3")
+static inline __m128i vpaes_output(__m128i io, __m128i jo, __m128i u, __m128i t)
+{
+    return _mm_xor_si128(_mm_shuffle_epi8(u, io), _mm_shuffle_epi8(t, jo));
+}
+
+/**
+ * @brief Computes the S-box of each byte, in the AES basis.
+ */
+VGP_TARGET("ssse3")
+static __m128i vpaes_sub_bytes(__m128i x)
+{
+    __m128i io, jo;
+
+    x = vpaes_transform(x, VPAES_LOAD(ipt_lo), VPAES_LOAD(ipt_hi));
+    vpaes_invert(x, &io, &jo);
+    x = vpaes_output(io, jo, VPAES_LOAD(sbou), VPAES_LOAD(sbot));
+
+    return _mm_xor_si128(x, _mm_set1_epi8(0x63));
+}
+
+/**
+ * @brief InvMixColumns in the AES basis, for the decryption keys.
+ */
+VGP_TARGET("ssse3")
+static __m128i vpaes_inv_mix_columns(__m128i x)
+{
+    const __m128i poly = _mm_set1_epi8(0x1B);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rot1 = VPAES_LOAD(rot1);
+    __m128i x2, x4, x8, t;
+
+    x2 = _mm_xor_si128(_mm_add_epi8(x, x),
+                       _mm_and_si128(_mm_cmplt_epi8(x, zero), poly));
+    x4 = _mm_xor_si128(_mm_add_epi8(x2, x2),
+                       _mm_and_si128(_mm_cmplt_epi8(x2, zero), poly));
+    x8 = _mm_xor_si128(_mm_add_epi8(x4, x4),
+                       _mm_and_si128(_mm_cmplt_epi8(x4, zero), poly));
 
-    for (idx = 0; idx < 4; ++idx)
+    /* 14.x + 11.rot1(x) + 13.rot2(x) + 9.rot3(x) */
+    t = _mm_xor_si128(_mm_xor_si128(x8, x4), x);
+    t = _mm_xor_si128(_mm_shuffle_epi8(_mm_xor_si128(x8, x), rot1), t);
+    t = _mm_xor_si128(_mm_shuffle_epi8(t, rot1),
+                      _mm_xor_si128(_mm_xor_si128(x8, x2), x));
+    t = _mm_xor_si128(_mm_shuffle_epi8(t, rot1),
+                      _mm_xor_si128(_mm_xor_si128(x8, x4), x2));
+
+    return t;
+}
+
+#define VPAES_SLIDE(x) \
+    x = _mm_xor_si128(x, _mm_slli_si128(x, 4)); \
+    x = _mm_xor_si128(x, _mm_slli_si128(x, 8));
+
+/**
+ * @brief Vector-permute key expansion. The encryption round keys, in
+ * the basis of the state, are followed by the decryption round keys
+ * of the equivalent inverse cipher.
+ */
+VGP_TARGET("ssse3")
+static void vpaes_init(aes256_key_schedule *ctx, const uint8_t *key)
+{
+    const __m128i rot_word = _mm_setr_epi8(13, 14, 15, 12, 13, 14, 15, 12,
+                                           13, 14, 15, 12, 13, 14, 15, 12);
+    const __m128i word = _mm_setr_epi8(12, 13, 14, 15, 12, 13, 14, 15,
+                                       12, 13, 14, 15, 12, 13, 14, 15);
+    const __m128i c63 = _mm_set1_epi8(0x63);
+    const __m128i c05 = _mm_set1_epi8((char)VPAES_C05);
+    __m128i rk[AES256_ROUNDS + 1];
+    __m128i t1, t2, t3;
+    int32_t i, rcon;
+
+    t1 = _mm_loadu_si128((const __m128i *)key);
+    t3 = _mm_loadu_si128((const __m128i *)(key + 16));
+    rk[0] = t1;
+    rk[1] = t3;
+    for (i = 2, rcon = 1; i <= AES256_ROUNDS; i += 2, rcon <<= 1)
     {
-        state[     idx] = in[4*idx]     ^ expanded[      idx];
-        state[ 4 + idx] = in[4*idx + 1] ^ expanded[ 60 + idx];
-        state[ 8 + idx] = in[4*idx + 2] ^ expanded[120 + idx];
-        state[12 + idx] = in[4*idx + 3] ^ expanded[180 + idx];
+        t2 = _mm_shuffle_epi8(vpaes_sub_bytes(t3), rot_word);
+        t2 = _mm_xor_si128(t2, _mm_set1_epi32(rcon));
+        VPAES_SLIDE(t1);
+        t1 = _mm_xor_si128(t1, t2);
+        rk[i] = t1;
+        if (i == AES256_ROUNDS)
+        {
+            break;
+        }
+        t2 = _mm_shuffle_epi8(vpaes_sub_bytes(t1), word);
+        VPAES_SLIDE(t3);
+        t3 = _mm_xor_si128(t3, t2);
+        rk[i + 1] = t3;
     }
 
-    for (round = 0; round < 14; ++round)
+    for (i = 0; i <= AES256_ROUNDS; ++i)
     {
-        for (idx = 0; idx < 4; ++idx) 
+        if (i == 0)
         {
-            new_state[4*idx    ] = byte_sub(state[4*idx    ]);
-            new_state[4*idx + 1] = byte_sub(state[4*idx + 1]);
-            new_state[4*idx + 2] = byte_sub(state[4*idx + 2]);
-            new_state[4*idx + 3] = byte_sub(state[4*idx + 3]);
+            t1 = vpaes_transform(rk[0], VPAES_LOAD(ipt_lo), VPAES_LOAD(ipt_hi));
         }
-        for (idx = 0; idx < 4; ++idx) 
+        else if (i == AES256_ROUNDS)
         {
-            state[4*idx    ] = new_state[4*idx + idx];
-            state[4*idx + 1] = new_state[4*idx + ((1 + idx) & 3)];
-            state[4*idx + 2] = new_state[4*idx + ((2 + idx) & 3)];
-            state[4*idx + 3] = new_state[4*idx + ((3 + idx) & 3)];
+            t1 = _mm_xor_si128(rk[AES256_ROUNDS], c63);
         }
-        if (round < 13) 
+        else
         {
-            for (idx = 0; idx < 4; ++idx)
-            {
-                a[0] = state[     idx];
-                a[1] = state[ 4 + idx];
-                a[2] = state[ 8 + idx];
-                a[3] = state[12 + idx];
-                state[     idx] = dbl(a[0] ^ a[1]) ^ a[1] ^ a[2] ^ a[3];
-                state[ 4 + idx] = dbl(a[1] ^ a[2]) ^ a[2] ^ a[3] ^ a[0];
-                state[ 8 + idx] = dbl(a[2] ^ a[3]) ^ a[3] ^ a[0] ^ a[1];
-                state[12 + idx] = dbl(a[3] ^ a[0]) ^ a[0] ^ a[1] ^ a[2];
-            }
+            t1 = vpaes_transform(_mm_xor_si128(rk[i], c63),
+                                 VPAES_LOAD(ipt_lo),
+                                 VPAES_LOAD(ipt_hi));
         }
-        for (idx = 0; idx < 4; ++idx)
+        _mm_storeu_si128((__m128i *)ctx->keys.rk + i, t1);
+    }
+
+    for (i = 0; i <= AES256_ROUNDS; ++i)
+    {
+        if (i == 0)
+        {
+            t1 = vpaes_transform(rk[AES256_ROUNDS],
+                                 VPAES_LOAD(dipt_lo),
+                                 VPAES_LOAD(dipt_hi));
+            t1 = _mm_xor_si128(t1, c05);
+        }
+        else if (i == AES256_ROUNDS)
+        {
+            t1 = rk[0];
+        }
+        else
         {
-            state[4*idx    ] ^= expanded[60*idx + (4 * round + 4)];
-            state[4*idx + 1] ^= expanded[60*idx + (4 * round + 5)];
-            state[4*idx + 2] ^= expanded[60*idx + (4 * round + 6)];
-            state[4*idx + 3] ^= expanded[60*idx + (4 * round + 7)];
+            t1 = vpaes_transform(vpaes_inv_mix_columns(rk[AES256_ROUNDS - i]),
+                                 VPAES_LOAD(dipt_lo),
+                                 VPAES_LOAD(dipt_hi));
+            t1 = _mm_xor_si128(t1, c05);
         }
+        _mm_storeu_si128((__m128i *)ctx->keys.rk + AES256_ROUNDS + 1 + i, t1);
     }
 
-    out[ 0] = state[0]; out[ 1] = state[4]; out[ 2] = state[8];  out[ 3] = state[12];
-    out[ 4] = state[1]; out[ 5] = state[5]; out[ 6] = state[9];  out[ 7] = state[13];
-    out[ 8] = state[2]; out[ 9] = state[6]; out[10] = state[10]; out[11] = state[14];
-    out[12] = state[3]; out[13] = state[7]; out[14] = state[11]; out[15] = state[15];
+    crypto_memzero(rk, sizeof(rk));
 }
 
-void aes256_bitslice_decrypt(uint8_t *out,
-                             const uint8_t *in,
-                             const uint8_t *key)
+/**
+ * @brief A middle encryption round: ShiftRows, SubBytes, MixColumns
+ * and AddRoundKey.
+ */
+VGP_TARGET("ssse3")
+static inline __m128i vpaes_encrypt_round(__m128i x, __m128i rk)
+{
+    const __m128i rot1 = VPAES_LOAD(rot1);
+    __m128i io, jo, a, a2, t;
+
+    x = _mm_shuffle_epi8(x, VPAES_LOAD(sr));
+    vpaes_invert(x, &io, &jo);
+    a = vpaes_output(io, jo, VPAES_LOAD(sb1u), VPAES_LOAD(sb1t));
+    a2 = vpaes_output(io, jo, VPAES_LOAD(sb2u), VPAES_LOAD(sb2t));
+
+    /* 2.a + 3.rot1(a) + rot2(a) + rot3(a) */
+    t = _mm_xor_si128(a, _mm_shuffle_epi8(a, rot1));
+    t = _mm_xor_si128(_mm_xor_si128(a2, a), _mm_shuffle_epi8(t, rot1));
+    t = _mm_xor_si128(a2, _mm_shuffle_epi8(t, rot1));
+
+    return _mm_xor_si128(t, rk);
+}
+
+/**
+ * @brief A middle round of the equivalent inverse cipher:
+ * InvShiftRows, InvSubBytes, InvMixColumns and AddRoundKey.
+ */
+VGP_TARGET("ssse3")
+static inline __m128i vpaes_decrypt_round(__m128i x, __m128i rk)
+{
+    const __m128i rot1 = VPAES_LOAD(rot1);
+    __m128i io, jo, t;
+
+    x = _mm_shuffle_epi8(x, VPAES_LOAD(isr));
+    vpaes_invert(x, &io, &jo);
+
+    /* 14.a + 11.rot1(a) + 13.rot2(a) + 9.rot3(a) */
+    t = vpaes_output(io, jo, VPAES_LOAD(dsb9u), VPAES_LOAD(dsb9t));
+    t = _mm_xor_si128(_mm_shuffle_epi8(t, rot1),
+                      vpaes_output(io, jo, VPAES_LOAD(dsbdu), VPAES_LOAD(dsbdt)));
+    t = _mm_xor_si128(_mm_shuffle_epi8(t, rot1),
+                      vpaes_output(io, jo, VPAES_LOAD(dsbbu), VPAES_LOAD(dsbbt)));
+    t = _mm_xor_si128(_mm_shuffle_epi8(t, rot1),
+                      vpaes_output(io, jo, VPAES_LOAD(dsbeu), VPAES_LOAD(dsbet)));
+
+    return _mm_xor_si128(t, rk);
+}
+
+VGP_TARGET("ssse3")
+static void vpaes_encrypt_blocks(const aes256_key_schedule *ctx,
+                                 uint8_t *out,
+                                 const uint8_t *in,
+                                 size_t num_blocks)
 {
-    uint8_t expanded[240];
-    uint8_t state[16];
-    uint8_t new_state[16];
-    uint8_t a0, a1, a2, a3;
-    int32_t idx, round;
+    const __m128i *ek = (const __m128i *)ctx->keys.rk;
+    __m128i b[VPAES_PARALLEL_BLOCKS];
+    __m128i rk, io, jo;
+    size_t i, n;
+    int32_t round;
 
-    expand_key(expanded, key);
+    /* The blocks of a batch go through each round together so that
+     * their lookups overlap */
+    while (num_blocks > 0)
+    {
+        n = num_blocks;
+        if (n > VPAES_PARALLEL_BLOCKS)
+        {
+            n = VPAES_PARALLEL_BLOCKS;
+        }
+
+        rk = _mm_loadu_si128(ek);
+        for (i = 0; i < n; ++i)
+        {
+            b[i] = vpaes_transform(_mm_loadu_si128((const __m128i *)in + i),
+                                   VPAES_LOAD(ipt_lo),
+                                   VPAES_LOAD(ipt_hi));
+            b[i] = _mm_xor_si128(b[i], rk);
+        }
+        for (round = 1; round < AES256_ROUNDS; ++round)
+        {
+            rk = _mm_loadu_si128(ek + round);
+            for (i = 0; i < n; ++i)
+            {
+                b[i] = vpaes_encrypt_round(b[i], rk);
+            }
+        }
+        rk = _mm_loadu_si128(ek + AES256_ROUNDS);
+        for (i = 0; i < n; ++i)
+        {
+            vpaes_invert(_mm_shuffle_epi8(b[i], VPAES_LOAD(sr)), &io, &jo);
+            b[i] = vpaes_output(io, jo, VPAES_LOAD(sbou), VPAES_LOAD(sbot));
+            _mm_storeu_si128((__m128i *)out + i, _mm_xor_si128(b[i], rk));
+        }
 
-    for (idx = 0; idx < 4; ++idx)
+        in += n * AES256_BLOCK_SIZE;
+        out += n * AES256_BLOCK_SIZE;
+        num_blocks -= n;
+    }
+}
+
+VGP_TARGET("ssse3")
+static void vpaes_decrypt_blocks(const aes256_key_schedule *ctx,
+                                 uint8_t *out,
+                                 const uint8_t *in,
+                                 size_t num_blocks)
+{
+    const __m128i *dk = (const __m128i *)ctx->keys.rk + AES256_ROUNDS + 1;
+    __m128i b[VPAES_PARALLEL_BLOCKS];
+    __m128i rk, io, jo;
+    size_t i, n;
+    int32_t round;
+
+    while (num_blocks > 0)
     {
-        state[     idx] = in[4*idx];
-        state[ 4 + idx] = in[4*idx + 1];
-        state[ 8 + idx] = in[4*idx + 2];
-        state[12 + idx] = in[4*idx + 3];
+        n = num_blocks;
+        if (n > VPAES_PARALLEL_BLOCKS)
+        {
+            n = VPAES_PARALLEL_BLOCKS;
+        }
+
+        rk = _mm_loadu_si128(dk);
+        for (i = 0; i < n; ++i)
+        {
+            b[i] = vpaes_transform(_mm_loadu_si128((const __m128i *)in + i),
+                                   VPAES_LOAD(dipt_lo),
+                                   VPAES_LOAD(dipt_hi));
+            b[i] = _mm_xor_si128(b[i], rk);
+        }
+        for (round = 1; round < AES256_ROUNDS; ++round)
+        {
+            rk = _mm_loadu_si128(dk + round);
+            for (i = 0; i < n; ++i)
+            {
+                b[i] = vpaes_decrypt_round(b[i], rk);
+            }
+        }
+        rk = _mm_loadu_si128(dk + AES256_ROUNDS);
+        for (i = 0; i < n; ++i)
+        {
+            vpaes_invert(_mm_shuffle_epi8(b[i], VPAES_LOAD(isr)), &io, &jo);
+            b[i] = vpaes_output(io, jo, VPAES_LOAD(dsbou), VPAES_LOAD(dsbot));
+            _mm_storeu_si128((__m128i *)out + i, _mm_xor_si128(b[i], rk));
+        }
+
+        in += n * AES256_BLOCK_SIZE;
+        out += n * AES256_BLOCK_SIZE;
+        num_blocks -= n;
     }
+}
+
+#endif
+
+/**
+ * @brief Expands up to AES256_PARALLEL_BLOCKS keys into 60 words each.
+ *
+ * The keys are expanded side by side so that the S-box of the key
+ * schedule is computed with the bit-sliced S-box once for all of
+ * them, and no table lookup is involved.
+ */
+static void expand_keys(uint32_t (*skey)[60],
+                        const uint8_t *keys,
+                        size_t num_keys)
+{
+    static const uint8_t round_constant[7] = {
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40
+    };
+    uint32_t tmp[AES256_PARALLEL_BLOCKS];
+    size_t n;
+    int32_t i, j, k;
 
-    for (round = 13; round >= 0; --round)
+    for (n = 0; n < num_keys; ++n)
     {
-        for (idx = 0; idx < 4; ++idx)
+        for (i = 0; i < 8; ++i)
         {
-            state[4*idx    ] ^= expanded[60*idx + (4*round + 4)];
-            state[4*idx + 1] ^= expanded[60*idx + (4*round + 5)];
-            state[4*idx + 2] ^= expanded[60*idx + (4*round + 6)];
-            state[4*idx + 3] ^= expanded[60*idx + (4*round + 7)];
+            skey[n][i] = little_endian_load32(keys + AES256_KEY_SIZE * n + 4 * i);
         }
-        if (round < 13) 
+        tmp[n] = skey[n][7];
+    }
+
+    for (i = 8, j = 0, k = 0; i < 60; ++i)
+    {
+        if (j == 0)
         {
-            for (idx = 0; idx < 4; ++idx)
+            for (n = 0; n < num_keys; ++n)
+            {
+                tmp[n] = (tmp[n] << 24) | (tmp[n] >> 8);
+            }
+            sub_words(tmp, num_keys);
+            for (n = 0; n < num_keys; ++n)
             {
-                a0 = state[     idx];
-                a1 = state[ 4 + idx];
-                a2 = state[ 8 + idx];
-                a3 = state[12 + idx];
-                state[     idx] = mult(a1, 11) ^ mult(a2, 13) ^ mult(a3, 9) ^ mult(a0, 14);
-                state[ 4 + idx] = mult(a2, 11) ^ mult(a3, 13) ^ mult(a0, 9) ^ mult(a1, 14);
-                state[ 8 + idx] = mult(a3, 11) ^ mult(a0, 13) ^ mult(a1, 9) ^ mult(a2, 14);
-                state[12 + idx] = mult(a0, 11) ^ mult(a1, 13) ^ mult(a2, 9) ^ mult(a3, 14);
+                tmp[n] ^= round_constant[k];
             }
         }
-        for (idx = 0; idx < 4; ++idx) 
+        else if (j == 4)
+        {
+            sub_words(tmp, num_keys);
+        }
+        for (n = 0; n < num_keys; ++n)
+        {
+            tmp[n] ^= skey[n][i - 8];
+            skey[n][i] = tmp[n];
+        }
+        if (++j == 8)
+        {
+            j = 0;
+            ++k;
+        }
+    }
+
+    crypto_memzero(tmp, sizeof(tmp));
+}
+
+/**
+ * @brief Bit-sliced key schedule of up to AES256_PARALLEL_BLOCKS keys,
+ * where block lane n is encrypted under key n. Missing keys are left
+ * as zeros.
+ */
+static void bitslice_init_lanes(aes256_key_schedule *ctx,
+                                const uint8_t *keys,
+                                size_t num_keys)
+{
+    uint32_t skey[AES256_PARALLEL_BLOCKS][60];
+    uint64_t q[8];
+    size_t n;
+    int32_t i, j;
+
+    memset(skey, 0, sizeof(skey));
+    expand_keys(skey, keys, num_keys);
+
+    for (i = 0; i < 60; i += 4)
+    {
+        for (n = 0; n < AES256_PARALLEL_BLOCKS; ++n)
+        {
+            interleave_in(&q[n], &q[n + 4], skey[n] + i);
+        }
+        ortho(q);
+        for (j = 0; j < 8; ++j)
+        {
+            ctx->keys.sk[2 * i + j] = q[j];
+        }
+    }
+    ctx->backend = AES256_BACKEND_BITSLICE;
+
+    crypto_memzero(skey, sizeof(skey));
+    crypto_memzero(q, sizeof(q));
+}
+
+/**
+ * @brief Bit-sliced key expansion, each round key is replicated into
+ * the four block lanes.
+ */
+static void bitslice_init(aes256_key_schedule *ctx, const uint8_t *key)
+{
+    uint8_t keys[AES256_PARALLEL_BLOCKS * AES256_KEY_SIZE];
+    size_t n;
+
+    for (n = 0; n < AES256_PARALLEL_BLOCKS; ++n)
+    {
+        memcpy(keys + AES256_KEY_SIZE * n, key, AES256_KEY_SIZE);
+    }
+    bitslice_init_lanes(ctx, keys, AES256_PARALLEL_BLOCKS);
+
+    crypto_memzero(keys, sizeof(keys));
+}
+
+void aes256_init(aes256_key_schedule *ctx, const uint8_t *key)
+{
+#if defined(VGP_X86_INTRINSICS)
+    if (cpu_features() & CPU_FEATURE_AESNI)
+    {
+        ctx->backend = AES256_BACKEND_AESNI;
+        aesni_init(ctx, key);
+        return;
+    }
+    if (cpu_features() & CPU_FEATURE_SSSE3)
+    {
+        ctx->backend = AES256_BACKEND_VPAES;
+        vpaes_init(ctx, key);
+        return;
+    }
+#endif
+    bitslice_init(ctx, key);
+}
+
+void aes256_encrypt_blocks(const aes256_key_schedule *ctx,
+                           uint8_t *out,
+                           const uint8_t *in,
+                           size_t num_blocks)
+{
+    uint64_t q[8];
+    size_t n;
+
+#if defined(VGP_X86_INTRINSICS)
+    if (ctx->backend == AES256_BACKEND_AESNI)
+    {
+        aesni_encrypt_blocks(ctx, out, in, num_blocks);
+        return;
+    }
+    if (ctx->backend == AES256_BACKEND_VPAES)
+    {
+        vpaes_encrypt_blocks(ctx, out, in, num_blocks);
+        return;
+    }
+#endif
+
+    while (num_blocks > 0)
+    {
+        n = num_blocks;
+        if (n > AES256_PARALLEL_BLOCKS)
+        {
+            n = AES256_PARALLEL_BLOCKS;
+        }
+
+        load_blocks(q, in, n);
+        bitslice_encrypt(ctx->keys.sk, q);
+        store_blocks(out, q, n);
+
+        in += n * AES256_BLOCK_SIZE;
+        out += n * AES256_BLOCK_SIZE;
+        num_blocks -= n;
+    }
+
+    crypto_memzero(q, sizeof(q));
+}
+
+void aes256_decrypt_blocks(const aes256_key_schedule *ctx,
+                           uint8_t *out,
+                           const uint8_t *in,
+                           size_t num_blocks)
+{
+    uint64_t q[8];
+    size_t n;
+
+#if defined(VGP_X86_INTRINSICS)
+    if (ctx->backend == AES256_BACKEND_AESNI)
+    {
+        aesni_decrypt_blocks(ctx, out, in, num_blocks);
+        return;
+    }
+    if (ctx->backend == AES256_BACKEND_VPAES)
+    {
+        vpaes_decrypt_blocks(ctx, out, in, num_blocks);
+        return;
+    }
+#endif
+
+    while (num_blocks > 0)
+    {
+        n = num_blocks;
+        if (n > AES256_PARALLEL_BLOCKS)
         {
-            new_state[4*idx    ] = state[4*idx + ((4 - idx) & 3)];             
-            new_state[4*idx + 1] = state[4*idx + ((5 - idx) & 3)];             
-            new_state[4*idx + 2] = state[4*idx + ((6 - idx) & 3)];             
-            new_state[4*idx + 3] = state[4*idx + ((7 - idx) & 3)];             
+            n = AES256_PARALLEL_BLOCKS;
         }
-        for (idx = 0; idx < 4; ++idx) 
+
+        load_blocks(q, in, n);
+        bitslice_decrypt(ctx->keys.sk, q);
+        store_blocks(out, q, n);
+
+        in += n * AES256_BLOCK_SIZE;
+        out += n * AES256_BLOCK_SIZE;
+        num_blocks -= n;
+    }
+
+    crypto_memzero(q, sizeof(q));
+}
+
+void aes256_encrypt_block(const aes256_key_schedule *ctx,
+                          uint8_t *out,
+                          const uint8_t *in)
+{
+    aes256_encrypt_blocks(ctx, out, in, 1);
+}
+
+void aes256_decrypt_block(const aes256_key_schedule *ctx,
+                          uint8_t *out,
+                          const uint8_t *in)
+{
+    aes256_decrypt_blocks(ctx, out, in, 1);
+}
+
+void aes256_bitslice_encrypt(uint8_t *out,
+                             const uint8_t *in,
+                             const uint8_t *key)
+{
+    aes256_key_schedule ctx;
+
+    aes256_init(&ctx, key);
+    aes256_encrypt_block(&ctx, out, in);
+
+    crypto_memzero(&ctx, sizeof(ctx));
+}
+
+void aes256_bitslice_decrypt(uint8_t *out,
+                             const uint8_t *in,
+                             const uint8_t *key)
+{
+    aes256_key_schedule ctx;
+
+    aes256_init(&ctx, key);
+    aes256_decrypt_block(&ctx, out, in);
+
+    crypto_memzero(&ctx, sizeof(ctx));
+}
+
+void aes256_encrypt_multi_key(uint8_t *out,
+                              const uint8_t *in,
+                              const uint8_t *keys,
+                              size_t num_keys,
+                              size_t num_blocks)
+{
+    aes256_key_schedule ctx;
+    uint8_t buf[AES256_PARALLEL_BLOCKS * AES256_BLOCK_SIZE];
+    uint64_t q[8];
+    size_t i, j, n, group, stride = num_blocks * AES256_BLOCK_SIZE;
+
+#if defined(VGP_X86_INTRINSICS)
+    if (cpu_features() & (CPU_FEATURE_AESNI | CPU_FEATURE_SSSE3))
+    {
+        /* The AES-NI and vector-permute key expansions are cheap,
+         * one key at a time beats sharing them in the multi-key
+         * bit-sliced kernel. */
+        for (n = 0; n < num_keys; ++n)
         {
-            state[4*idx    ] = inv_byte_sub(new_state[4*idx    ]);
-            state[4*idx + 1] = inv_byte_sub(new_state[4*idx + 1]);
-            state[4*idx + 2] = inv_byte_sub(new_state[4*idx + 2]);
-            state[4*idx + 3] = inv_byte_sub(new_state[4*idx + 3]);
+            aes256_init(&ctx, keys + AES256_KEY_SIZE * n);
+            aes256_encrypt_blocks(&ctx, out + stride * n, in + stride * n, num_blocks);
         }
+        crypto_memzero(&ctx, sizeof(ctx));
+        return;
     }
+#endif
 
-    for (idx = 0; idx < 4; ++idx) 
+    for (n = 0; n < num_keys; n += group)
     {
-        state[     idx] ^= expanded[      idx];
-        state[ 4 + idx] ^= expanded[ 60 + idx];       
-        state[ 8 + idx] ^= expanded[120 + idx];
-        state[12 + idx] ^= expanded[180 + idx];
+        group = num_keys - n;
+        if (group > AES256_PARALLEL_BLOCKS)
+        {
+            group = AES256_PARALLEL_BLOCKS;
+        }
+        bitslice_init_lanes(&ctx, keys + AES256_KEY_SIZE * n, group);
+
+        /* Block i of each key goes to the lane of the key */
+        for (i = 0; i < num_blocks; ++i)
+        {
+            for (j = 0; j < group; ++j)
+            {
+                memcpy(buf + AES256_BLOCK_SIZE * j,
+                       in + stride * (n + j) + AES256_BLOCK_SIZE * i,
+                       AES256_BLOCK_SIZE);
+            }
+            load_blocks(q, buf, group);
+            bitslice_encrypt(ctx.keys.sk, q);
+            store_blocks(buf, q, group);
+            for (j = 0; j < group; ++j)
+            {
+                memcpy(out + stride * (n + j) + AES256_BLOCK_SIZE * i,
+                       buf + AES256_BLOCK_SIZE * j,
+                       AES256_BLOCK_SIZE);
+            }
+        }
     }
 
-    out[ 0] = state[0]; out[ 1] = state[4]; out[ 2] = state[ 8]; out[ 3] = state[12];
-    out[ 4] = state[1]; out[ 5] = state[5]; out[ 6] = state[ 9]; out[ 7] = state[13];
-    out[ 8] = state[2]; out[ 9] = state[6]; out[10] = state[10]; out[11] = state[14];
-    out[12] = state[3]; out[13] = state[7]; out[14] = state[11]; out[15] = state[15];
+    crypto_memzero(&ctx, sizeof(ctx));
+    crypto_memzero(buf, sizeof(buf));
+    crypto_memzero(q, sizeof(q));
 }
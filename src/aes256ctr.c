@@ -1,90 +1,149 @@
 // Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
 // See LICENSE.md file for license, copying and use information.
 
+#include <string.h>
 #include "aes256ctr.h"
 #include "aes256.h"
 #include "utils.h"
 
-static inline uint8_t ct_eq_ff(uint8_t u)
+static uint64_t big_endian_load64(const uint8_t *x)
 {
-    uint8_t v = u ^ (uint8_t)0xff;
-    return ((uint8_t)(v | -v) >> 7) ^ 0x01;
+    return ((uint64_t)x[0] << 56) | ((uint64_t)x[1] << 48) |
+           ((uint64_t)x[2] << 40) | ((uint64_t)x[3] << 32) |
+           ((uint64_t)x[4] << 24) | ((uint64_t)x[5] << 16) |
+           ((uint64_t)x[6] <<  8) |  (uint64_t)x[7];
+}
+
+static void big_endian_store64(uint8_t *x, uint64_t u)
+{
+    x[7] = u & 0xFF; u >>= 8;
+    x[6] = u & 0xFF; u >>= 8;
+    x[5] = u & 0xFF; u >>= 8;
+    x[4] = u & 0xFF; u >>= 8;
+    x[3] = u & 0xFF; u >>= 8;
+    x[2] = u & 0xFF; u >>= 8;
+    x[1] = u & 0xFF; u >>= 8;
+    x[0] = u & 0xFF;
 }
 
 /**
- * @brief Increment counter.
- * 
- * The counter wraps around if it exceeds maximum value.
- * 
- * @param ctr a 16-byte array of counter in big-endian
+ * @brief Writes the counter blocks iv + block, ..., iv + block + n - 1.
+ *
+ * The counter block of keystream block n is iv + n modulo 2^128. It
+ * is computed once with a 64-bit addition whose carry is propagated
+ * into the high word without branching, and each further block adds
+ * one to the low word in the same way.
  */
-static void increment_counter(uint8_t *ctr)
+static void store_counters(uint8_t *out,
+                           uint64_t iv_hi,
+                           uint64_t iv_lo,
+                           uint64_t block,
+                           size_t num_blocks)
 {
-    uint8_t value, carry;
-
-    value   = 0x01;
-    carry   = ct_eq_ff(ctr[15]);
-    ctr[15] = ctr[15] + value;
-
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[14]);
-    ctr[14] = ctr[14] + value;
-
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[13]);
-    ctr[13] = ctr[13] + value;
-
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[12]);
-    ctr[12] = ctr[12] + value;
+    uint64_t hi, lo;
+    size_t i;
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[11]);
-    ctr[11] = ctr[11] + value;
+    lo = iv_lo + block;
+    hi = iv_hi + (((iv_lo & block) | ((iv_lo | block) & ~lo)) >> 63);
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[10]);
-    ctr[10] = ctr[10] + value;
+    for (i = 0; i < num_blocks; ++i)
+    {
+        big_endian_store64(out + i * AES256_BLOCK_SIZE, hi);
+        big_endian_store64(out + i * AES256_BLOCK_SIZE + 8, lo);
+        lo += 1;
+        hi += ((lo | (0 - lo)) >> 63) ^ 1;
+    }
+}
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 9]);
-    ctr[ 9] = ctr[ 9] + value;
+/**
+ * @brief Generates the next batch of keystream blocks.
+ */
+static void ctr_generate(aes256ctr_ctx *ctx, size_t num_blocks)
+{
+    store_counters(ctx->stream, ctx->iv_hi, ctx->iv_lo, ctx->block, num_blocks);
+    aes256_encrypt_blocks(&ctx->key, ctx->stream, ctx->stream, num_blocks);
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 8]);
-    ctr[ 8] = ctr[ 8] + value;
+    ctx->block += num_blocks;
+    ctx->stream_pos = 0;
+    ctx->stream_len = num_blocks * AES256_BLOCK_SIZE;
+}
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 7]);
-    ctr[ 7] = ctr[ 7] + value;
+/**
+ * @brief Computes out = in ^ stream, 64 bits at a time.
+ */
+static void ctr_xor(uint8_t *out,
+                    const uint8_t *in,
+                    const uint8_t *stream,
+                    size_t len)
+{
+    uint64_t x, y;
+    size_t i;
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 6]);
-    ctr[ 6] = ctr[ 6] + value;
+    for (i = 0; i + 8 <= len; i += 8)
+    {
+        memcpy(&x, in + i, 8);
+        memcpy(&y, stream + i, 8);
+        x ^= y;
+        memcpy(out + i, &x, 8);
+    }
+    for (; i < len; ++i)
+    {
+        out[i] = in[i] ^ stream[i];
+    }
+}
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 5]);
-    ctr[ 5] = ctr[ 5] + value;
+void aes256ctr_init(aes256ctr_ctx *ctx,
+                    const uint8_t *key,
+                    const uint8_t *iv)
+{
+    aes256_init(&ctx->key, key);
+    ctx->iv_hi = big_endian_load64(iv);
+    ctx->iv_lo = big_endian_load64(iv + 8);
+    aes256ctr_seek(ctx, 0);
+}
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 4]);
-    ctr[ 4] = ctr[ 4] + value;
+void aes256ctr_seek(aes256ctr_ctx *ctx, uint64_t block_offset)
+{
+    ctx->block = block_offset;
+    ctx->stream_pos = 0;
+    ctx->stream_len = 0;
+}
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 3]);
-    ctr[ 3] = ctr[ 3] + value;
+void aes256ctr_update(aes256ctr_ctx *ctx,
+                      uint8_t *out,
+                      const uint8_t *in,
+                      size_t len)
+{
+    size_t n, num_blocks;
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 2]);
-    ctr[ 2] = ctr[ 2] + value;
+    while (len > 0)
+    {
+        if (ctx->stream_pos == ctx->stream_len)
+        {
+            num_blocks = (len + AES256_BLOCK_SIZE - 1) / AES256_BLOCK_SIZE;
+            if (num_blocks > AES256CTR_BATCH_BLOCKS)
+            {
+                num_blocks = AES256CTR_BATCH_BLOCKS;
+            }
+            ctr_generate(ctx, num_blocks);
+        }
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 1]);
-    ctr[ 1] = ctr[ 1] + value;
+        n = ctx->stream_len - ctx->stream_pos;
+        if (n > len)
+        {
+            n = len;
+        }
+        ctr_xor(out, in, ctx->stream + ctx->stream_pos, n);
+        ctx->stream_pos += n;
+        out += n;
+        in += n;
+        len -= n;
+    }
+}
 
-    value   = carry;
-    carry  &= ct_eq_ff(ctr[ 0]);
-    ctr[ 0] = ctr[ 0] + value;
+void aes256ctr_final(aes256ctr_ctx *ctx)
+{
+    crypto_memzero(ctx, sizeof(aes256ctr_ctx));
 }
 
 int32_t aes256ctr_encrypt(uint8_t *c,
@@ -94,43 +153,69 @@ int32_t aes256ctr_encrypt(uint8_t *c,
                           const uint8_t *iv,
                           const uint8_t *key)
 {
-    uint8_t T[AES256CTR_IV_SIZE];
-    uint8_t stream[16];
-    size_t i, block_len;
-
-    for (i = 0; i < AES256CTR_IV_SIZE; i++)
-    {
-        T[i] = iv[i];
-    }
+    aes256ctr_ctx ctx;
 
+    aes256ctr_init(&ctx, key, iv);
+    aes256ctr_update(&ctx, c, msg, msg_len);
     *c_len = msg_len;
-    while (msg_len > 0)
+    aes256ctr_final(&ctx);
+
+    return 0;
+}
+
+void aes256ctr_encrypt_multi_key(uint8_t *c,
+                                  const uint8_t *msg,
+                                  size_t msg_len,
+                                  const uint8_t *ivs,
+                                  const uint8_t *keys,
+                                  size_t num_keys)
+{
+    uint8_t stream[AES256_PARALLEL_BLOCKS * AES256CTR_BATCH_BLOCKS * AES256_BLOCK_SIZE];
+    size_t i, n, group, offset, len, num_blocks;
+
+    for (n = 0; n < num_keys; n += group)
     {
-        block_len = 16;
-        if (msg_len < block_len) 
+        group = num_keys - n;
+        if (group > AES256_PARALLEL_BLOCKS)
         {
-            block_len = msg_len;
+            group = AES256_PARALLEL_BLOCKS;
         }
-        
-        aes256_bitslice_encrypt(stream, T, key);
 
-        for (i = 0; i < block_len; ++i)
+        for (offset = 0; offset < msg_len; offset += len)
         {
-            c[i] = msg[i] ^ stream[i];
+            len = msg_len - offset;
+            if (len > AES256CTR_BATCH_BLOCKS * AES256_BLOCK_SIZE)
+            {
+                len = AES256CTR_BATCH_BLOCKS * AES256_BLOCK_SIZE;
+            }
+            num_blocks = (len + AES256_BLOCK_SIZE - 1) / AES256_BLOCK_SIZE;
+
+            for (i = 0; i < group; ++i)
+            {
+                store_counters(stream + i * num_blocks * AES256_BLOCK_SIZE,
+                               big_endian_load64(ivs + (n + i) * AES256CTR_IV_SIZE),
+                               big_endian_load64(ivs + (n + i) * AES256CTR_IV_SIZE + 8),
+                               offset / AES256_BLOCK_SIZE,
+                               num_blocks);
+            }
+            aes256_encrypt_multi_key(stream,
+                                     stream,
+                                     keys + n * AES256CTR_KEY_SIZE,
+                                     group,
+                                     num_blocks);
+            for (i = 0; i < group; ++i)
+            {
+                ctr_xor(c + (n + i) * msg_len + offset,
+                        msg + (n + i) * msg_len + offset,
+                        stream + i * num_blocks * AES256_BLOCK_SIZE,
+                        len);
+            }
         }
-
-        c += block_len;
-        msg += block_len;
-        msg_len -= block_len;
-
-        increment_counter(T);
     }
 
-    crypto_memzero(T, AES256CTR_IV_SIZE);
     crypto_memzero(stream, sizeof(stream));
+}
 
-    return 0;
-}                      
 int32_t aes256ctr_decrypt(uint8_t *msg,
                           size_t *msg_len,
                           const uint8_t *c,
@@ -139,4 +224,4 @@ int32_t aes256ctr_decrypt(uint8_t *msg,
                           const uint8_t *key)
 {
     return aes256ctr_encrypt(msg, msg_len, c, c_len, iv, key);
-}                      
+}
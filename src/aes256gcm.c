@@ -1,10 +1,46 @@
 // Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
 // See LICENSE.md file for license, copying and use information.
 
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 #include "aes256.h"
 #include "aes256gcm.h"
+#include "ghash.h"
 #include "utils.h"
 
+#define GCM_PHASE_AAD       0
+#define GCM_PHASE_MESSAGE   1
+
+/* GCM limits the message to 2^39 - 256 bits */
+#define GCM_MAX_MSG_LEN     ((((uint64_t)1) << 36) - 32)
+
+/* Work done by a parallel job on its range of the message */
+#define GCM_JOB_HASH_IN     0x00000001
+#define GCM_JOB_CRYPT       0x00000002
+#define GCM_JOB_HASH_OUT    0x00000004
+
+/**
+ * A range of the message processed by one worker: the keystream
+ * starts at counter and the GHASH of the range is accumulated in
+ * accum from zero, to be combined with the other ranges afterwards.
+ */
+typedef struct
+{
+    const aes256_key_schedule *key;
+    const ghash_key *ghash;
+    const uint8_t *in;
+    uint8_t *out;
+    size_t len;
+    uint8_t J[16];
+    uint8_t accum[16];
+    uint32_t counter;
+    uint32_t mode;
+} gcm_job;
+
 static void big_endian_store32(uint8_t *x, uint32_t u)
 {
     x[3] = u & 0xFF; u >>= 8;
@@ -25,65 +61,6 @@ static void big_endian_store64(uint8_t *x, uint64_t u)
     x[0] = u & 0xFF;
 }
 
-/**
- * @brief Computes (a + x)*y.
- * 
- * @param a The input/output vector a, 16 bytes long
- * @param x The input vector x, x_len bytes long
- * @param x_len The length of vector x (in bytes)
- * @param y The input vector y, 16 bytes long
- */
-static void add_mul(uint8_t *a,
-                    const uint8_t *x, 
-                    size_t x_len,
-                    const uint8_t *y)
-{
-    int32_t i, j;
-    uint8_t a_bits[128], y_bits[128];
-    uint8_t axy_bits[256];
-    
-    for (i = 0; i < (int)x_len; ++i)
-    {
-        a[i] ^= x[i];
-    }
-
-    /* Performs reflection on (a + x) and y */
-    for (i = 0; i < 128; ++i)
-    {
-        a_bits[i] = (a[i >> 3] >> (7 - (i & 7))) & 1;
-        y_bits[i] = (y[i >> 3] >> (7 - (i & 7))) & 1;
-    }
-
-    crypto_memzero(axy_bits, sizeof(axy_bits));
-    for (i = 0; i < 128; ++i)
-    {
-        for (j = 0; j < 128; ++j)
-        {
-            axy_bits[i + j] ^= a_bits[i] & y_bits[j];
-        }
-    }
-
-    /**
-     * Galois field reduction, GF(2^128) is defined 
-     * by polynomial x^128 + x^7 + x^2 + 1
-     */
-    for (i = 127; i >= 0; --i)
-    {
-        axy_bits[i]       ^= axy_bits[i + 128];
-        axy_bits[i +   1] ^= axy_bits[i + 128];
-        axy_bits[i +   2] ^= axy_bits[i + 128];
-        axy_bits[i +   7] ^= axy_bits[i + 128];
-        axy_bits[i + 128] ^= axy_bits[i + 128];
-    }
-
-    /* Undo the reflection on the output */
-    crypto_memzero(a, 16);
-    for (i = 0; i < 128; ++i)
-    {
-        a[i >> 3] |= (axy_bits[i] << (7 - (i & 7)));
-    }
-}
-
 static int32_t diff(const uint8_t *x, const uint8_t *y)
 {
     uint32_t result = 0;
@@ -108,79 +85,295 @@ static int32_t diff(const uint8_t *x, const uint8_t *y)
     return (1 & ((result - 1) >> 8)) - 1;
 }
 
-int32_t aes256gcm_encrypt(uint8_t* c,
-                          size_t *c_len,
-                          const uint8_t* msg,
-                          size_t msg_len,
-                          const uint8_t* aad,
-                          size_t aad_len,
-                          const uint8_t* nonce,
-                          const uint8_t* key)
+/**
+ * @brief Absorbs data into GHASH, buffering partial blocks so that
+ * the data may be supplied in pieces of any size.
+ */
+static void gcm_hash(aes256gcm_ctx *ctx, const uint8_t *data, size_t len)
 {
-    uint8_t H[16];
-    uint8_t J[16];
-    uint8_t T[16];
-    uint8_t Z[16];
-    uint8_t accum[16];
-    uint8_t stream[16];
-    uint8_t final_block[16];
-	uint32_t i, index;
-    size_t block_len;
+    size_t n;
 
-    *c_len = msg_len + 16;
-    big_endian_store64(final_block, 8 * aad_len);
-    big_endian_store64(final_block + 8, 8 * msg_len);
+    if (len == 0)
+    {
+        return;
+    }
 
-    crypto_memzero(Z, sizeof(Z));
-    aes256_bitslice_encrypt(H, Z, key);
+    if (ctx->hash_buffer_len > 0)
+    {
+        n = sizeof(ctx->hash_buffer) - ctx->hash_buffer_len;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(ctx->hash_buffer + ctx->hash_buffer_len, data, n);
+        ctx->hash_buffer_len += n;
+        data += n;
+        len -= n;
 
-    for (i = 0; i < 12; ++i) 
+        if (ctx->hash_buffer_len < sizeof(ctx->hash_buffer))
+        {
+            return;
+        }
+        ghash_update(&ctx->ghash, ctx->accum, ctx->hash_buffer, 16);
+        ctx->hash_buffer_len = 0;
+    }
+
+    n = len & ~(size_t)15;
+    ghash_update(&ctx->ghash, ctx->accum, data, n);
+    memcpy(ctx->hash_buffer, data + n, len - n);
+    ctx->hash_buffer_len = len - n;
+}
+
+/**
+ * @brief Zero-pads and absorbs the buffered partial block, if any.
+ */
+static void gcm_hash_flush(aes256gcm_ctx *ctx)
+{
+    ghash_update(&ctx->ghash,
+                 ctx->accum,
+                 ctx->hash_buffer,
+                 ctx->hash_buffer_len);
+    ctx->hash_buffer_len = 0;
+}
+
+/**
+ * @brief Moves from the AAD to the message, checking the GCM message
+ * size limit.
+ */
+static int32_t gcm_start_message(aes256gcm_ctx *ctx, size_t len)
+{
+    if (ctx->phase == GCM_PHASE_AAD)
     {
-        J[i] = nonce[i];
+        gcm_hash_flush(ctx);
+        ctx->phase = GCM_PHASE_MESSAGE;
     }
-    index = 1;
-    big_endian_store32(J + 12, index);
-    aes256_bitslice_encrypt(T, J, key);
+    if ((uint64_t)len > GCM_MAX_MSG_LEN - ctx->msg_len)
+    {
+        return -1;
+    }
+    ctx->msg_len += len;
 
-    crypto_memzero(accum, sizeof(accum));
+    return 0;
+}
 
-    while (aad_len > 0)
+/**
+ * @brief XORs the CTR keystream with len bytes of input, the
+ * keystream is generated AES256GCM_BATCH_BLOCKS blocks at a time and
+ * the unused part is kept for the next call.
+ */
+static void gcm_crypt(aes256gcm_ctx *ctx,
+                      uint8_t *out,
+                      const uint8_t *in,
+                      size_t len)
+{
+    size_t i, n, num_blocks;
+
+    while (len > 0)
     {
-        block_len = 16;
-        if (aad_len < block_len) 
+        if (ctx->stream_pos == ctx->stream_len)
         {
-            block_len = aad_len;
+            num_blocks = (len + 15) / 16;
+            if (num_blocks > AES256GCM_BATCH_BLOCKS)
+            {
+                num_blocks = AES256GCM_BATCH_BLOCKS;
+            }
+            for (i = 0; i < num_blocks; ++i)
+            {
+                big_endian_store32(ctx->J + 12, ctx->counter++);
+                memcpy(ctx->stream + 16 * i, ctx->J, 16);
+            }
+            aes256_encrypt_blocks(&ctx->key,
+                                  ctx->stream,
+                                  ctx->stream,
+                                  num_blocks);
+            ctx->stream_pos = 0;
+            ctx->stream_len = 16 * num_blocks;
         }
-        add_mul(accum, aad, block_len, H);
-        aad += block_len;
-        aad_len -= block_len;
+
+        n = ctx->stream_len - ctx->stream_pos;
+        if (n > len)
+        {
+            n = len;
+        }
+        for (i = 0; i < n; ++i)
+        {
+            out[i] = in[i] ^ ctx->stream[ctx->stream_pos + i];
+        }
+        ctx->stream_pos += n;
+        out += n;
+        in += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Computes the expected tag from the lengths block.
+ */
+static void gcm_tag(aes256gcm_ctx *ctx, uint8_t *tag)
+{
+    uint8_t final_block[16];
+    int32_t i;
+
+    gcm_hash_flush(ctx);
+    big_endian_store64(final_block, 8 * ctx->aad_len);
+    big_endian_store64(final_block + 8, 8 * ctx->msg_len);
+    ghash_update(&ctx->ghash, ctx->accum, final_block, 16);
+
+    for (i = 0; i < 16; ++i)
+    {
+        tag[i] = ctx->tag_mask[i] ^ ctx->accum[i];
+    }
+}
+
+void aes256gcm_init(aes256gcm_ctx *ctx,
+                    const uint8_t *key,
+                    const uint8_t *nonce)
+{
+    uint8_t H[16];
+
+    aes256_init(&ctx->key, key);
+
+    /* H = E(0^128) and E(J0) share a single engine pass */
+    crypto_memzero(ctx->stream, 16);
+    memcpy(ctx->J, nonce, 12);
+    big_endian_store32(ctx->J + 12, 1);
+    memcpy(ctx->stream + 16, ctx->J, 16);
+    aes256_encrypt_blocks(&ctx->key, ctx->stream, ctx->stream, 2);
+    memcpy(H, ctx->stream, 16);
+    memcpy(ctx->tag_mask, ctx->stream + 16, 16);
+    ghash_init(&ctx->ghash, H);
+
+    crypto_memzero(ctx->accum, sizeof(ctx->accum));
+    crypto_memzero(ctx->stream, sizeof(ctx->stream));
+    ctx->hash_buffer_len = 0;
+    ctx->stream_pos = 0;
+    ctx->stream_len = 0;
+    ctx->aad_len = 0;
+    ctx->msg_len = 0;
+    ctx->counter = 2;
+    ctx->phase = GCM_PHASE_AAD;
+
+    crypto_memzero(H, sizeof(H));
+}
+
+int32_t aes256gcm_update_aad(aes256gcm_ctx *ctx,
+                             const uint8_t *aad,
+                             size_t aad_len)
+{
+    if (ctx->phase != GCM_PHASE_AAD)
+    {
+        return -1;
+    }
+    ctx->aad_len += aad_len;
+    gcm_hash(ctx, aad, aad_len);
+
+    return 0;
+}
+
+int32_t aes256gcm_encrypt_update(aes256gcm_ctx *ctx,
+                                 uint8_t *c,
+                                 const uint8_t *msg,
+                                 size_t msg_len)
+{
+    size_t chunk_len;
+
+    if (gcm_start_message(ctx, msg_len) != 0)
+    {
+        return -1;
     }
 
     while (msg_len > 0)
     {
-        block_len = 16;
-        if (msg_len < block_len) 
+        chunk_len = sizeof(ctx->stream);
+        if (msg_len < chunk_len)
         {
-            block_len = msg_len;
+            chunk_len = msg_len;
         }
-        ++index;
-        big_endian_store32(J + 12, index);
-        aes256_bitslice_encrypt(stream, J, key);
-        for (i = 0; i < block_len; ++i)
+        gcm_crypt(ctx, c, msg, chunk_len);
+        gcm_hash(ctx, c, chunk_len);
+        c += chunk_len;
+        msg += chunk_len;
+        msg_len -= chunk_len;
+    }
+
+    return 0;
+}
+
+void aes256gcm_encrypt_final(aes256gcm_ctx *ctx, uint8_t *tag)
+{
+    gcm_start_message(ctx, 0);
+    gcm_tag(ctx, tag);
+
+    crypto_memzero(ctx, sizeof(aes256gcm_ctx));
+}
+
+int32_t aes256gcm_decrypt_update(aes256gcm_ctx *ctx,
+                                 uint8_t *msg,
+                                 const uint8_t *c,
+                                 size_t c_len)
+{
+    size_t chunk_len;
+
+    if (gcm_start_message(ctx, c_len) != 0)
+    {
+        return -1;
+    }
+
+    /* Each chunk is hashed before it is decrypted, so that it may be
+     * decrypted in place */
+    while (c_len > 0)
+    {
+        chunk_len = sizeof(ctx->stream);
+        if (c_len < chunk_len)
         {
-            c[i] = msg[i] ^ stream[i];
+            chunk_len = c_len;
         }
-        add_mul(accum, c, block_len, H);
-        c += block_len;
-        msg += block_len;
-        msg_len -= block_len;
+        gcm_hash(ctx, c, chunk_len);
+        gcm_crypt(ctx, msg, c, chunk_len);
+        c += chunk_len;
+        msg += chunk_len;
+        c_len -= chunk_len;
     }
 
-    add_mul(accum, final_block, 16, H);
-    for (i = 0; i < 16; ++i)
+    return 0;
+}
+
+int32_t aes256gcm_decrypt_verify(aes256gcm_ctx *ctx, const uint8_t *tag)
+{
+    uint8_t expected[16];
+    int32_t result;
+
+    gcm_start_message(ctx, 0);
+    gcm_tag(ctx, expected);
+    result = diff(expected, tag);
+
+    crypto_memzero(expected, sizeof(expected));
+    crypto_memzero(ctx, sizeof(aes256gcm_ctx));
+
+    return result;
+}
+
+int32_t aes256gcm_encrypt(uint8_t* c,
+                          size_t *c_len,
+                          const uint8_t* msg,
+                          size_t msg_len,
+                          const uint8_t* aad,
+                          size_t aad_len,
+                          const uint8_t* nonce,
+                          const uint8_t* key)
+{
+    aes256gcm_ctx ctx;
+
+    aes256gcm_init(&ctx, key, nonce);
+    if (aes256gcm_update_aad(&ctx, aad, aad_len) != 0 ||
+        aes256gcm_encrypt_update(&ctx, c, msg, msg_len) != 0)
     {
-        c[i] = T[i] ^ accum[i];
+        crypto_memzero(&ctx, sizeof(ctx));
+        *c_len = 0;
+        return -1;
     }
+    aes256gcm_encrypt_final(&ctx, c + msg_len);
+    *c_len = msg_len + 16;
 
     return 0;
 }
@@ -194,18 +387,9 @@ int32_t aes256gcm_decrypt(uint8_t *msg,
                           const uint8_t *nonce,
                           const uint8_t *key)
 {
-    uint8_t H[16];
-    uint8_t J[16];
-    uint8_t T[16];
-    uint8_t Z[16];
-    uint8_t accum[16];
-    uint8_t stream[16];
-    uint8_t final_block[16];
-    size_t block_len = 16;
+    aes256gcm_ctx ctx;
+    uint8_t tag[16];
     size_t m_len;
-    size_t orig_m_len;
-    uint32_t i, index;
-    const uint8_t *orig_c;
 
     if (c_len < 16)
     {
@@ -213,82 +397,359 @@ int32_t aes256gcm_decrypt(uint8_t *msg,
     }
     m_len = c_len - 16;
 
-    big_endian_store64(final_block, 8 * aad_len);
-    big_endian_store64(final_block + 8, 8 * m_len);
+    aes256gcm_init(&ctx, key, nonce);
+    aes256gcm_update_aad(&ctx, aad, aad_len);
+
+    /* First pass: authenticate the ciphertext */
+    if (gcm_start_message(&ctx, m_len) != 0)
+    {
+        crypto_memzero(&ctx, sizeof(ctx));
+        return -1;
+    }
+    gcm_hash(&ctx, c, m_len);
+    gcm_tag(&ctx, tag);
+
+    /* Compare GCM tag */
+    if (diff(tag, c + m_len) != 0) 
+    {
+        crypto_memzero(&ctx, sizeof(ctx));
+        crypto_memzero(tag, sizeof(tag));
+        return -1;
+    }
+
+    /* Second pass: decrypt */
+    gcm_crypt(&ctx, msg, c, m_len);
+    *msg_len = m_len;
+
+    crypto_memzero(&ctx, sizeof(ctx));
+    crypto_memzero(tag, sizeof(tag));
+
+    return 0;
+}
+
+int32_t aes256gcm_decrypt_single_pass(uint8_t *msg,
+                                      size_t *msg_len,
+                                      const uint8_t *c,
+                                      size_t c_len,
+                                      const uint8_t *aad,
+                                      size_t aad_len,
+                                      const uint8_t *nonce,
+                                      const uint8_t *key)
+{
+    aes256gcm_ctx ctx;
+    size_t m_len;
+
+    if (c_len < 16)
+    {
+        return -1;
+    }
+    m_len = c_len - 16;
+
+    aes256gcm_init(&ctx, key, nonce);
+    aes256gcm_update_aad(&ctx, aad, aad_len);
+    if (aes256gcm_decrypt_update(&ctx, msg, c, m_len) != 0)
+    {
+        /* Nothing was written to msg */
+        crypto_memzero(&ctx, sizeof(ctx));
+        return -1;
+    }
+
+    if (aes256gcm_decrypt_verify(&ctx, c + m_len) != 0)
+    {
+        crypto_memzero(msg, m_len);
+        return -1;
+    }
+    *msg_len = m_len;
+
+    return 0;
+}
+
+/**
+ * @brief Processes the range of a parallel job, in batches of
+ * AES256GCM_BATCH_BLOCKS blocks.
+ */
+static void gcm_job_run(gcm_job *job)
+{
+    uint8_t stream[AES256GCM_BATCH_BLOCKS * 16];
+    const uint8_t *in = job->in;
+    uint8_t *out = job->out;
+    size_t len = job->len;
+    size_t i, n, num_blocks;
+
+    while (len > 0)
+    {
+        n = sizeof(stream);
+        if (len < n)
+        {
+            n = len;
+        }
+
+        if (job->mode & GCM_JOB_HASH_IN)
+        {
+            ghash_update(job->ghash, job->accum, in, n);
+        }
+        if (job->mode & GCM_JOB_CRYPT)
+        {
+            num_blocks = (n + 15) / 16;
+            for (i = 0; i < num_blocks; ++i)
+            {
+                big_endian_store32(job->J + 12, job->counter++);
+                memcpy(stream + 16 * i, job->J, 16);
+            }
+            aes256_encrypt_blocks(job->key, stream, stream, num_blocks);
+            for (i = 0; i < n; ++i)
+            {
+                out[i] = in[i] ^ stream[i];
+            }
+            if (job->mode & GCM_JOB_HASH_OUT)
+            {
+                ghash_update(job->ghash, job->accum, out, n);
+            }
+            out += n;
+        }
+        in += n;
+        len -= n;
+    }
 
-    crypto_memzero(Z, sizeof(Z));
-    aes256_bitslice_encrypt(H, Z, key);
+    crypto_memzero(stream, sizeof(stream));
+}
 
-    for (i = 0; i < 12; ++i) 
+#if defined(_WIN32)
+static DWORD WINAPI gcm_job_thread(LPVOID arg)
+{
+    gcm_job_run((gcm_job *)arg);
+    return 0;
+}
+#else
+static void *gcm_job_thread(void *arg)
+{
+    gcm_job_run((gcm_job *)arg);
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Runs the jobs, the first on the calling thread and each of
+ * the others on a thread of its own. A job whose thread cannot be
+ * created is run on the calling thread instead.
+ */
+static void gcm_run_jobs(gcm_job *jobs, uint32_t num_jobs)
+{
+    uint32_t i;
+#if defined(_WIN32)
+    HANDLE threads[AES256GCM_MAX_THREADS];
+
+    for (i = 1; i < num_jobs; ++i)
     {
-        J[i] = nonce[i];
+        threads[i] = CreateThread(NULL, 0, gcm_job_thread, &jobs[i], 0, NULL);
     }
-    index = 1;
-    big_endian_store32(J + 12, index);
-    aes256_bitslice_encrypt(T, J, key);
+    gcm_job_run(&jobs[0]);
+    for (i = 1; i < num_jobs; ++i)
+    {
+        if (threads[i] == NULL)
+        {
+            gcm_job_run(&jobs[i]);
+            continue;
+        }
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#else
+    pthread_t threads[AES256GCM_MAX_THREADS];
+    bool started[AES256GCM_MAX_THREADS];
+
+    for (i = 1; i < num_jobs; ++i)
+    {
+        started[i] = (pthread_create(&threads[i],
+                                     NULL,
+                                     gcm_job_thread,
+                                     &jobs[i]) == 0);
+    }
+    gcm_job_run(&jobs[0]);
+    for (i = 1; i < num_jobs; ++i)
+    {
+        if (!started[i])
+        {
+            gcm_job_run(&jobs[i]);
+            continue;
+        }
+        pthread_join(threads[i], NULL);
+    }
+#endif
+}
 
-    crypto_memzero(accum, sizeof(accum));
+/**
+ * @brief Processes the whole message with up to num_threads jobs, and
+ * at most one per AES256GCM_MIN_THREAD_BYTES of message.
+ *
+ * The message is split in ranges of whole blocks, each with its own
+ * counter range. When the mode hashes, the GHASH values Y_j of the
+ * ranges are combined into the accumulator in order as
+ * accum = accum * H^n_j + Y_j, where n_j is the number of blocks of
+ * the range, which yields the same value as hashing the message
+ * serially. The message must have been accounted for by
+ * gcm_start_message().
+ */
+static void gcm_parallel(aes256gcm_ctx *ctx,
+                         uint8_t *out,
+                         const uint8_t *in,
+                         size_t len,
+                         uint32_t mode,
+                         uint32_t num_threads)
+{
+    gcm_job jobs[AES256GCM_MAX_THREADS];
+    size_t num_blocks, job_blocks, offset;
+    uint32_t i, num_jobs;
+    int32_t j;
 
-    while (aad_len > 0)
+    if (num_threads > AES256GCM_MAX_THREADS)
+    {
+        num_threads = AES256GCM_MAX_THREADS;
+    }
+    /* Below AES256GCM_MIN_THREAD_BYTES per thread, creating the thread
+     * costs more than it saves */
+    if (num_threads > len / AES256GCM_MIN_THREAD_BYTES)
     {
-        block_len = 16;
-        if (aad_len < block_len) 
+        num_threads = (uint32_t)(len / AES256GCM_MIN_THREAD_BYTES);
+    }
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+    num_blocks = (len + 15) / 16;
+    job_blocks = (num_blocks + num_threads - 1) / num_threads;
+    num_jobs = (job_blocks > 0) ? (uint32_t)((num_blocks + job_blocks - 1) / job_blocks) : 0;
+
+    for (i = 0, offset = 0; i < num_jobs; ++i, offset += 16 * job_blocks)
+    {
+        jobs[i].key = &ctx->key;
+        jobs[i].ghash = &ctx->ghash;
+        jobs[i].in = in + offset;
+        jobs[i].out = out + offset;
+        jobs[i].len = len - offset;
+        if (jobs[i].len > 16 * job_blocks)
         {
-            block_len = aad_len;
+            jobs[i].len = 16 * job_blocks;
         }
-        add_mul(accum, aad, block_len, H);
-        aad += block_len;
-        aad_len -= block_len;
+        memcpy(jobs[i].J, ctx->J, 16);
+        memset(jobs[i].accum, 0, 16);
+        jobs[i].counter = ctx->counter + (uint32_t)(i * job_blocks);
+        jobs[i].mode = mode;
     }
 
-    orig_c = c;
-    orig_m_len = m_len;
-    while (m_len > 0)
+    gcm_run_jobs(jobs, num_jobs);
+
+    if (mode & (GCM_JOB_HASH_IN | GCM_JOB_HASH_OUT))
     {
-        block_len = 16;
-        if (m_len < block_len) 
+        for (i = 0; i < num_jobs; ++i)
         {
-            block_len = m_len;
+            ghash_mul_power(&ctx->ghash,
+                            ctx->accum,
+                            (jobs[i].len + 15) / 16);
+            for (j = 0; j < 16; ++j)
+            {
+                ctx->accum[j] ^= jobs[i].accum[j];
+            }
         }
-        add_mul(accum, c, block_len, H);
-        c += block_len;
-        m_len -= block_len;
     }
 
-    add_mul(accum, final_block, 16, H);
-    for (i = 0; i < 16; ++i) 
+    crypto_memzero(jobs, sizeof(jobs));
+}
+
+int32_t aes256gcm_encrypt_parallel(uint8_t *c,
+                                   size_t *c_len,
+                                   const uint8_t *msg,
+                                   size_t msg_len,
+                                   const uint8_t *aad,
+                                   size_t aad_len,
+                                   const uint8_t *nonce,
+                                   const uint8_t *key,
+                                   uint32_t num_threads)
+{
+    aes256gcm_ctx ctx;
+
+    aes256gcm_init(&ctx, key, nonce);
+    aes256gcm_update_aad(&ctx, aad, aad_len);
+    if (gcm_start_message(&ctx, msg_len) != 0)
     {
-        accum[i] ^= T[i];
+        crypto_memzero(&ctx, sizeof(ctx));
+        *c_len = 0;
+        return -1;
     }
-    
-    /* Compare GCM tag */
-    if (diff(accum, c) != 0) 
+    gcm_parallel(&ctx,
+                 c,
+                 msg,
+                 msg_len,
+                 GCM_JOB_CRYPT | GCM_JOB_HASH_OUT,
+                 num_threads);
+    gcm_tag(&ctx, c + msg_len);
+    *c_len = msg_len + 16;
+
+    crypto_memzero(&ctx, sizeof(ctx));
+
+    return 0;
+}
+
+int32_t aes256gcm_decrypt_parallel(uint8_t *msg,
+                                   size_t *msg_len,
+                                   const uint8_t *c,
+                                   size_t c_len,
+                                   const uint8_t *aad,
+                                   size_t aad_len,
+                                   const uint8_t *nonce,
+                                   const uint8_t *key,
+                                   uint32_t num_threads,
+                                   bool single_pass)
+{
+    aes256gcm_ctx ctx;
+    uint8_t tag[16];
+    size_t m_len;
+    int32_t result;
+
+    if (c_len < 16)
     {
         return -1;
     }
+    m_len = c_len - 16;
 
-    c = orig_c;
-    m_len = orig_m_len;
-    *msg_len = m_len;
+    aes256gcm_init(&ctx, key, nonce);
+    aes256gcm_update_aad(&ctx, aad, aad_len);
 
-    while (m_len > 0)
+    if (gcm_start_message(&ctx, m_len) != 0)
     {
-        block_len = 16;
-        if (m_len < block_len)
+        crypto_memzero(&ctx, sizeof(ctx));
+        return -1;
+    }
+
+    /* Either authenticate first or hash and decrypt in a single pass,
+     * where each block is hashed before it is decrypted */
+    gcm_parallel(&ctx,
+                 msg,
+                 c,
+                 m_len,
+                 single_pass ? (GCM_JOB_HASH_IN | GCM_JOB_CRYPT) : GCM_JOB_HASH_IN,
+                 num_threads);
+    gcm_tag(&ctx, tag);
+    result = diff(tag, c + m_len);
+
+    if (result != 0)
+    {
+        if (single_pass)
         {
-            block_len = m_len;
+            crypto_memzero(msg, m_len);
         }
-        ++index;
-        big_endian_store32(J + 12, index);
-        aes256_bitslice_encrypt(stream, J, key);
-        for (i = 0; i < block_len; ++i)
+    }
+    else
+    {
+        if (!single_pass)
         {
-            msg[i] = c[i] ^ stream[i];
+            gcm_parallel(&ctx, msg, c, m_len, GCM_JOB_CRYPT, num_threads);
         }
-        c += block_len;
-        msg += block_len;
-        m_len -= block_len;
+        *msg_len = m_len;
     }
 
-    return 0;
+    crypto_memzero(&ctx, sizeof(ctx));
+    crypto_memzero(tag, sizeof(tag));
+
+    return result;
 }
@@ -0,0 +1,144 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+# define _GNU_SOURCE
+#endif
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <unistd.h>
+#endif
+#include "cpu_features.h"
+
+#if defined(VGP_X86_INTRINSICS)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#define CPU_FEATURES_DETECTED   0x80000000
+
+static volatile uint32_t _cpu_features = 0;
+static volatile uint32_t _cpu_features_disabled = 0;
+
+#if defined(VGP_X86_INTRINSICS)
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *regs)
+{
+#if defined(_MSC_VER)
+    int info[4];
+
+    __cpuidex(info, (int)leaf, (int)subleaf);
+    regs[0] = (uint32_t)info[0];
+    regs[1] = (uint32_t)info[1];
+    regs[2] = (uint32_t)info[2];
+    regs[3] = (uint32_t)info[3];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv(uint32_t index)
+{
+#if defined(_MSC_VER)
+    return (uint64_t)_xgetbv(index);
+#else
+    uint32_t eax, edx;
+
+    __asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static uint32_t detect_features(void)
+{
+    uint32_t regs[4];
+    uint32_t max_leaf;
+    uint32_t features = 0;
+
+    cpuid(0, 0, regs);
+    max_leaf = regs[0];
+    if (max_leaf < 1)
+    {
+        return 0;
+    }
+
+    cpuid(1, 0, regs);
+    if (regs[2] & (1u << 9))
+    {
+        features |= CPU_FEATURE_SSSE3;
+    }
+    if (regs[2] & (1u << 25))
+    {
+        features |= CPU_FEATURE_AESNI;
+    }
+    if (regs[2] & (1u << 1))
+    {
+        features |= CPU_FEATURE_PCLMUL;
+    }
+
+    /* AVX2 needs OSXSAVE, AVX and the OS saving the XMM/YMM state */
+    if ((regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && max_leaf >= 7)
+    {
+        if ((xgetbv(0) & 0x06) == 0x06)
+        {
+            cpuid(7, 0, regs);
+            if (regs[1] & (1u << 5))
+            {
+                features |= CPU_FEATURE_AVX2;
+            }
+        }
+    }
+
+    return features;
+}
+
+#else
+
+static uint32_t detect_features(void)
+{
+    return 0;
+}
+
+#endif
+
+uint32_t cpu_features(void)
+{
+    uint32_t features = _cpu_features;
+
+    /**
+     * Concurrent first calls may both run the detection,
+     * which is harmless as they store the same value.
+     */
+    if ((features & CPU_FEATURES_DETECTED) == 0)
+    {
+        features = detect_features() | CPU_FEATURES_DETECTED;
+        _cpu_features = features;
+    }
+
+    return features & ~CPU_FEATURES_DETECTED & ~_cpu_features_disabled;
+}
+
+void cpu_features_disable(uint32_t features)
+{
+    _cpu_features_disabled = features;
+}
+
+uint32_t cpu_count(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (uint32_t)info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (uint32_t)count : 1;
+#else
+    return 1;
+#endif
+}
@@ -1,11 +1,17 @@
 // Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
 // See LICENSE.md file for license, copying and use information.
 
+#include "cpu_features.h"
 #include "curve25519.h"
 #include "fe.h"
+#include "ge.h"
 #include "utils.h"
 #include "rand.h"
 
+#if defined(VGP_X86_INTRINSICS)
+#include <immintrin.h>
+#endif
+
 /**
  * @brief Performs curve25519 Diffie-Hellman exchange between point p and scalar n.
  * 
@@ -89,9 +95,588 @@ bool curve25519_dh(uint8_t *q, const uint8_t *n, const uint8_t *p)
     return true;
 }
 
+#if defined(VGP_X86_INTRINSICS)
+
+/*
+ * Four field elements in radix 2^25.5, limb i of lane j in the 64-bit
+ * element j of v[i]. The limbs are unsigned: fe_x4_sub adds 2p before
+ * subtracting a carried element, so products of add and sub outputs
+ * stay below 2^32 once scaled by 19 and the ten-term sums of fe_x4_mul
+ * below 2^63.
+ */
+typedef struct
+{
+    __m256i v[10];
+} fe_x4;
+
+/* 2p in radix 2^25.5 */
+static const uint32_t fe_x4_2p[10] =
+{
+    0x7ffffda, 0x3fffffe, 0x7fffffe, 0x3fffffe, 0x7fffffe,
+    0x3fffffe, 0x7fffffe, 0x3fffffe, 0x7fffffe, 0x3fffffe
+};
+
+VGP_TARGET("avx2")
+static void fe_x4_frombytes(fe_x4 *h, const uint8_t *const *s)
+{
+    static const uint8_t offset[10] =
+    {
+        0, 26, 51, 77, 102, 128, 153, 179, 204, 230
+    };
+    uint32_t limbs[4];
+    const uint8_t *x;
+    int32_t i, j;
+
+    for (i = 0; i < 10; ++i)
+    {
+        for (j = 0; j < 4; ++j)
+        {
+            x = s[j] + (offset[i] >> 3);
+            limbs[j] = ((uint32_t)x[0] | ((uint32_t)x[1] << 8) |
+                        ((uint32_t)x[2] << 16) | ((uint32_t)x[3] << 24))
+                >> (offset[i] & 7);
+            limbs[j] &= (i & 1) ? 0x1ffffff : 0x3ffffff;
+        }
+        h->v[i] = _mm256_setr_epi64x(limbs[0], limbs[1], limbs[2], limbs[3]);
+    }
+}
+
+/* Carries limb i of t into limb i + 1, limb 9 into limb 0 as 19 c */
+#define FE_X4_CARRY(t, i)                                               \
+    c = _mm256_srli_epi64(t[i], ((i) & 1) ? 25 : 26);                   \
+    t[i] = _mm256_and_si256(t[i], ((i) & 1) ? mask25 : mask26);         \
+    t[((i) + 1) % 10] = _mm256_add_epi64(t[((i) + 1) % 10], (i) == 9 ?  \
+        _mm256_add_epi64(_mm256_add_epi64(_mm256_slli_epi64(c, 4),      \
+                                          _mm256_slli_epi64(c, 1)), c) : c);
+
+/**
+ * Carries the 64-bit limbs t into h, in two interleaved chains as in
+ * the reference implementation. The carry out of limb 9 may exceed 32
+ * bits, 19 c is computed as 16 c + 2 c + c.
+ */
+VGP_TARGET("avx2")
+static void fe_x4_carry(fe_x4 *h, __m256i *t)
+{
+    const __m256i mask26 = _mm256_set1_epi64x(0x3ffffff);
+    const __m256i mask25 = _mm256_set1_epi64x(0x1ffffff);
+    __m256i c;
+    int32_t i;
+
+    FE_X4_CARRY(t, 0)
+    FE_X4_CARRY(t, 4)
+    FE_X4_CARRY(t, 1)
+    FE_X4_CARRY(t, 5)
+    FE_X4_CARRY(t, 2)
+    FE_X4_CARRY(t, 6)
+    FE_X4_CARRY(t, 3)
+    FE_X4_CARRY(t, 7)
+    FE_X4_CARRY(t, 4)
+    FE_X4_CARRY(t, 8)
+    FE_X4_CARRY(t, 9)
+    FE_X4_CARRY(t, 0)
+
+    for (i = 0; i < 10; ++i)
+    {
+        h->v[i] = t[i];
+    }
+}
+
+VGP_TARGET("avx2")
+static void fe_x4_add(fe_x4 *h, const fe_x4 *f, const fe_x4 *g)
+{
+    int32_t i;
+
+    for (i = 0; i < 10; ++i)
+    {
+        h->v[i] = _mm256_add_epi64(f->v[i], g->v[i]);
+    }
+}
+
+VGP_TARGET("avx2")
+static void fe_x4_sub(fe_x4 *h, const fe_x4 *f, const fe_x4 *g)
+{
+    int32_t i;
+
+    for (i = 0; i < 10; ++i)
+    {
+        h->v[i] = _mm256_sub_epi64(
+            _mm256_add_epi64(f->v[i], _mm256_set1_epi64x(fe_x4_2p[i])),
+            g->v[i]);
+    }
+}
+
+/**
+ * The products of limbs i and j are weighted by 2 when both are odd
+ * and by 19 when i + j wraps around 10.
+ */
+VGP_TARGET("avx2")
+static void fe_x4_mul(fe_x4 *h, const fe_x4 *f, const fe_x4 *g)
+{
+    const __m256i n19 = _mm256_set1_epi64x(19);
+    __m256i f0, f1, f2, f3, f4, f5, f6, f7, f8, f9;
+    __m256i f1_2, f3_2, f5_2, f7_2, f9_2;
+    __m256i g0, g1, g2, g3, g4, g5, g6, g7, g8, g9;
+    __m256i g1_19, g2_19, g3_19, g4_19, g5_19, g6_19, g7_19, g8_19, g9_19;
+    __m256i t[10];
+
+    f0 = f->v[0];
+    f1 = f->v[1];
+    f2 = f->v[2];
+    f3 = f->v[3];
+    f4 = f->v[4];
+    f5 = f->v[5];
+    f6 = f->v[6];
+    f7 = f->v[7];
+    f8 = f->v[8];
+    f9 = f->v[9];
+    g0 = g->v[0];
+    g1 = g->v[1];
+    g2 = g->v[2];
+    g3 = g->v[3];
+    g4 = g->v[4];
+    g5 = g->v[5];
+    g6 = g->v[6];
+    g7 = g->v[7];
+    g8 = g->v[8];
+    g9 = g->v[9];
+
+    f1_2 = _mm256_add_epi64(f1, f1);
+    f3_2 = _mm256_add_epi64(f3, f3);
+    f5_2 = _mm256_add_epi64(f5, f5);
+    f7_2 = _mm256_add_epi64(f7, f7);
+    f9_2 = _mm256_add_epi64(f9, f9);
+    g1_19 = _mm256_mul_epu32(g1, n19);
+    g2_19 = _mm256_mul_epu32(g2, n19);
+    g3_19 = _mm256_mul_epu32(g3, n19);
+    g4_19 = _mm256_mul_epu32(g4, n19);
+    g5_19 = _mm256_mul_epu32(g5, n19);
+    g6_19 = _mm256_mul_epu32(g6, n19);
+    g7_19 = _mm256_mul_epu32(g7, n19);
+    g8_19 = _mm256_mul_epu32(g8, n19);
+    g9_19 = _mm256_mul_epu32(g9, n19);
+
+    t[0] = _mm256_mul_epu32(f0, g0);
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f1_2, g9_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f2, g8_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f3_2, g7_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f4, g6_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f5_2, g5_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f6, g4_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f7_2, g3_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f8, g2_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f9_2, g1_19));
+    t[1] = _mm256_mul_epu32(f0, g1);
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f1, g0));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f2, g9_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f3, g8_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f4, g7_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f5, g6_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f6, g5_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f7, g4_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f8, g3_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f9, g2_19));
+    t[2] = _mm256_mul_epu32(f0, g2);
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f1_2, g1));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f2, g0));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f3_2, g9_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f4, g8_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f5_2, g7_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f6, g6_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f7_2, g5_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f8, g4_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f9_2, g3_19));
+    t[3] = _mm256_mul_epu32(f0, g3);
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f1, g2));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f2, g1));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f3, g0));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f4, g9_19));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f5, g8_19));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f6, g7_19));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f7, g6_19));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f8, g5_19));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f9, g4_19));
+    t[4] = _mm256_mul_epu32(f0, g4);
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f1_2, g3));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f2, g2));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f3_2, g1));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f4, g0));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f5_2, g9_19));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f6, g8_19));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f7_2, g7_19));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f8, g6_19));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f9_2, g5_19));
+    t[5] = _mm256_mul_epu32(f0, g5);
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f1, g4));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f2, g3));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f3, g2));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f4, g1));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f5, g0));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f6, g9_19));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f7, g8_19));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f8, g7_19));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f9, g6_19));
+    t[6] = _mm256_mul_epu32(f0, g6);
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f1_2, g5));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f2, g4));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f3_2, g3));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f4, g2));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f5_2, g1));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f6, g0));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f7_2, g9_19));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f8, g8_19));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f9_2, g7_19));
+    t[7] = _mm256_mul_epu32(f0, g7);
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f1, g6));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f2, g5));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f3, g4));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f4, g3));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f5, g2));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f6, g1));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f7, g0));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f8, g9_19));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f9, g8_19));
+    t[8] = _mm256_mul_epu32(f0, g8);
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f1_2, g7));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f2, g6));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f3_2, g5));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f4, g4));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f5_2, g3));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f6, g2));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f7_2, g1));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f8, g0));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f9_2, g9_19));
+    t[9] = _mm256_mul_epu32(f0, g9);
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f1, g8));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f2, g7));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f3, g6));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f4, g5));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f5, g4));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f6, g3));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f7, g2));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f8, g1));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f9, g0));
+
+    fe_x4_carry(h, t);
+}
+
+/* As fe_x4_mul, the products of limbs i < j appearing twice */
+VGP_TARGET("avx2")
+static void fe_x4_sqr(fe_x4 *h, const fe_x4 *f)
+{
+    const __m256i n19 = _mm256_set1_epi64x(19);
+    __m256i f0, f1, f2, f3, f4, f5, f6, f7, f8, f9;
+    __m256i f0_2, f1_2, f2_2, f3_2, f4_2, f5_2, f6_2, f7_2, f8_2, f9_2;
+    __m256i f1_4, f3_4, f5_4, f7_4;
+    __m256i f5_19, f6_19, f7_19, f8_19, f9_19;
+    __m256i t[10];
+
+    f0 = f->v[0];
+    f1 = f->v[1];
+    f2 = f->v[2];
+    f3 = f->v[3];
+    f4 = f->v[4];
+    f5 = f->v[5];
+    f6 = f->v[6];
+    f7 = f->v[7];
+    f8 = f->v[8];
+    f9 = f->v[9];
+
+    f0_2 = _mm256_add_epi64(f0, f0);
+    f1_2 = _mm256_add_epi64(f1, f1);
+    f2_2 = _mm256_add_epi64(f2, f2);
+    f3_2 = _mm256_add_epi64(f3, f3);
+    f4_2 = _mm256_add_epi64(f4, f4);
+    f5_2 = _mm256_add_epi64(f5, f5);
+    f6_2 = _mm256_add_epi64(f6, f6);
+    f7_2 = _mm256_add_epi64(f7, f7);
+    f8_2 = _mm256_add_epi64(f8, f8);
+    f9_2 = _mm256_add_epi64(f9, f9);
+    f1_4 = _mm256_add_epi64(f1_2, f1_2);
+    f3_4 = _mm256_add_epi64(f3_2, f3_2);
+    f5_4 = _mm256_add_epi64(f5_2, f5_2);
+    f7_4 = _mm256_add_epi64(f7_2, f7_2);
+    f5_19 = _mm256_mul_epu32(f5, n19);
+    f6_19 = _mm256_mul_epu32(f6, n19);
+    f7_19 = _mm256_mul_epu32(f7, n19);
+    f8_19 = _mm256_mul_epu32(f8, n19);
+    f9_19 = _mm256_mul_epu32(f9, n19);
+
+    t[0] = _mm256_mul_epu32(f0, f0);
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f1_4, f9_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f2_2, f8_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f3_4, f7_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f4_2, f6_19));
+    t[0] = _mm256_add_epi64(t[0], _mm256_mul_epu32(f5_2, f5_19));
+    t[1] = _mm256_mul_epu32(f0_2, f1);
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f2_2, f9_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f3_2, f8_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f4_2, f7_19));
+    t[1] = _mm256_add_epi64(t[1], _mm256_mul_epu32(f5_2, f6_19));
+    t[2] = _mm256_mul_epu32(f0_2, f2);
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f1_2, f1));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f3_4, f9_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f4_2, f8_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f5_4, f7_19));
+    t[2] = _mm256_add_epi64(t[2], _mm256_mul_epu32(f6, f6_19));
+    t[3] = _mm256_mul_epu32(f0_2, f3);
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f1_2, f2));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f4_2, f9_19));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f5_2, f8_19));
+    t[3] = _mm256_add_epi64(t[3], _mm256_mul_epu32(f6_2, f7_19));
+    t[4] = _mm256_mul_epu32(f0_2, f4);
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f1_4, f3));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f2, f2));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f5_4, f9_19));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f6_2, f8_19));
+    t[4] = _mm256_add_epi64(t[4], _mm256_mul_epu32(f7_2, f7_19));
+    t[5] = _mm256_mul_epu32(f0_2, f5);
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f1_2, f4));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f2_2, f3));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f6_2, f9_19));
+    t[5] = _mm256_add_epi64(t[5], _mm256_mul_epu32(f7_2, f8_19));
+    t[6] = _mm256_mul_epu32(f0_2, f6);
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f1_4, f5));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f2_2, f4));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f3_2, f3));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f7_4, f9_19));
+    t[6] = _mm256_add_epi64(t[6], _mm256_mul_epu32(f8, f8_19));
+    t[7] = _mm256_mul_epu32(f0_2, f7);
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f1_2, f6));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f2_2, f5));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f3_2, f4));
+    t[7] = _mm256_add_epi64(t[7], _mm256_mul_epu32(f8_2, f9_19));
+    t[8] = _mm256_mul_epu32(f0_2, f8);
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f1_4, f7));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f2_2, f6));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f3_4, f5));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f4, f4));
+    t[8] = _mm256_add_epi64(t[8], _mm256_mul_epu32(f9_2, f9_19));
+    t[9] = _mm256_mul_epu32(f0_2, f9);
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f1_2, f8));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f2_2, f7));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f3_2, f6));
+    t[9] = _mm256_add_epi64(t[9], _mm256_mul_epu32(f4_2, f5));
+
+    fe_x4_carry(h, t);
+}
+
+VGP_TARGET("avx2")
+static void fe_x4_mul121666(fe_x4 *h, const fe_x4 *f)
+{
+    __m256i t[10];
+    int32_t i;
+
+    for (i = 0; i < 10; ++i)
+    {
+        t[i] = _mm256_mul_epu32(f->v[i], _mm256_set1_epi64x(121666));
+    }
+    fe_x4_carry(h, t);
+}
+
+VGP_TARGET("avx2")
+static void fe_x4_swap(fe_x4 *f, fe_x4 *g, uint32_t ctrl)
+{
+    const __m256i mask = _mm256_set1_epi64x(-(int64_t)ctrl);
+    __m256i x;
+    int32_t i;
+
+    for (i = 0; i < 10; ++i)
+    {
+        x = _mm256_and_si256(_mm256_xor_si256(f->v[i], g->v[i]), mask);
+        f->v[i] = _mm256_xor_si256(f->v[i], x);
+        g->v[i] = _mm256_xor_si256(g->v[i], x);
+    }
+}
+
+/* Extracts lane j of f as a field element of fe.h */
+VGP_TARGET("avx2")
+static void fe_x4_extract(fe h, const fe_x4 *f, int32_t j)
+{
+    uint64_t limbs[10][4];
+    int32_t i;
+
+    for (i = 0; i < 10; ++i)
+    {
+        _mm256_storeu_si256((__m256i *)limbs[i], f->v[i]);
+    }
+#if defined(VGP_FE_51)
+    for (i = 0; i < 5; ++i)
+    {
+        h[i] = limbs[2 * i][j] + (limbs[2 * i + 1][j] << 26);
+    }
+#else
+    for (i = 0; i < 10; ++i)
+    {
+        h[i] = (int32_t)limbs[i][j];
+    }
+#endif
+    crypto_memzero(limbs, sizeof(limbs));
+}
+
+/**
+ * The ladder of curve25519_dh() on four points, the lanes only differ
+ * in their data. The four z are inverted with a single inversion.
+ */
+VGP_TARGET("avx2")
+static void curve25519_dh_x4_avx2(uint8_t *const *q,
+                                  const uint8_t *e,
+                                  const uint8_t *const *p)
+{
+    fe_x4 x1, x2, x3, z2, z3, t0, t1;
+    fe x[4], z[4], acc[4], inv, one, zero;
+    uint32_t b, swap, zero_z;
+    int32_t i, j, pos;
+
+    fe_x4_frombytes(&x1, p);
+    for (i = 0; i < 10; ++i)
+    {
+        x2.v[i] = _mm256_set1_epi64x(i == 0);
+        z2.v[i] = _mm256_setzero_si256();
+        x3.v[i] = x1.v[i];
+        z3.v[i] = x2.v[i];
+    }
+
+    swap = 0;
+    for (pos = 254; pos >= 0; --pos)
+    {
+        b = e[pos >> 3] >> (pos & 7);
+        b &= 1;
+        swap ^= b;
+        fe_x4_swap(&x2, &x3, swap);
+        fe_x4_swap(&z2, &z3, swap);
+        swap = b;
+        fe_x4_sub(&t0, &x3, &z3);
+        fe_x4_sub(&t1, &x2, &z2);
+        fe_x4_add(&x2, &x2, &z2);
+        fe_x4_add(&z2, &x3, &z3);
+        fe_x4_mul(&z3, &t0, &x2);
+        fe_x4_mul(&z2, &z2, &t1);
+        fe_x4_sqr(&t0, &t1);
+        fe_x4_sqr(&t1, &x2);
+        fe_x4_add(&x3, &z3, &z2);
+        fe_x4_sub(&z2, &z3, &z2);
+        fe_x4_mul(&x2, &t1, &t0);
+        fe_x4_sub(&t1, &t1, &t0);
+        fe_x4_sqr(&z2, &z2);
+        fe_x4_mul121666(&z3, &t1);
+        fe_x4_sqr(&x3, &x3);
+        fe_x4_add(&t0, &t0, &z3);
+        fe_x4_mul(&z3, &x1, &z2);
+        fe_x4_mul(&z2, &t1, &t0);
+    }
+    fe_x4_swap(&x2, &x3, swap);
+    fe_x4_swap(&z2, &z3, swap);
+
+    /*
+     * A lane with z = 0 maps to 0 as in curve25519_dh(), without
+     * zeroing the product the other lanes are inverted through
+     */
+    fe_one(one);
+    fe_zero(zero);
+    for (j = 0; j < 4; ++j)
+    {
+        fe_x4_extract(x[j], &x2, j);
+        fe_x4_extract(z[j], &z2, j);
+        zero_z = fe_iszero(z[j]);
+        fe_cmov(x[j], zero, zero_z);
+        fe_cmov(z[j], one, zero_z);
+    }
+    /* acc[j] = z[0] ... z[j] */
+    fe_copy(acc[0], z[0]);
+    for (j = 1; j < 4; ++j)
+    {
+        fe_mul(acc[j], acc[j - 1], z[j]);
+    }
+    fe_inv(inv, acc[3]);
+    for (j = 3; j > 0; --j)
+    {
+        fe_mul(acc[j], inv, acc[j - 1]);
+        fe_mul(inv, inv, z[j]);
+        fe_mul(x[j], x[j], acc[j]);
+        fe_tobytes(q[j], x[j]);
+    }
+    fe_mul(x[0], x[0], inv);
+    fe_tobytes(q[0], x[0]);
+
+    crypto_memzero(&x2, sizeof(x2));
+    crypto_memzero(&z2, sizeof(z2));
+    crypto_memzero(&x3, sizeof(x3));
+    crypto_memzero(&z3, sizeof(z3));
+    crypto_memzero(&t0, sizeof(t0));
+    crypto_memzero(&t1, sizeof(t1));
+    crypto_memzero(x, sizeof(x));
+}
+
+#endif
+
+/**
+ * @brief Performs up to four curve25519 Diffie-Hellman exchanges of
+ * one scalar with as many points.
+ *
+ * @note q[j] = [n].p[j] for j < count. With AVX2 the unused lanes of
+ * the ladder repeat the last point, without it each point costs one
+ * scalar ladder.
+ *
+ * @param q The count scalar multiplication outputs
+ * @param n The scalar value, 32 bytes
+ * @param p The count curve25519 points, 32 bytes each
+ * @param count The number of points, from 1 to 4
+ * @return true on success
+ * @return false on failure, e.g one of the points is invalid
+ */
+bool curve25519_dh_x4(uint8_t *const *q,
+                      const uint8_t *n,
+                      const uint8_t *const *p,
+                      size_t count)
+{
+    size_t i;
+#if defined(VGP_X86_INTRINSICS)
+    uint8_t e[CURVE25519_SCALAR_SIZE];
+    uint8_t *lane_q[4];
+    const uint8_t *lane_p[4];
+
+    if (count > 1 && count <= 4 && (cpu_features() & CPU_FEATURE_AVX2))
+    {
+        for (i = 0; i < 4; ++i)
+        {
+            lane_q[i] = q[(i < count) ? i : count - 1];
+            lane_p[i] = p[(i < count) ? i : count - 1];
+            if (fe_has_small_order(lane_p[i]))
+            {
+                return false;
+            }
+        }
+        for (i = 0; i < CURVE25519_SCALAR_SIZE; ++i)
+        {
+            e[i] = n[i];
+        }
+        e[ 0] &= 0xf8; /* Clear bits 0, 1, and 2 */
+        e[31] &= 0x7f; /* Clear bit 7 */
+        e[31] |= 0x40; /* Set bit 6 */
+
+        curve25519_dh_x4_avx2(lane_q, e, lane_p);
+        crypto_memzero(e, sizeof(e));
+        return true;
+    }
+#endif
+    for (i = 0; i < count; ++i)
+    {
+        if (!curve25519_dh(q[i], n, p[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * @brief Creates a curve25519 public-key from a private-key.
  * 
+ * @note The clamped scalar is multiplied by the Ed25519 base-point with
+ * the fixed-base comb of ge_scalarmult_base, and the result is mapped to
+ * the Montgomery u-coordinate, u = (Z + Y) / (Z - Y). This matches the
+ * ladder on the base-point u = 9 at a fraction of the cost.
+ * 
  * @param q The public-key output, a point
  * @param n The private-key input, a scalar
  * @return true on success
@@ -99,8 +684,33 @@ bool curve25519_dh(uint8_t *q, const uint8_t *n, const uint8_t *p)
  */
 bool curve25519_public_key_from_private_key(uint8_t *q, const uint8_t *n)
 {
-    static const uint8_t basepoint[CURVE25519_POINT_SIZE] = {9};
-    return curve25519_dh(q, n, basepoint);
+    uint8_t e[CURVE25519_SCALAR_SIZE];
+    uint32_t i;
+    ge_p3 A;
+    fe u, z_m_y;
+
+    for (i = 0; i < CURVE25519_SCALAR_SIZE; ++i)
+    {
+        e[i] = n[i];
+    }
+    e[ 0] &= 0xf8; /* Clear bits 0, 1, and 2 */
+    e[31] &= 0x7f; /* Clear bit 7 */
+    e[31] |= 0x40; /* Set bit 6 */
+
+    ge_scalarmult_base(&A, e);
+
+    fe_add(u, A.z, A.y);
+    fe_sub(z_m_y, A.z, A.y);
+    fe_inv(z_m_y, z_m_y);
+    fe_mul(u, u, z_m_y);
+    fe_tobytes(q, u);
+
+    crypto_memzero(e, sizeof(e));
+    crypto_memzero(&A, sizeof(A));
+    crypto_memzero(u, sizeof(fe));
+    crypto_memzero(z_m_y, sizeof(fe));
+
+    return true;
 }
 
 /**
@@ -113,7 +723,24 @@ bool curve25519_public_key_from_private_key(uint8_t *q, const uint8_t *n)
  */
 bool curve25519_random_keypair(uint8_t* public_key, uint8_t* private_key)
 {
-    bdap_randombytes(private_key, CURVE25519_SCALAR_SIZE);
+    return curve25519_random_keypair_ex(public_key, private_key, NULL);
+}
+
+/**
+ * @brief Creates a curve25519 random key-pair with a given random
+ * number generator provider.
+ * 
+ * @param public_key Output public-key array, 32 bytes
+ * @param private_key Output private-key array, 32 bytes
+ * @param rng The provider, or NULL to use bdap_randombytes
+ * @return true on success
+ * @return false on failure, e.g. invalid key-pair
+ */
+bool curve25519_random_keypair_ex(uint8_t* public_key,
+                                  uint8_t* private_key,
+                                  const bdap_rng* rng)
+{
+    bdap_rng_randombytes(rng, private_key, CURVE25519_SCALAR_SIZE);
     return curve25519_public_key_from_private_key(public_key, private_key);
 }
 
@@ -35,10 +35,23 @@ void ed25519_seeded_keypair(uint8_t* pk,
  * @param sk the pointer to the output private-key, 64 bytes
  */
 void ed25519_keypair(uint8_t* pk, uint8_t* sk)
+{
+    ed25519_keypair_ex(pk, sk, NULL);
+}
+
+/**
+ * @brief Randomly generates an Ed25519 public/private key-pair with
+ * a given random number generator provider.
+ *
+ * @param pk the pointer to the output public-key, 32 bytes
+ * @param sk the pointer to the output private-key, 64 bytes
+ * @param rng The provider, or NULL to use bdap_randombytes
+ */
+void ed25519_keypair_ex(uint8_t* pk, uint8_t* sk, const bdap_rng* rng)
 {
     uint8_t seed[ED25519_PRIVATE_KEY_SEED_SIZE];
 
-    bdap_randombytes(seed, sizeof(seed));
+    bdap_rng_randombytes(rng, seed, sizeof(seed));
     ed25519_seeded_keypair(pk, sk, seed);
 
     crypto_memzero(seed, sizeof(seed));
@@ -110,6 +123,113 @@ int32_t ed25519_to_curve25519_public_key(uint8_t *curve25519_pk,
     return 0;
 }
 
+/**
+ * @brief Converts n Ed25519 public-keys to Curve25519 public-keys with
+ * a single field inversion.
+ * 
+ * @note The denominators 1 - y are inverted together with Montgomery's
+ * trick. The running products are parked in the outputs during the
+ * forward pass, so the outputs must not overlap each other or the
+ * inputs. The subgroup checks are batched with ge_are_on_main_subgroup.
+ * 
+ * @param curve25519_pk the n output Curve25519 public-keys, zeroed
+ * when invalid
+ * @param ed25519_pk the n input Ed25519 public-keys
+ * @param valid the n output flags, true if the key was converted,
+ * required as the backward pass relies on them
+ * @param n the number of keys
+ * @return 0 if every key was converted, non-zero otherwise
+ */
+int32_t ed25519_to_curve25519_public_keys(uint8_t *const *curve25519_pk,
+                                          const uint8_t *const *ed25519_pk,
+                                          bool *valid,
+                                          size_t n)
+{
+    int32_t result = 0;
+    size_t i, j, m, count;
+    ge_p3 A[GE_SUBGROUP_BATCH_SIZE];
+    bool decoded[GE_SUBGROUP_BATCH_SIZE];
+    bool in_subgroup[GE_SUBGROUP_BATCH_SIZE];
+    fe acc, inv, y, t;
+
+    /* acc = (1 - y_0) ... (1 - y_i) over the valid keys, stored at i */
+    fe_one(acc);
+    for (i = 0; i < n; i += count)
+    {
+        count = n - i;
+        if (count > GE_SUBGROUP_BATCH_SIZE)
+        {
+            count = GE_SUBGROUP_BATCH_SIZE;
+        }
+        /* The decoded points are packed at the front of A, so that only
+         * those are checked */
+        for (j = 0, m = 0; j < count; ++j)
+        {
+            decoded[j] = !ge_has_small_order(ed25519_pk[i + j]) &&
+                         ge_frombytes(&A[m], ed25519_pk[i + j]) == 0;
+            if (decoded[j])
+            {
+                ++m;
+            }
+        }
+        ge_are_on_main_subgroup(in_subgroup, A, m);
+
+        for (j = 0, m = 0; j < count; ++j)
+        {
+            valid[i + j] = decoded[j] && in_subgroup[m];
+            if (valid[i + j])
+            {
+                fe_one(t);
+                fe_sub(t, t, A[m].y);
+                fe_mul(acc, acc, t);
+            }
+            else
+            {
+                result = -1;
+            }
+            if (decoded[j])
+            {
+                ++m;
+            }
+            fe_tobytes(curve25519_pk[i + j], acc);
+        }
+    }
+
+    fe_inv(inv, acc);
+
+    /* Walk back, peeling one denominator off inv at a time */
+    for (i = n; i-- > 0;)
+    {
+        if (!valid[i])
+        {
+            memset(curve25519_pk[i], 0, CURVE25519_PUBLIC_KEY_SIZE);
+            continue;
+        }
+
+        if (i > 0)
+        {
+            fe_frombytes(acc, curve25519_pk[i - 1]);
+        }
+        else
+        {
+            fe_one(acc);
+        }
+        fe_mul(acc, acc, inv);          /* 1 / (1 - y_i) */
+
+        fe_frombytes(y, ed25519_pk[i]);
+        fe_one(t);
+        fe_sub(t, t, y);
+        fe_mul(inv, inv, t);
+
+        fe_one(t);
+        fe_add(t, t, y);
+        fe_mul(t, t, acc);
+        fe_tobytes(curve25519_pk[i], t);
+    }
+
+    return result;
+}
+
 /**
  * @brief Converts Ed25519 private-key to Curve25519 private-key
  * 
@@ -1,6 +1,7 @@
 // Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
 // See LICENSE.md file for license, copying and use information.
 
+#include <stdlib.h>
 #include <string.h>
 #include "encryption_core.h"
 #include "encryption_error.h"
@@ -8,16 +9,19 @@
 #include "curve25519.h"
 #include "aes256ctr.h"
 #include "aes256gcm.h"
+#include "cpu_features.h"
 #include "shake256.h"
 #include "rand.h"
 #include "utils.h"
 
 #define FINGERPRINT_SIZE    7
 #define SECRET_SIZE         32
-#define BUF_SIZE            3*CURVE25519_PUBLIC_KEY_SIZE
 #define KEY_IV_SIZE         AES256CTR_KEY_SIZE + AES256CTR_IV_SIZE
 #define KEY_NONCE_SIZE      AES256GCM_KEY_SIZE + AES256GCM_NONCE_SIZE
 
+/* Number of recipients whose secret is wrapped by a single AES pass */
+#define RECIPIENT_BATCH_SIZE    (2 * AES256_PARALLEL_BLOCKS)
+
 static uint16_t bdap_ciphertext_number_of_recipients(
     const uint8_t* ciphertext)
 {
@@ -173,19 +177,64 @@ bool bdap_encrypt(uint8_t* ciphertext,
                   const uint8_t* plaintext,
                   const size_t plaintext_size,
                   const char** error_message)
+{
+    return bdap_encrypt_ex(ciphertext,
+                           num_recipients,
+                           ed25519_public_key,
+                           plaintext,
+                           plaintext_size,
+                           0,
+                           NULL,
+                           error_message);
+}
+
+/**
+ * @brief Performs BDAP end-to-end encryption on a piece of
+ * plaintext for a group of recipients, with options.
+ * 
+ * @param ciphertext the output ciphertext pointer
+ * @param num_recipients the number of recipients
+ * @param ed25519_public_key the pointer to an array of
+ *                           recipient's public-keys
+ * @param plaintext the input plaintext pointer
+ * @param plaintext_size the plaintext size in bytes
+ * @param flags a combination of BDAP_ENCRYPT_* option flags
+ * @param rng the random number generator provider,
+ *            or NULL to use bdap_randombytes
+ * @param error_message the pointer to the error message
+ *                      in the event of error
+ * @return true on success
+ * @return false otherwise
+ */
+bool bdap_encrypt_ex(uint8_t* ciphertext,
+                     const uint16_t num_recipients,
+                     const uint8_t** ed25519_public_key,
+                     const uint8_t* plaintext,
+                     const size_t plaintext_size,
+                     const uint32_t flags,
+                     const bdap_rng* rng,
+                     const char** error_message)
 {
     bool result = true;
-    uint16_t idx, error_code = BDAP_SUCCESS;
+    uint16_t idx, n, j, k, lanes, batch_size, error_code = BDAP_SUCCESS;
     uint8_t *c_ptr = ciphertext;
     uint8_t ephemeral_pk[CURVE25519_PUBLIC_KEY_SIZE] = {0};
     uint8_t ephemeral_sk[CURVE25519_PRIVATE_KEY_SIZE] = {0};
     uint8_t s[SECRET_SIZE] = {0};
-    uint8_t curve25519_pk[CURVE25519_PUBLIC_KEY_SIZE] = {0};
-    uint8_t Q[CURVE25519_POINT_SIZE] = {0};
-    uint8_t buf[BUF_SIZE] = {0};
-    uint8_t key_iv[KEY_IV_SIZE] = {0};
+    uint8_t Q[RECIPIENT_BATCH_SIZE * CURVE25519_POINT_SIZE] = {0};
+    shake256_ctx xof;
+    shake256_x4_ctx xof_x4;
+    const uint8_t *xof_q[4], *xof_pk[4], *xof_epk[4];
+    uint8_t *xof_key[4], *xof_iv[4];
+    const uint8_t *dh_pk[4];
+    uint8_t *dh_q[4];
+    uint8_t **pk_ptrs = NULL;
+    uint8_t *curve25519_pk = NULL;
+    bool *pk_valid = NULL;
     uint8_t key_nonce[KEY_NONCE_SIZE] = {0};
-    uint8_t c[SECRET_SIZE] = {0};
+    uint8_t keys[RECIPIENT_BATCH_SIZE * AES256CTR_KEY_SIZE] = {0};
+    uint8_t ivs[RECIPIENT_BATCH_SIZE * AES256CTR_IV_SIZE] = {0};
+    uint8_t c[RECIPIENT_BATCH_SIZE * SECRET_SIZE] = {0};
     size_t unused, ciphertext_size;
 
     ciphertext_size = bdap_ciphertext_size(num_recipients, plaintext_size);
@@ -195,7 +244,7 @@ bool bdap_encrypt(uint8_t* ciphertext,
     *c_ptr++ = (uint8_t)(num_recipients >> 8);
 
     /* 1. Generate an ephemeral Curve25519 keypair */
-    if (true != curve25519_random_keypair(ephemeral_pk, ephemeral_sk))
+    if (true != curve25519_random_keypair_ex(ephemeral_pk, ephemeral_sk, rng))
     {
         result = false;
         error_code = BDAP_X25519_KEYPAIR_FAILED;
@@ -205,68 +254,128 @@ bool bdap_encrypt(uint8_t* ciphertext,
     c_ptr += sizeof(ephemeral_pk);
 
     /* 2. Generate a random 32-byte secret */
-    bdap_randombytes(s, sizeof(s));
-
+    bdap_rng_randombytes(rng, s, sizeof(s));
+
+    /* 3a. Derive the Curve25519 public-keys of all the recipients from
+     * their Ed25519 public-keys with a single field inversion. The
+     * conversion requires the validity flags, they are not read as one
+     * invalid key fails the whole encryption. */
+    pk_ptrs = (uint8_t **)malloc(num_recipients *
+        (sizeof(uint8_t *) + CURVE25519_PUBLIC_KEY_SIZE + sizeof(bool)));
+    if (pk_ptrs == NULL && num_recipients > 0)
+    {
+        result = false;
+        error_code = BDAP_MEMORY_ALLOCATION_FAILED;
+        crypto_memzero(ciphertext, ciphertext_size);
+        goto bdap_e2e_encrypt_bail;
+    }
+    curve25519_pk = (uint8_t *)(pk_ptrs + num_recipients);
+    pk_valid = (bool *)(curve25519_pk + num_recipients * CURVE25519_PUBLIC_KEY_SIZE);
     for (idx = 0; idx < num_recipients; ++idx)
     {
-        /* 3a. Derive Curve25519 public-key from Ed25519 public-key */
-        if (0 != ed25519_to_curve25519_public_key(curve25519_pk,
-                                                  ed25519_public_key[idx]))
+        pk_ptrs[idx] = curve25519_pk + idx * CURVE25519_PUBLIC_KEY_SIZE;
+    }
+    if (0 != ed25519_to_curve25519_public_keys(pk_ptrs,
+                                               ed25519_public_key,
+                                               pk_valid,
+                                               num_recipients))
+    {
+        result = false;
+        error_code = BDAP_ED25519_TO_X25519_PUBLIC_KEY_FAILED;
+        crypto_memzero(ciphertext, ciphertext_size);
+        goto bdap_e2e_encrypt_bail;
+    }
+
+    for (idx = 0; idx < num_recipients; idx += batch_size)
+    {
+        batch_size = num_recipients - idx;
+        if (batch_size > RECIPIENT_BATCH_SIZE)
         {
-            result = false;
-            error_code = BDAP_ED25519_TO_X25519_PUBLIC_KEY_FAILED;
-            crypto_memzero(ciphertext, ciphertext_size);
-            goto bdap_e2e_encrypt_bail;
-        }                                          
-
-        /* 3b. Curve25519 Diffie-Hellman exchange */
-        if (curve25519_dh(Q, ephemeral_sk, curve25519_pk) == false)
+            batch_size = RECIPIENT_BATCH_SIZE;
+        }
+        for (n = 0; n < batch_size; ++n)
         {
-            result = false;
-            error_code = BDAP_X25519_DH_FAILED;
-            crypto_memzero(ciphertext, ciphertext_size);
-            goto bdap_e2e_encrypt_bail;
+            memcpy(c + n * SECRET_SIZE, s, sizeof(s));
         }
 
-        /* 3c. XOF(Q | curve25519_public_key | ephemeral_pk, 48) */
-        memcpy(buf, Q, sizeof(Q));
-        memcpy(buf + CURVE25519_PUBLIC_KEY_SIZE,
-               curve25519_pk,
-               CURVE25519_PUBLIC_KEY_SIZE);
-        memcpy(buf + 2*CURVE25519_PUBLIC_KEY_SIZE,
-               ephemeral_pk,
-               sizeof(ephemeral_pk));
-        if (0 != shake256(key_iv, KEY_IV_SIZE, buf, BUF_SIZE))
+        /* 3b. Curve25519 Diffie-Hellman exchange, four recipients at a time */
+        for (n = 0; n < batch_size; n += 4)
         {
-            result = false;
-            error_code = BDAP_AESCTR_KEY_DERIVATION_FAILED;
-            crypto_memzero(ciphertext, ciphertext_size);
-            goto bdap_e2e_encrypt_bail;
+            lanes = batch_size - n;
+            if (lanes > 4)
+            {
+                lanes = 4;
+            }
+            for (j = 0; j < lanes; ++j)
+            {
+                dh_q[j] = Q + (n + j) * CURVE25519_POINT_SIZE;
+                dh_pk[j] = pk_ptrs[idx + n + j];
+            }
+            if (!curve25519_dh_x4(dh_q, ephemeral_sk, dh_pk, lanes))
+            {
+                result = false;
+                error_code = BDAP_X25519_DH_FAILED;
+                crypto_memzero(ciphertext, ciphertext_size);
+                goto bdap_e2e_encrypt_bail;
+            }
         }
 
-        /* 3d. AESCTR_E(key, iv, s) -> c */
-        if (aes256ctr_encrypt(c,
-                              &unused,
-                              s,
-                              sizeof(s),
-                              &key_iv[AES256CTR_KEY_SIZE],
-                              key_iv) != 0)
+        /* 3c. XOF(Q | curve25519_public_key | ephemeral_pk, 48) -> key | iv */
+        for (n = 0; n < batch_size; n += 4)
         {
-            result = false;
-            error_code = BDAP_AESCTR_ENCRYPT_FAILED;
-            crypto_memzero(ciphertext, ciphertext_size);
-            goto bdap_e2e_encrypt_bail;
+            if (batch_size - n == 1)
+            {
+                shake256_init(&xof);
+                shake256_absorb(&xof,
+                                Q + n * CURVE25519_POINT_SIZE,
+                                CURVE25519_POINT_SIZE);
+                shake256_absorb(&xof,
+                                pk_ptrs[idx + n],
+                                CURVE25519_PUBLIC_KEY_SIZE);
+                shake256_absorb(&xof, ephemeral_pk, sizeof(ephemeral_pk));
+                shake256_squeeze(&xof,
+                                 keys + n * AES256CTR_KEY_SIZE,
+                                 AES256CTR_KEY_SIZE);
+                shake256_squeeze(&xof,
+                                 ivs + n * AES256CTR_IV_SIZE,
+                                 AES256CTR_IV_SIZE);
+                break;
+            }
+
+            /* Four recipients per pass, a short group repeats its last one */
+            for (j = 0; j < 4; ++j)
+            {
+                k = (n + j < batch_size) ? n + j : batch_size - 1;
+                xof_q[j] = Q + k * CURVE25519_POINT_SIZE;
+                xof_pk[j] = pk_ptrs[idx + k];
+                xof_epk[j] = ephemeral_pk;
+                xof_key[j] = keys + k * AES256CTR_KEY_SIZE;
+                xof_iv[j] = ivs + k * AES256CTR_IV_SIZE;
+            }
+            shake256_x4_init(&xof_x4);
+            shake256_x4_absorb(&xof_x4, xof_q, CURVE25519_POINT_SIZE);
+            shake256_x4_absorb(&xof_x4, xof_pk, CURVE25519_PUBLIC_KEY_SIZE);
+            shake256_x4_absorb(&xof_x4, xof_epk, sizeof(ephemeral_pk));
+            shake256_x4_squeeze(&xof_x4, xof_key, AES256CTR_KEY_SIZE);
+            shake256_x4_squeeze(&xof_x4, xof_iv, AES256CTR_IV_SIZE);
         }
 
-        /* Write fingerprint and encrypted secret pair */
-        memcpy(c_ptr, ed25519_public_key[idx], FINGERPRINT_SIZE);
-        c_ptr += FINGERPRINT_SIZE;
-        memcpy(c_ptr, c, sizeof(c));
-        c_ptr += sizeof(c);
+        /* 3d. AESCTR_E(key, iv, s) -> c, for the whole batch */
+        aes256ctr_encrypt_multi_key(c, c, SECRET_SIZE, ivs, keys, batch_size);
+
+        /* Write fingerprint and encrypted secret pairs */
+        for (n = 0; n < batch_size; ++n)
+        {
+            memcpy(c_ptr, ed25519_public_key[idx + n], FINGERPRINT_SIZE);
+            c_ptr += FINGERPRINT_SIZE;
+            memcpy(c_ptr, c + n * SECRET_SIZE, SECRET_SIZE);
+            c_ptr += SECRET_SIZE;
+        }
     }
 
     /* 4. XOF(s, 44) */
-    crypto_memzero(buf, sizeof(buf));
+    crypto_memzero(&xof, sizeof(xof));
+    crypto_memzero(&xof_x4, sizeof(xof_x4));
     if (0 != shake256(key_nonce, KEY_NONCE_SIZE, s, sizeof(s)))
     {
         result = false;
@@ -276,14 +385,30 @@ bool bdap_encrypt(uint8_t* ciphertext,
     }
 
     /* 5. AESGCM_E(key, nonce, plaintext) */
-    result = (aes256gcm_encrypt(c_ptr,
-                                &unused,
-                                plaintext,
-                                plaintext_size,
-                                NULL,
-                                0,
-                                &key_nonce[AES256GCM_KEY_SIZE],
-                                key_nonce) == 0);
+    if ((flags & BDAP_ENCRYPT_PARALLEL) &&
+        plaintext_size >= BDAP_PARALLEL_THRESHOLD)
+    {
+        result = (aes256gcm_encrypt_parallel(c_ptr,
+                                             &unused,
+                                             plaintext,
+                                             plaintext_size,
+                                             NULL,
+                                             0,
+                                             &key_nonce[AES256GCM_KEY_SIZE],
+                                             key_nonce,
+                                             cpu_count()) == 0);
+    }
+    else
+    {
+        result = (aes256gcm_encrypt(c_ptr,
+                                    &unused,
+                                    plaintext,
+                                    plaintext_size,
+                                    NULL,
+                                    0,
+                                    &key_nonce[AES256GCM_KEY_SIZE],
+                                    key_nonce) == 0);
+    }
     if (true != result)
     {
         error_code = BDAP_AESGCM_ENCRYPT_FAILED;
@@ -292,14 +417,21 @@ bool bdap_encrypt(uint8_t* ciphertext,
 
 bdap_e2e_encrypt_bail:
     crypto_memzero(s, sizeof(s));
-    crypto_memzero(key_iv, sizeof(key_iv));
+    crypto_memzero(keys, sizeof(keys));
+    crypto_memzero(ivs, sizeof(ivs));
     crypto_memzero(key_nonce, sizeof(key_nonce));
     crypto_memzero(ephemeral_sk, sizeof(ephemeral_sk));
     crypto_memzero(ephemeral_pk, sizeof(ephemeral_pk));
-    crypto_memzero(curve25519_pk, CURVE25519_PUBLIC_KEY_SIZE);
+    if (pk_ptrs != NULL)
+    {
+        crypto_memzero(pk_ptrs, num_recipients *
+            (sizeof(uint8_t *) + CURVE25519_PUBLIC_KEY_SIZE + sizeof(bool)));
+        free(pk_ptrs);
+    }
     crypto_memzero(c, sizeof(c));
     crypto_memzero(Q, sizeof(Q));
-    crypto_memzero(buf, sizeof(buf));
+    crypto_memzero(&xof, sizeof(xof));
+    crypto_memzero(&xof_x4, sizeof(xof_x4));
     if (error_message != NULL)
     {
         *error_message = bdap_error_message[error_code];
@@ -342,6 +474,36 @@ bool bdap_decrypt(uint8_t* plaintext,
                   const uint8_t* ciphertext,
                   const size_t ciphertext_size,
                   const char** error_message)
+{
+    return bdap_decrypt_ex(plaintext,
+                           ed25519_private_key_seed,
+                           ciphertext,
+                           ciphertext_size,
+                           0,
+                           error_message);
+}
+
+/**
+ * @brief Performs BDAP end-to-end decryption on a piece of
+ * ciphertext, with options.
+ * 
+ * @param plaintext the output plaintext pointer 
+ * @param ed25519_private_key_seed the pointer to the decryption
+ *                                 private-key seed
+ * @param ciphertext the input ciphertext pointer
+ * @param ciphertext_size the ciphertext size in bytes
+ * @param flags a combination of BDAP_DECRYPT_* option flags
+ * @param error_message the pointer to the error message
+ *                      in the event of error
+ * @return true on success
+ * @return false otherwise
+ */
+bool bdap_decrypt_ex(uint8_t* plaintext,
+                     const uint8_t* ed25519_private_key_seed,
+                     const uint8_t* ciphertext,
+                     const size_t ciphertext_size,
+                     const uint32_t flags,
+                     const char** error_message)
 {
     bool result = false;
     size_t unused;
@@ -355,7 +517,7 @@ bool bdap_decrypt(uint8_t* plaintext,
     uint8_t Q[CURVE25519_POINT_SIZE] = {0};
     uint8_t c[SECRET_SIZE] = {0};
     uint8_t s[SECRET_SIZE] = {0};
-    uint8_t buf[BUF_SIZE] = {0};
+    shake256_ctx xof;
     uint8_t key_iv[KEY_IV_SIZE] = {0};
     uint8_t key_nonce[KEY_NONCE_SIZE] = {0};
     const uint8_t* c_ptr = ciphertext;
@@ -411,19 +573,13 @@ bool bdap_decrypt(uint8_t* plaintext,
     }
 
     /* 8. XOF(Q | curve25519_pk | curve25519_ephemeral_pk, 48) */
-    memcpy(buf, Q, sizeof(Q));
-    memcpy(buf + CURVE25519_PUBLIC_KEY_SIZE,
-            curve25519_pk,
-            CURVE25519_PUBLIC_KEY_SIZE);
-    memcpy(buf + 2*CURVE25519_PUBLIC_KEY_SIZE,
-            curve25519_ephemeral_pk,
-            sizeof(curve25519_ephemeral_pk));
-    result = (0 == shake256(key_iv, KEY_IV_SIZE, buf, BUF_SIZE));
-    if (true != result)
-    {
-        error_code = BDAP_AESCTR_KEY_DERIVATION_FAILED;
-        goto bdap_e2e_decrypt_bail;
-    }
+    shake256_init(&xof);
+    shake256_absorb(&xof, Q, sizeof(Q));
+    shake256_absorb(&xof, curve25519_pk, sizeof(curve25519_pk));
+    shake256_absorb(&xof,
+                    curve25519_ephemeral_pk,
+                    sizeof(curve25519_ephemeral_pk));
+    shake256_squeeze(&xof, key_iv, KEY_IV_SIZE);
 
     /* 9. AESCTR_D(key, iv, c) -> s */
     if (aes256ctr_decrypt(s,
@@ -439,7 +595,7 @@ bool bdap_decrypt(uint8_t* plaintext,
     }
 
     /* 10. XOF(s, 44) */
-    crypto_memzero(buf, sizeof(buf));
+    crypto_memzero(&xof, sizeof(xof));
     result = (0 == shake256(key_nonce, KEY_NONCE_SIZE, s, sizeof(s)));
     if (true != result)
     {
@@ -452,14 +608,42 @@ bool bdap_decrypt(uint8_t* plaintext,
     ciphertext_header_size = bdap_ciphertext_header_size(num_recipients);
     c_ptr += ciphertext_header_size;
 
-    result = (aes256gcm_decrypt(plaintext,
-                                &unused,
-                                c_ptr,
-                                ciphertext_size - ciphertext_header_size,
-                                NULL,
-                                0,
-                                &key_nonce[AES256GCM_KEY_SIZE],
-                                key_nonce) == 0);
+    if ((flags & BDAP_DECRYPT_PARALLEL) &&
+        ciphertext_size - ciphertext_header_size >= BDAP_PARALLEL_THRESHOLD)
+    {
+        result = (aes256gcm_decrypt_parallel(plaintext,
+                                             &unused,
+                                             c_ptr,
+                                             ciphertext_size - ciphertext_header_size,
+                                             NULL,
+                                             0,
+                                             &key_nonce[AES256GCM_KEY_SIZE],
+                                             key_nonce,
+                                             cpu_count(),
+                                             (flags & BDAP_DECRYPT_SINGLE_PASS) != 0) == 0);
+    }
+    else if (flags & BDAP_DECRYPT_SINGLE_PASS)
+    {
+        result = (aes256gcm_decrypt_single_pass(plaintext,
+                                                &unused,
+                                                c_ptr,
+                                                ciphertext_size - ciphertext_header_size,
+                                                NULL,
+                                                0,
+                                                &key_nonce[AES256GCM_KEY_SIZE],
+                                                key_nonce) == 0);
+    }
+    else
+    {
+        result = (aes256gcm_decrypt(plaintext,
+                                    &unused,
+                                    c_ptr,
+                                    ciphertext_size - ciphertext_header_size,
+                                    NULL,
+                                    0,
+                                    &key_nonce[AES256GCM_KEY_SIZE],
+                                    key_nonce) == 0);
+    }
     if (true != result)
     {
         error_code = BDAP_AESGCM_DECRYPT_FAILED;
@@ -478,7 +662,7 @@ bdap_e2e_decrypt_bail_without_munlock:
     crypto_memzero(key_iv, sizeof(key_iv));
     crypto_memzero(key_nonce, sizeof(key_nonce));
     crypto_memzero(Q, sizeof(Q));
-    crypto_memzero(buf, sizeof(buf));
+    crypto_memzero(&xof, sizeof(xof));
     if (error_message != NULL)
     {
         *error_message = bdap_error_message[error_code];
@@ -11,13 +11,14 @@ const char* bdap_error_message[] =
     "Unable to obtain Curve25519 public-key from its private-key",
     "Unable to derive a Curve25519 key-pair",
     "Unable to perform Curve25519 Diffie-Hellman exchange",
-    "AES-CTR key and IV derivation failed",
+    "AES-CTR key and IV derivation failed", /* reserved, no longer returned */
     "AES-GCM key and nonce derivation failed",
-    "AES-CTR encrypt failed",
+    "AES-CTR encrypt failed", /* reserved, no longer returned */
     "AES-CTR decrypt failed",
     "AES-GCM encrypt failed",
     "AES-GCM decrypt failed",
     "Unable to find a valid recipient's encrypted secret",
     "Memory protection failed",
-    "Invalid ciphertext"
+    "Invalid ciphertext",
+    "Memory allocation failed"
 };
@@ -4,6 +4,8 @@
 #include "fe.h"
 #include "utils.h"
 
+#if !defined(VGP_FE_51)
+
 typedef int64_t fe64[10];
 
 #define FE_COPY(u, v) {\
@@ -742,12 +744,170 @@ void fe_2sqr(fe h, const fe f)
 }
 
 /**
- * @brief Inverts a field element.
+ * @brief Negate a field element v.
+ * 
+ * @param u The negated field element
+ * @param v The input field element
+ */
+void fe_neg(fe u, const fe v)
+{
+    FE_CONST_MUL(u, -1, v);
+}
+
+/**
+ * @brief Loads a field element from a byte-array.
+ * 
+ * @param h The field element loaded
+ * @param s The input byte-array
+ */
+void fe_frombytes(fe h, const uint8_t *s)
+{
+    fe64 v, c;
+    v[0] = big_endian_load_4(s);
+    v[1] = big_endian_load_3(s + 4) << 6;
+    v[2] = big_endian_load_3(s + 7) << 5;
+    v[3] = big_endian_load_3(s + 10) << 3;
+    v[4] = big_endian_load_3(s + 13) << 2;
+    v[5] = big_endian_load_4(s + 16);
+    v[6] = big_endian_load_3(s + 20) << 7;
+    v[7] = big_endian_load_3(s + 23) << 5;
+    v[8] = big_endian_load_3(s + 26) << 4;
+    v[9] = (big_endian_load_3(s + 29) & 0x7fffff) << 2;
+
+    c[9]  = (v[9] + (int64_t)(1 << 24)) >> 25;
+    v[0] += c[9] * 19;
+    v[9] -= c[9] << 25;
+    c[1]  = (v[1] + (int64_t)(1 << 24)) >> 25;
+    v[2] += c[1];
+    v[1] -= c[1] << 25;
+    c[3]  = (v[3] + (int64_t)(1 << 24)) >> 25;
+    v[4] += c[3];
+    v[3] -= c[3] << 25;
+    c[5]  = (v[5] + (int64_t)(1 << 24)) >> 25;
+    v[6] += c[5];
+    v[5] -= c[5] << 25;
+    c[7]  = (v[7] + (int64_t)(1 << 24)) >> 25;
+    v[8] += c[7];
+    v[7] -= c[7] << 25;
+
+    c[0]  = (v[0] + (int64_t)(1 << 25)) >> 26;
+    v[1] += c[0];
+    v[0] -= c[0] << 26;
+    c[2]  = (v[2] + (int64_t)(1 << 25)) >> 26;
+    v[3] += c[2];
+    v[2] -= c[2] << 26;
+    c[4]  = (v[4] + (int64_t)(1 << 25)) >> 26;
+    v[5] += c[4];
+    v[4] -= c[4] << 26;
+    c[6]  = (v[6] + (int64_t)(1 << 25)) >> 26;
+    v[7] += c[6];
+    v[6] -= c[6] << 26;
+    c[8]  = (v[8] + (int64_t)(1 << 25)) >> 26;
+    v[9] += c[8];
+    v[8] -= c[8] << 26;
+
+    FE_COPY(h, (int32_t)v);
+}
+
+/**
+ * @brief Stores a field element h to a byte-array.
+ * 
+ * @param s The output byte-array
+ * @param h The input field element
+ */
+void fe_tobytes(uint8_t *s, const fe h)
+{
+    fe v, c;
+    int32_t q;
+    
+    FE_COPY(v, h);
+    q = (19 * v[9] + (((int32_t)1) << 24)) >> 25;
+    q = (v[0] + q) >> 26;
+    q = (v[1] + q) >> 25;
+    q = (v[2] + q) >> 26;
+    q = (v[3] + q) >> 25;
+    q = (v[4] + q) >> 26;
+    q = (v[5] + q) >> 25;
+    q = (v[6] + q) >> 26;
+    q = (v[7] + q) >> 25;
+    q = (v[8] + q) >> 26;
+    q = (v[9] + q) >> 25;
+
+    v[0] += 19 * q;
+
+    c[0]  = v[0] >> 26;
+    v[1] += c[0];
+    v[0] -= c[0] << 26;
+    c[1]  = v[1] >> 25;
+    v[2] += c[1];
+    v[1] -= c[1] << 25;
+    c[2]  = v[2] >> 26;
+    v[3] += c[2];
+    v[2] -= c[2] << 26;
+    c[3]  = v[3] >> 25;
+    v[4] += c[3];
+    v[3] -= c[3] << 25;
+    c[4]  = v[4] >> 26;
+    v[5] += c[4];
+    v[4] -= c[4] << 26;
+    c[5]  = v[5] >> 25;
+    v[6] += c[5];
+    v[5] -= c[5] << 25;
+    c[6]  = v[6] >> 26;
+    v[7] += c[6];
+    v[6] -= c[6] << 26;
+    c[7]  = v[7] >> 25;
+    v[8] += c[7];
+    v[7] -= c[7] << 25;
+    c[8]  = v[8] >> 26;
+    v[9] += c[8];
+    v[8] -= c[8] << 26;
+    c[9]  = v[9] >> 25;
+    v[9] -= c[9] << 25;
+
+    s[ 0] = v[0] >> 0;
+    s[ 1] = v[0] >> 8;
+    s[ 2] = v[0] >> 16;
+    s[ 3] = (v[0] >> 24) | (v[1] << 2);
+    s[ 4] = v[1] >> 6;
+    s[ 5] = v[1] >> 14;
+    s[ 6] = (v[1] >> 22) | (v[2] << 3);
+    s[ 7] = v[2] >> 5;
+    s[ 8] = v[2] >> 13;
+    s[ 9] = (v[2] >> 21) | (v[3] << 5);
+    s[10] = v[3] >> 3;
+    s[11] = v[3] >> 11;
+    s[12] = (v[3] >> 19) | (v[4] << 6);
+    s[13] = v[4] >> 2;
+    s[14] = v[4] >> 10;
+    s[15] = v[4] >> 18;
+    s[16] = v[5] >> 0;
+    s[17] = v[5] >> 8;
+    s[18] = v[5] >> 16;
+    s[19] = (v[5] >> 24) | (v[6] << 1);
+    s[20] = v[6] >> 7;
+    s[21] = v[6] >> 15;
+    s[22] = (v[6] >> 23) | (v[7] << 3);
+    s[23] = v[7] >> 5;
+    s[24] = v[7] >> 13;
+    s[25] = (v[7] >> 21) | (v[8] << 4);
+    s[26] = v[8] >> 4;
+    s[27] = v[8] >> 12;
+    s[28] = (v[8] >> 20) | (v[9] << 6);
+    s[29] = v[9] >> 2;
+    s[30] = v[9] >> 10;
+    s[31] = v[9] >> 18;
+}
+
+#endif /* VGP_FE_51 */
+
+/**
+ * @brief Inverts a field element by raising it to the power p - 2.
  * 
  * @param x The output of inversion
  * @param z The field element to be inverted
  */
-void fe_inv(fe x, const fe z)
+void fe_inv_fermat(fe x, const fe z)
 {
     int32_t i;
     fe t0, t1, t2, t3;
@@ -809,6 +969,21 @@ void fe_inv(fe x, const fe z)
     fe_mul(x, t1, t0);
 }
 
+#if !defined(VGP_FE_SAFEGCD)
+
+/**
+ * @brief Inverts a field element.
+ * 
+ * @param x The output of inversion
+ * @param z The field element to be inverted
+ */
+void fe_inv(fe x, const fe z)
+{
+    fe_inv_fermat(x, z);
+}
+
+#endif /* VGP_FE_SAFEGCD */
+
 /**
  * @brief Computes z^(2^252 - 3).
  * 
@@ -874,17 +1049,6 @@ void fe_pow_2e252m3(fe x, const fe z)
     fe_mul(x, t0, z);
 }
 
-/**
- * @brief Negate a field element v.
- * 
- * @param u The negated field element
- * @param v The input field element
- */
-void fe_neg(fe u, const fe v)
-{
-    FE_CONST_MUL(u, -1, v);
-}
-
 /**
  * @brief Returns true if field element v is zero, otherwise false.
  * 
@@ -922,151 +1086,6 @@ bool fe_isnegative(const fe v)
     return (bool)(u[0] & 1);
 }
 
-/**
- * @brief Loads a field element from a byte-array.
- * 
- * @param h The field element loaded
- * @param s The input byte-array
- */
-void fe_frombytes(fe h, const uint8_t *s)
-{
-    fe64 v, c;
-    v[0] = big_endian_load_4(s);
-    v[1] = big_endian_load_3(s + 4) << 6;
-    v[2] = big_endian_load_3(s + 7) << 5;
-    v[3] = big_endian_load_3(s + 10) << 3;
-    v[4] = big_endian_load_3(s + 13) << 2;
-    v[5] = big_endian_load_4(s + 16);
-    v[6] = big_endian_load_3(s + 20) << 7;
-    v[7] = big_endian_load_3(s + 23) << 5;
-    v[8] = big_endian_load_3(s + 26) << 4;
-    v[9] = (big_endian_load_3(s + 29) & 0x7fffff) << 2;
-
-    c[9]  = (v[9] + (int64_t)(1 << 24)) >> 25;
-    v[0] += c[9] * 19;
-    v[9] -= c[9] << 25;
-    c[1]  = (v[1] + (int64_t)(1 << 24)) >> 25;
-    v[2] += c[1];
-    v[1] -= c[1] << 25;
-    c[3]  = (v[3] + (int64_t)(1 << 24)) >> 25;
-    v[4] += c[3];
-    v[3] -= c[3] << 25;
-    c[5]  = (v[5] + (int64_t)(1 << 24)) >> 25;
-    v[6] += c[5];
-    v[5] -= c[5] << 25;
-    c[7]  = (v[7] + (int64_t)(1 << 24)) >> 25;
-    v[8] += c[7];
-    v[7] -= c[7] << 25;
-
-    c[0]  = (v[0] + (int64_t)(1 << 25)) >> 26;
-    v[1] += c[0];
-    v[0] -= c[0] << 26;
-    c[2]  = (v[2] + (int64_t)(1 << 25)) >> 26;
-    v[3] += c[2];
-    v[2] -= c[2] << 26;
-    c[4]  = (v[4] + (int64_t)(1 << 25)) >> 26;
-    v[5] += c[4];
-    v[4] -= c[4] << 26;
-    c[6]  = (v[6] + (int64_t)(1 << 25)) >> 26;
-    v[7] += c[6];
-    v[6] -= c[6] << 26;
-    c[8]  = (v[8] + (int64_t)(1 << 25)) >> 26;
-    v[9] += c[8];
-    v[8] -= c[8] << 26;
-
-    FE_COPY(h, (int32_t)v);
-}
-
-/**
- * @brief Stores a field element h to a byte-array.
- * 
- * @param s The output byte-array
- * @param h The input field element
- */
-void fe_tobytes(uint8_t *s, const fe h)
-{
-    fe v, c;
-    int32_t q;
-    
-    FE_COPY(v, h);
-    q = (19 * v[9] + (((int32_t)1) << 24)) >> 25;
-    q = (v[0] + q) >> 26;
-    q = (v[1] + q) >> 25;
-    q = (v[2] + q) >> 26;
-    q = (v[3] + q) >> 25;
-    q = (v[4] + q) >> 26;
-    q = (v[5] + q) >> 25;
-    q = (v[6] + q) >> 26;
-    q = (v[7] + q) >> 25;
-    q = (v[8] + q) >> 26;
-    q = (v[9] + q) >> 25;
-
-    v[0] += 19 * q;
-
-    c[0]  = v[0] >> 26;
-    v[1] += c[0];
-    v[0] -= c[0] << 26;
-    c[1]  = v[1] >> 25;
-    v[2] += c[1];
-    v[1] -= c[1] << 25;
-    c[2]  = v[2] >> 26;
-    v[3] += c[2];
-    v[2] -= c[2] << 26;
-    c[3]  = v[3] >> 25;
-    v[4] += c[3];
-    v[3] -= c[3] << 25;
-    c[4]  = v[4] >> 26;
-    v[5] += c[4];
-    v[4] -= c[4] << 26;
-    c[5]  = v[5] >> 25;
-    v[6] += c[5];
-    v[5] -= c[5] << 25;
-    c[6]  = v[6] >> 26;
-    v[7] += c[6];
-    v[6] -= c[6] << 26;
-    c[7]  = v[7] >> 25;
-    v[8] += c[7];
-    v[7] -= c[7] << 25;
-    c[8]  = v[8] >> 26;
-    v[9] += c[8];
-    v[8] -= c[8] << 26;
-    c[9]  = v[9] >> 25;
-    v[9] -= c[9] << 25;
-
-    s[ 0] = v[0] >> 0;
-    s[ 1] = v[0] >> 8;
-    s[ 2] = v[0] >> 16;
-    s[ 3] = (v[0] >> 24) | (v[1] << 2);
-    s[ 4] = v[1] >> 6;
-    s[ 5] = v[1] >> 14;
-    s[ 6] = (v[1] >> 22) | (v[2] << 3);
-    s[ 7] = v[2] >> 5;
-    s[ 8] = v[2] >> 13;
-    s[ 9] = (v[2] >> 21) | (v[3] << 5);
-    s[10] = v[3] >> 3;
-    s[11] = v[3] >> 11;
-    s[12] = (v[3] >> 19) | (v[4] << 6);
-    s[13] = v[4] >> 2;
-    s[14] = v[4] >> 10;
-    s[15] = v[4] >> 18;
-    s[16] = v[5] >> 0;
-    s[17] = v[5] >> 8;
-    s[18] = v[5] >> 16;
-    s[19] = (v[5] >> 24) | (v[6] << 1);
-    s[20] = v[6] >> 7;
-    s[21] = v[6] >> 15;
-    s[22] = (v[6] >> 23) | (v[7] << 3);
-    s[23] = v[7] >> 5;
-    s[24] = v[7] >> 13;
-    s[25] = (v[7] >> 21) | (v[8] << 4);
-    s[26] = v[8] >> 4;
-    s[27] = v[8] >> 12;
-    s[28] = (v[8] >> 20) | (v[9] << 6);
-    s[29] = v[9] >> 2;
-    s[30] = v[9] >> 10;
-    s[31] = v[9] >> 18;
-}
-
 /**
  * @brief Checks whether or not the point p has a small order.
  * 
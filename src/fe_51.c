@@ -0,0 +1,431 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+/**
+ * @file fe_51.c
+ *
+ * @brief Field arithmetic in radix 2^51 for 64-bit targets.
+ *
+ * The five limbs are multiplied into 128-bit accumulators. Outputs of
+ * fe_mul, fe_sqr and fe_frombytes have limbs below 2^52, fe_add does
+ * not carry, and fe_sub carries its subtrahend before adding 2p, so
+ * limbs never exceed 2^54 and the products in fe_mul never overflow.
+ * The field operations not listed here are shared with the radix
+ * 2^25.5 implementation in fe.c.
+ */
+
+#include "fe.h"
+
+#if defined(VGP_FE_51)
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+#define FE_MASK51   0x7ffffffffffffULL
+
+static uint64_t little_endian_load64(const uint8_t *x)
+{
+    return ((uint64_t)x[0])
+        | ((uint64_t)x[1] <<  8)
+        | ((uint64_t)x[2] << 16)
+        | ((uint64_t)x[3] << 24)
+        | ((uint64_t)x[4] << 32)
+        | ((uint64_t)x[5] << 40)
+        | ((uint64_t)x[6] << 48)
+        | ((uint64_t)x[7] << 56);
+}
+
+static void little_endian_store64(uint8_t *x, uint64_t u)
+{
+    x[0] = u & 0xFF; u >>= 8;
+    x[1] = u & 0xFF; u >>= 8;
+    x[2] = u & 0xFF; u >>= 8;
+    x[3] = u & 0xFF; u >>= 8;
+    x[4] = u & 0xFF; u >>= 8;
+    x[5] = u & 0xFF; u >>= 8;
+    x[6] = u & 0xFF; u >>= 8;
+    x[7] = u & 0xFF;
+}
+
+/* Carries the 128-bit limb products r into h */
+static void fe_carry128(fe h, uint128_t r0, uint128_t r1, uint128_t r2,
+                        uint128_t r3, uint128_t r4)
+{
+    uint64_t h0, h1, h2, h3, h4, c;
+
+    h0 = (uint64_t)r0 & FE_MASK51;
+    c  = (uint64_t)(r0 >> 51);
+    r1 += c;
+    h1 = (uint64_t)r1 & FE_MASK51;
+    c  = (uint64_t)(r1 >> 51);
+    r2 += c;
+    h2 = (uint64_t)r2 & FE_MASK51;
+    c  = (uint64_t)(r2 >> 51);
+    r3 += c;
+    h3 = (uint64_t)r3 & FE_MASK51;
+    c  = (uint64_t)(r3 >> 51);
+    r4 += c;
+    h4 = (uint64_t)r4 & FE_MASK51;
+    c  = (uint64_t)(r4 >> 51);
+    h0 += c * 19;
+    c   = h0 >> 51;
+    h0 &= FE_MASK51;
+    h1 += c;
+
+    h[0] = h0;
+    h[1] = h1;
+    h[2] = h2;
+    h[3] = h3;
+    h[4] = h4;
+}
+
+/**
+ * @brief Zeros a field element h.
+ *
+ * @param h The field element to be zero-ed
+ */
+void fe_zero(fe h)
+{
+    h[0] = 0;
+    h[1] = 0;
+    h[2] = 0;
+    h[3] = 0;
+    h[4] = 0;
+}
+
+/**
+ * @brief Set the field element h to 1.
+ *
+ * @param h The field element to be set
+ */
+void fe_one(fe h)
+{
+    h[0] = 1;
+    h[1] = 0;
+    h[2] = 0;
+    h[3] = 0;
+    h[4] = 0;
+}
+
+/**
+ * @brief Copies field element v to u.
+ *
+ * @param u The destination field element
+ * @param v The source field element
+ */
+void fe_copy(fe u, const fe v)
+{
+    u[0] = v[0];
+    u[1] = v[1];
+    u[2] = v[2];
+    u[3] = v[3];
+    u[4] = v[4];
+}
+
+/**
+ * @brief Sets field element f to g if cond is non-zero.
+ *
+ * @note The field element f is unchanged if cond is zero.
+ *
+ * @param f The field element f
+ * @param g The field element g
+ * @param cond The condition
+ */
+void fe_cmov(fe f, const fe g, uint32_t cond)
+{
+    uint64_t mask = (uint64_t)0 - (uint64_t)(cond != 0);
+
+    f[0] ^= (f[0] ^ g[0]) & mask;
+    f[1] ^= (f[1] ^ g[1]) & mask;
+    f[2] ^= (f[2] ^ g[2]) & mask;
+    f[3] ^= (f[3] ^ g[3]) & mask;
+    f[4] ^= (f[4] ^ g[4]) & mask;
+}
+
+/**
+ * @brief Add field elements f and g.
+ *
+ * @note h = f + g
+ * @note It is acceptable to overlap h with f or g.
+ *
+ * @param h The output of addition
+ * @param f One of the input to addtion
+ * @param g The other input to addition
+ */
+void fe_add(fe h, const fe f, const fe g)
+{
+    h[0] = f[0] + g[0];
+    h[1] = f[1] + g[1];
+    h[2] = f[2] + g[2];
+    h[3] = f[3] + g[3];
+    h[4] = f[4] + g[4];
+}
+
+/**
+ * @brief Subtracts field element g from field element f.
+ *
+ * @param h The subtraction output
+ * @param f The input field element
+ * @param g Another input field element
+ */
+void fe_sub(fe h, const fe f, const fe g)
+{
+    uint64_t g0, g1, g2, g3, g4;
+
+    g0 = g[0];
+    g1 = g[1];
+    g2 = g[2];
+    g3 = g[3];
+    g4 = g[4];
+
+    g1 += g0 >> 51;
+    g0 &= FE_MASK51;
+    g2 += g1 >> 51;
+    g1 &= FE_MASK51;
+    g3 += g2 >> 51;
+    g2 &= FE_MASK51;
+    g4 += g3 >> 51;
+    g3 &= FE_MASK51;
+    g0 += 19 * (g4 >> 51);
+    g4 &= FE_MASK51;
+
+    /* 2p = { 2^52 - 38, 2^52 - 2, 2^52 - 2, 2^52 - 2, 2^52 - 2 } */
+    h[0] = (f[0] + 0xfffffffffffdaULL) - g0;
+    h[1] = (f[1] + 0xffffffffffffeULL) - g1;
+    h[2] = (f[2] + 0xffffffffffffeULL) - g2;
+    h[3] = (f[3] + 0xffffffffffffeULL) - g3;
+    h[4] = (f[4] + 0xffffffffffffeULL) - g4;
+}
+
+/**
+ * @brief Swaps field element f and g if and only if ctrl is true.
+ *
+ * @param f An input field element
+ * @param g Another input field element
+ * @param ctrl Swap control flag
+ */
+void fe_swap(fe f, fe g, uint32_t ctrl)
+{
+    uint64_t mask = (uint64_t)0 - (uint64_t)(ctrl != 0);
+    uint64_t x;
+    int32_t i;
+
+    for (i = 0; i < 5; ++i)
+    {
+        x = (f[i] ^ g[i]) & mask;
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+/**
+ * @brief Multiplies field elements f and g to produce h.
+ *
+ * @param h The product of field multiplication
+ * @param f The multiplier
+ * @param g The multiplicant
+ */
+void fe_mul(fe h, const fe f, const fe g)
+{
+    uint128_t r0, r1, r2, r3, r4;
+    uint64_t f0, f1, f2, f3, f4;
+    uint64_t g0, g1, g2, g3, g4;
+    uint64_t g1_19, g2_19, g3_19, g4_19;
+
+    f0 = f[0];
+    f1 = f[1];
+    f2 = f[2];
+    f3 = f[3];
+    f4 = f[4];
+
+    g0 = g[0];
+    g1 = g[1];
+    g2 = g[2];
+    g3 = g[3];
+    g4 = g[4];
+
+    g1_19 = 19 * g1;
+    g2_19 = 19 * g2;
+    g3_19 = 19 * g3;
+    g4_19 = 19 * g4;
+
+    r0 = (uint128_t)f0 * g0    + (uint128_t)f1 * g4_19 + (uint128_t)f2 * g3_19
+       + (uint128_t)f3 * g2_19 + (uint128_t)f4 * g1_19;
+    r1 = (uint128_t)f0 * g1    + (uint128_t)f1 * g0    + (uint128_t)f2 * g4_19
+       + (uint128_t)f3 * g3_19 + (uint128_t)f4 * g2_19;
+    r2 = (uint128_t)f0 * g2    + (uint128_t)f1 * g1    + (uint128_t)f2 * g0
+       + (uint128_t)f3 * g4_19 + (uint128_t)f4 * g3_19;
+    r3 = (uint128_t)f0 * g3    + (uint128_t)f1 * g2    + (uint128_t)f2 * g1
+       + (uint128_t)f3 * g0    + (uint128_t)f4 * g4_19;
+    r4 = (uint128_t)f0 * g4    + (uint128_t)f1 * g3    + (uint128_t)f2 * g2
+       + (uint128_t)f3 * g1    + (uint128_t)f4 * g0;
+
+    fe_carry128(h, r0, r1, r2, r3, r4);
+}
+
+/**
+ * @brief Multiplies field element f with 121666.
+ *
+ * @param h The product of the multiplication
+ * @param f The multiplier
+ */
+void fe_mul121666(fe h, const fe f)
+{
+    fe_carry128(h,
+                (uint128_t)f[0] * 121666, (uint128_t)f[1] * 121666,
+                (uint128_t)f[2] * 121666, (uint128_t)f[3] * 121666,
+                (uint128_t)f[4] * 121666);
+}
+
+/* The five limb products of f^2, each multiplied by scale */
+#define FE_SQR_PRODUCTS(f, scale)                                       \
+    f0 = f[0];                                                          \
+    f1 = f[1];                                                          \
+    f2 = f[2];                                                          \
+    f3 = f[3];                                                          \
+    f4 = f[4];                                                          \
+    f0_2 = 2 * f0 * (scale);                                            \
+    f1_2 = 2 * f1 * (scale);                                            \
+    f1_38 = 38 * f1 * (scale);                                          \
+    f2_38 = 38 * f2 * (scale);                                          \
+    f3_38 = 38 * f3 * (scale);                                          \
+    f3_19 = 19 * f3 * (scale);                                          \
+    f4_19 = 19 * f4 * (scale);                                          \
+    r0 = (uint128_t)f0 * f0 * (scale) + (uint128_t)f1_38 * f4           \
+       + (uint128_t)f2_38 * f3;                                         \
+    r1 = (uint128_t)f0_2 * f1 + (uint128_t)f2_38 * f4                   \
+       + (uint128_t)f3_19 * f3;                                         \
+    r2 = (uint128_t)f0_2 * f2 + (uint128_t)f1 * f1 * (scale)            \
+       + (uint128_t)f3_38 * f4;                                         \
+    r3 = (uint128_t)f0_2 * f3 + (uint128_t)f1_2 * f2                    \
+       + (uint128_t)f4_19 * f4;                                         \
+    r4 = (uint128_t)f0_2 * f4 + (uint128_t)f1_2 * f3                    \
+       + (uint128_t)f2 * f2 * (scale);
+
+/**
+ * @brief Returns the squared value of field element f.
+ *
+ * @param h The squared output
+ * @param f The input field element
+ */
+void fe_sqr(fe h, const fe f)
+{
+    uint128_t r0, r1, r2, r3, r4;
+    uint64_t f0, f1, f2, f3, f4;
+    uint64_t f0_2, f1_2, f1_38, f2_38, f3_38, f3_19, f4_19;
+
+    FE_SQR_PRODUCTS(f, 1)
+    fe_carry128(h, r0, r1, r2, r3, r4);
+}
+
+/**
+ * @brief Returns the value of 2 * fe_sqr(f).
+ *
+ * @param h The resulting output
+ * @param f The input field element
+ */
+void fe_2sqr(fe h, const fe f)
+{
+    uint128_t r0, r1, r2, r3, r4;
+    uint64_t f0, f1, f2, f3, f4;
+    uint64_t f0_2, f1_2, f1_38, f2_38, f3_38, f3_19, f4_19;
+
+    FE_SQR_PRODUCTS(f, 2)
+    fe_carry128(h, r0, r1, r2, r3, r4);
+}
+
+/**
+ * @brief Negate a field element v.
+ *
+ * @param u The negated field element
+ * @param v The input field element
+ */
+void fe_neg(fe u, const fe v)
+{
+    fe zero;
+
+    fe_zero(zero);
+    fe_sub(u, zero, v);
+}
+
+/**
+ * @brief Loads a field element from a byte-array.
+ *
+ * @param h The field element loaded
+ * @param s The input byte-array
+ */
+void fe_frombytes(fe h, const uint8_t *s)
+{
+    h[0] =  little_endian_load64(s)              & FE_MASK51;
+    h[1] = (little_endian_load64(s +  6) >>  3) & FE_MASK51;
+    h[2] = (little_endian_load64(s + 12) >>  6) & FE_MASK51;
+    h[3] = (little_endian_load64(s + 19) >>  1) & FE_MASK51;
+    h[4] = (little_endian_load64(s + 24) >> 12) & FE_MASK51;
+}
+
+/**
+ * @brief Stores a field element h to a byte-array.
+ *
+ * @param s The output byte-array
+ * @param h The input field element
+ */
+void fe_tobytes(uint8_t *s, const fe h)
+{
+    uint64_t t0, t1, t2, t3, t4;
+
+    t0 = h[0];
+    t1 = h[1];
+    t2 = h[2];
+    t3 = h[3];
+    t4 = h[4];
+
+    /* Carries twice to get limbs below 2^51, t0 offset by 19 */
+    t1 += t0 >> 51;
+    t0 &= FE_MASK51;
+    t2 += t1 >> 51;
+    t1 &= FE_MASK51;
+    t3 += t2 >> 51;
+    t2 &= FE_MASK51;
+    t4 += t3 >> 51;
+    t3 &= FE_MASK51;
+    t0 += 19 * (t4 >> 51);
+    t4 &= FE_MASK51;
+
+    t0 += 19;
+    t1 += t0 >> 51;
+    t0 &= FE_MASK51;
+    t2 += t1 >> 51;
+    t1 &= FE_MASK51;
+    t3 += t2 >> 51;
+    t2 &= FE_MASK51;
+    t4 += t3 >> 51;
+    t3 &= FE_MASK51;
+    t0 += 19 * (t4 >> 51);
+    t4 &= FE_MASK51;
+
+    /*
+     * t + 19 is below 2^255 + 19 here: adding 2^255 - 19 more and
+     * dropping bit 255 leaves t mod p
+     */
+    t0 += 0x8000000000000ULL - 19;
+    t1 += 0x8000000000000ULL - 1;
+    t2 += 0x8000000000000ULL - 1;
+    t3 += 0x8000000000000ULL - 1;
+    t4 += 0x8000000000000ULL - 1;
+
+    t1 += t0 >> 51;
+    t0 &= FE_MASK51;
+    t2 += t1 >> 51;
+    t1 &= FE_MASK51;
+    t3 += t2 >> 51;
+    t2 &= FE_MASK51;
+    t4 += t3 >> 51;
+    t3 &= FE_MASK51;
+    t4 &= FE_MASK51;
+
+    little_endian_store64(s,       t0        | (t1 << 51));
+    little_endian_store64(s +  8, (t1 >> 13) | (t2 << 38));
+    little_endian_store64(s + 16, (t2 >> 26) | (t3 << 25));
+    little_endian_store64(s + 24, (t3 >> 39) | (t4 << 12));
+}
+
+#endif /* VGP_FE_51 */
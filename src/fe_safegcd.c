@@ -0,0 +1,280 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+/**
+ * @file fe_safegcd.c
+ *
+ * @brief Constant-time field inversion with the Bernstein-Yang divsteps.
+ *
+ * The element is converted to five signed 62-bit limbs and the half-delta
+ * divsteps are applied in 10 batches of 59, covering the 590 steps known
+ * to be sufficient for 256-bit inputs. Each batch is accumulated in a
+ * 2x2 transition matrix scaled by 2^62, which is then applied to
+ * (f, g) and to the Bezout coefficients (d, e), the latter with a
+ * multiple of the modulus added so the division by 2^62 is exact.
+ *
+ * Reference: Bernstein and Yang, "Fast constant-time gcd computation and
+ * modular inversion", and the libsecp256k1 modinv64 implementation.
+ */
+
+#include "fe.h"
+#include "utils.h"
+
+#if defined(VGP_FE_SAFEGCD)
+
+__extension__ typedef __int128 int128_t;
+
+#define M62 ((uint64_t)-1 >> 2)
+
+/**
+ * @brief A number as five signed 62-bit limbs,
+ * v[0] + 2^62 v[1] + 2^124 v[2] + 2^186 v[3] + 2^248 v[4].
+ */
+typedef struct
+{
+    int64_t v[5];
+} fe_signed62;
+
+/**
+ * @brief The transition matrix of a batch of divsteps, scaled by 2^62.
+ */
+typedef struct
+{
+    int64_t u, v, q, r;
+} fe_trans2x2;
+
+/* p = 2^255 - 19 */
+static const fe_signed62 modulus = {{-19, 0, 0, 0, 128}};
+
+/* p^-1 mod 2^62 */
+static const uint64_t modulus_inv62 = 0x39435e50d79435e5ULL;
+
+static uint64_t little_endian_load64(const uint8_t *x)
+{
+    return  (uint64_t)(x[0])        | ((uint64_t)(x[1]) <<  8) |
+           ((uint64_t)(x[2]) << 16) | ((uint64_t)(x[3]) << 24) |
+           ((uint64_t)(x[4]) << 32) | ((uint64_t)(x[5]) << 40) |
+           ((uint64_t)(x[6]) << 48) | ((uint64_t)(x[7]) << 56);
+}
+
+static void little_endian_store64(uint8_t *x, uint64_t u)
+{
+    int32_t i;
+
+    for (i = 0; i < 8; ++i)
+    {
+        x[i] = (uint8_t)u;
+        u >>= 8;
+    }
+}
+
+/**
+ * Performs 59 half-delta divsteps on the low bits of f and g, with
+ * zeta = -(delta + 1/2), and returns the updated zeta. The matrix starts
+ * as 8 times the identity so that it ends up scaled by 2^62. Branch-free,
+ * every step is masked.
+ */
+static int64_t fe_divsteps_59(int64_t zeta, uint64_t f, uint64_t g,
+                              fe_trans2x2 *t)
+{
+    uint64_t u = 8, v = 0, q = 0, r = 8;
+    uint64_t c1, c2, x, y, z;
+    int32_t i;
+
+    for (i = 3; i < 62; ++i)
+    {
+        /* c1 is set when zeta < 0, c2 when g is odd */
+        c1 = (uint64_t)(zeta >> 63);
+        c2 = -(g & 1);
+        x = (f ^ c1) - c1;
+        y = (u ^ c1) - c1;
+        z = (v ^ c1) - c1;
+        g += x & c2;
+        q += y & c2;
+        r += z & c2;
+        c1 &= c2;
+        zeta = (zeta ^ (int64_t)c1) - 1;
+        f += g & c1;
+        u += q & c1;
+        v += r & c1;
+        g >>= 1;
+        u <<= 1;
+        v <<= 1;
+    }
+
+    t->u = (int64_t)u;
+    t->v = (int64_t)v;
+    t->q = (int64_t)q;
+    t->r = (int64_t)r;
+
+    return zeta;
+}
+
+/**
+ * Computes (t [d, e] + p [md, me]) / 2^62, with md and me chosen so the
+ * division is exact. Keeps d and e in the range (-2p, p).
+ */
+static void fe_update_de_62(fe_signed62 *d, fe_signed62 *e,
+                            const fe_trans2x2 *t)
+{
+    const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int64_t md, me, sd, se;
+    int128_t cd, ce;
+    int32_t i;
+
+    /* Start with [u, q] if d is negative, plus [v, r] if e is negative */
+    sd = d->v[4] >> 63;
+    se = e->v[4] >> 63;
+    md = (u & sd) + (v & se);
+    me = (q & sd) + (r & se);
+
+    cd = (int128_t)u * d->v[0] + (int128_t)v * e->v[0];
+    ce = (int128_t)q * d->v[0] + (int128_t)r * e->v[0];
+
+    /* Clear the bottom 62 bits of t [d, e] + p [md, me] */
+    md -= (int64_t)((modulus_inv62 * (uint64_t)cd + (uint64_t)md) & M62);
+    me -= (int64_t)((modulus_inv62 * (uint64_t)ce + (uint64_t)me) & M62);
+    cd += (int128_t)modulus.v[0] * md;
+    ce += (int128_t)modulus.v[0] * me;
+    cd >>= 62;
+    ce >>= 62;
+
+    for (i = 1; i < 5; ++i)
+    {
+        cd += (int128_t)u * d->v[i] + (int128_t)v * e->v[i];
+        ce += (int128_t)q * d->v[i] + (int128_t)r * e->v[i];
+        cd += (int128_t)modulus.v[i] * md;
+        ce += (int128_t)modulus.v[i] * me;
+        d->v[i - 1] = (int64_t)((uint64_t)cd & M62);
+        e->v[i - 1] = (int64_t)((uint64_t)ce & M62);
+        cd >>= 62;
+        ce >>= 62;
+    }
+    d->v[4] = (int64_t)cd;
+    e->v[4] = (int64_t)ce;
+}
+
+/**
+ * Computes t [f, g] / 2^62, the bottom 62 bits being zero by
+ * construction.
+ */
+static void fe_update_fg_62(fe_signed62 *f, fe_signed62 *g,
+                            const fe_trans2x2 *t)
+{
+    const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int128_t cf, cg;
+    int32_t i;
+
+    cf = (int128_t)u * f->v[0] + (int128_t)v * g->v[0];
+    cg = (int128_t)q * f->v[0] + (int128_t)r * g->v[0];
+    cf >>= 62;
+    cg >>= 62;
+
+    for (i = 1; i < 5; ++i)
+    {
+        cf += (int128_t)u * f->v[i] + (int128_t)v * g->v[i];
+        cg += (int128_t)q * f->v[i] + (int128_t)r * g->v[i];
+        f->v[i - 1] = (int64_t)((uint64_t)cf & M62);
+        g->v[i - 1] = (int64_t)((uint64_t)cg & M62);
+        cf >>= 62;
+        cg >>= 62;
+    }
+    f->v[4] = (int64_t)cf;
+    g->v[4] = (int64_t)cg;
+}
+
+/* Propagates the carries of r, leaving limbs 0 to 3 in [0, 2^62) */
+static void fe_carry_62(fe_signed62 *r)
+{
+    int32_t i;
+
+    for (i = 0; i < 4; ++i)
+    {
+        r->v[i + 1] += r->v[i] >> 62;
+        r->v[i] &= (int64_t)M62;
+    }
+}
+
+/**
+ * Brings r from (-2p, p) to [0, p), negating it when sign is negative.
+ */
+static void fe_normalize_62(fe_signed62 *r, int64_t sign)
+{
+    int64_t cond_add, cond_negate;
+    int32_t i;
+
+    cond_add = r->v[4] >> 63;
+    cond_negate = sign >> 63;
+    for (i = 0; i < 5; ++i)
+    {
+        r->v[i] += modulus.v[i] & cond_add;
+        r->v[i] = (r->v[i] ^ cond_negate) - cond_negate;
+    }
+    fe_carry_62(r);
+
+    cond_add = r->v[4] >> 63;
+    for (i = 0; i < 5; ++i)
+    {
+        r->v[i] += modulus.v[i] & cond_add;
+    }
+    fe_carry_62(r);
+}
+
+/**
+ * @brief Inverts a field element with the safegcd algorithm.
+ *
+ * @note Zero is mapped to zero, as with fe_inv_fermat.
+ *
+ * @param x The output of inversion
+ * @param z The field element to be inverted
+ */
+void fe_inv(fe x, const fe z)
+{
+    uint8_t s[32];
+    uint64_t w[4];
+    fe_signed62 d = {{0}}, e = {{1}}, f = modulus, g;
+    fe_trans2x2 t;
+    int64_t zeta = -1;
+    int32_t i;
+
+    fe_tobytes(s, z);
+    for (i = 0; i < 4; ++i)
+    {
+        w[i] = little_endian_load64(s + 8 * i);
+    }
+    g.v[0] = (int64_t)(w[0] & M62);
+    g.v[1] = (int64_t)(((w[0] >> 62) | (w[1] << 2)) & M62);
+    g.v[2] = (int64_t)(((w[1] >> 60) | (w[2] << 4)) & M62);
+    g.v[3] = (int64_t)(((w[2] >> 58) | (w[3] << 6)) & M62);
+    g.v[4] = (int64_t)(w[3] >> 56);
+
+    for (i = 0; i < 10; ++i)
+    {
+        zeta = fe_divsteps_59(zeta, (uint64_t)f.v[0], (uint64_t)g.v[0], &t);
+        fe_update_de_62(&d, &e, &t);
+        fe_update_fg_62(&f, &g, &t);
+    }
+
+    /* g is now zero and f is +1 or -1, so z^-1 = f d */
+    fe_normalize_62(&d, f.v[4]);
+
+    w[0] = (uint64_t)d.v[0] | ((uint64_t)d.v[1] << 62);
+    w[1] = ((uint64_t)d.v[1] >> 2) | ((uint64_t)d.v[2] << 60);
+    w[2] = ((uint64_t)d.v[2] >> 4) | ((uint64_t)d.v[3] << 58);
+    w[3] = ((uint64_t)d.v[3] >> 6) | ((uint64_t)d.v[4] << 56);
+    for (i = 0; i < 4; ++i)
+    {
+        little_endian_store64(s + 8 * i, w[i]);
+    }
+    fe_frombytes(x, s);
+
+    crypto_memzero(s, sizeof(s));
+    crypto_memzero(w, sizeof(w));
+    crypto_memzero(&d, sizeof(d));
+    crypto_memzero(&e, sizeof(e));
+    crypto_memzero(&f, sizeof(f));
+    crypto_memzero(&g, sizeof(g));
+    crypto_memzero(&t, sizeof(t));
+}
+
+#endif /* VGP_FE_SAFEGCD */
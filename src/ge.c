@@ -2,7 +2,11 @@
 // See LICENSE.md file for license, copying and use information.
 
 #include "ge.h"
+#if defined(VGP_FE_51)
+#include "fe_51.h"
+#else
 #include "fe_25_5.h"
+#endif
 
 typedef struct
 {
@@ -12,6 +16,44 @@ typedef struct
     fe t2d;
 } ge_cached;
 
+#if defined(VGP_FE_51)
+
+static fe d = {
+     929955233495203,  466365720129213, 1662059464998953,
+    2033849074728123, 1442794654840575
+};
+
+static fe d2 = {
+    1859910466990425,  932731440258426, 1072319116312658,
+    1815898335770999,  633789495995903
+};
+
+static fe sqrt_m_1 = {
+    1718705420411056,  234908883556509, 2233514472574048,
+    2117202627021982,  765476049583133
+};
+
+static fe sqrt_m_486664 = {
+    1693982333959686,  608509411481997, 2235573344831311,
+     947681270984193,  266558006233600
+};
+
+static fe sqrt_486664 = {
+     643143913980949,  251828200308020, 2201891178899527,
+     378099121503595, 1898097605057180
+};
+
+static fe a2m4 = {
+    236839902240, 0, 0, 0, 0
+};
+
+static fe a2m4_pow_p58 = {
+     746870632841811, 2139735937178632, 1512091763953743,
+    1187739145915660, 2230108412620994
+};
+
+#else
+
 static fe d = {
     -10913610,  13857413, -15372611,   6949391,    114729,
      -8787816,  -6275908,  -3247719, -18696448, -12055116
@@ -27,6 +69,27 @@ static fe sqrt_m_1 = {
       -272473, -25146209,  -2005654,    326686,  11406482
 };
 
+static fe sqrt_m_486664 = {
+    -12222970,  -8312128, -11511410,   9067497, -15300785,
+      -241793,  25456130,  14121551, -12187136,   3972024
+};
+
+static fe sqrt_486664 = {
+      8930344,   9583591, -26444492,   3752533,  26044487,
+      -743697,  -2900628,   5634116,  25139868,  -5270574
+};
+
+static fe a2m4 = {
+    12721184, 3529, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static fe a2m4_pow_p58 = {
+    -20741530,  11129240,   7527432,  -1669882,   7688272,
+    -11022509,  31509773, -15855740,  -4280125,   -323227
+};
+
+#endif
+
 static uint8_t negative(char b)
 {
     uint64_t a = b;
@@ -395,6 +458,171 @@ int32_t ge_frombytes(ge_p3* h, const uint8_t* P)
     return (has_m_root | has_p_root) - 1;
 }
 
+/**
+ * Sets s to a square root of z and s_inv to its inverse, from the single
+ * exponentiation z^((p - 5) / 8). Returns false if z is zero or is not a
+ * square.
+ */
+static bool fe_sqrt_with_inverse(fe s, fe s_inv, const fe z)
+{
+    fe a, chk, t;
+
+    fe_pow_2e252m3(a, z);
+    fe_sqr(chk, a);
+    fe_mul(chk, chk, z);        /* z^((p - 1) / 4), one of 1, -1, +-i */
+
+    fe_one(t);
+    fe_sub(t, chk, t);
+    if (fe_iszero(t))
+    {
+        fe_mul(s, z, a);
+        fe_copy(s_inv, a);
+        return true;
+    }
+
+    fe_one(t);
+    fe_add(t, chk, t);
+    if (fe_iszero(t))
+    {
+        fe_mul(a, a, sqrt_m_1);
+        fe_mul(s, z, a);
+        fe_copy(s_inv, a);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Checks h against the main subgroup given inv = 1 / ((Z - Y) X), where
+ * (Z - Y) X is non-zero.
+ *
+ * The group is Z/8 x Z/l, so h is in the main subgroup iff it is in 8E,
+ * the multiples of 8. On the Montgomery curve v^2 = u^3 + A u^2 + u:
+ * - a point is in 2E iff its u-coordinate is a square,
+ * - a point is in 4E iff its 4-Tate pairing with the 4-torsion point
+ *   (1, b), b^2 = A + 2, is one. The Miller function of that pairing
+ *   is (v - b u)^2 / u,
+ * - h is in 8E iff it is in 2E and a half of it is in 4E.
+ * This costs one inversion and three exponentiations, against 253 point
+ * doublings for ge_mul_l.
+ */
+static bool ge_is_on_main_subgroup_inv(const ge_p3 *h, const fe inv)
+{
+    fe u, v, s, s_inv, t, w, r, n, a, chk;
+
+    /* u = (Z + Y) / (Z - Y), v = sqrt(-486664) u / x */
+    fe_add(n, h->z, h->y);
+    fe_mul(n, n, inv);
+    fe_mul(u, n, h->x);
+    fe_mul(v, n, h->z);
+    fe_mul(v, v, sqrt_m_486664);
+
+    /* h is in 2E */
+    if (fe_sqrt_with_inverse(s, s_inv, u) == false)
+    {
+        return false;
+    }
+
+    /**
+     * A half of h has u-coordinate w = t + sqrt(t^2 - 1), with
+     * t = u + v / s or t = u - v / s, whichever makes t^2 - 1 a square.
+     * The product of the two radicands is u^2 (A^2 - 4), A^2 - 4 being
+     * a non-square, so one exponentiation settles both.
+     */
+    fe_mul(v, v, s_inv);
+    fe_add(t, u, v);
+    fe_sqr(n, t);
+    fe_one(w);
+    fe_sub(n, n, w);                /* d = t^2 - 1 */
+    fe_pow_2e252m3(a, n);           /* a = d^((p - 5) / 8) */
+    fe_sqr(chk, a);
+    fe_mul(chk, chk, n);            /* d^((p - 1) / 4) */
+    fe_mul(r, n, a);
+
+    fe_sub(w, chk, w);
+    if (fe_iszero(w) == false)
+    {
+        fe_one(w);
+        fe_add(w, chk, w);
+        if (fe_iszero(w))
+        {
+            fe_mul(r, r, sqrt_m_1);
+        }
+        else
+        {
+            /**
+             * d is not a square: with e = (A^2 - 4) d, the root of
+             * u^2 (A^2 - 4) / d is u sqrt(e) / d, where
+             * sqrt(e) = +-e (A^2 - 4)^((p - 5) / 8) a, 1 / d = -a^2 chk
+             */
+            fe_mul(n, n, a2m4);
+            fe_mul(r, n, a2m4_pow_p58);
+            fe_mul(r, r, a);
+            fe_sqr(w, r);
+            fe_sub(w, w, n);
+            if (fe_iszero(w) == false)
+            {
+                fe_mul(r, r, sqrt_m_1);
+            }
+            fe_sqr(a, a);
+            fe_mul(a, a, chk);
+            fe_mul(r, r, a);
+            fe_mul(r, r, u);
+            fe_neg(r, r);
+            fe_sub(t, u, v);
+        }
+    }
+    fe_add(w, t, r);
+
+    /**
+     * The half is in 4E iff ((v_w - b w)^2 w^3)^((p - 1) / 4) = 1. With
+     * v_w = (w^2 - 1) / (2 s) and n = (w^2 - 1) / s - 2 b w, that is
+     * (n^2 w^3 / 4)^((p - 1) / 4) = 1, where 4^((p - 1) / 4) = -1.
+     */
+    fe_sqr(n, w);
+    fe_one(t);
+    fe_sub(n, n, t);
+    fe_mul(n, n, s_inv);
+    fe_mul(t, w, sqrt_486664);
+    fe_add(t, t, t);
+    fe_sub(n, n, t);
+
+    fe_sqr(n, n);
+    fe_sqr(t, w);
+    fe_mul(t, t, w);
+    fe_mul(n, n, t);
+
+    fe_pow_2e252m3(t, n);
+    fe_sqr(t, t);
+    fe_mul(t, t, n);
+    fe_one(n);
+    fe_add(t, t, n);
+
+    return fe_iszero(t);
+}
+
+/**
+ * Sets d to (Z - Y) X and returns true if it is non-zero. Otherwise h is
+ * the identity or the point (0, -1) of order 2, d is set to one and the
+ * outcome of the check is stored in result.
+ */
+static bool ge_subgroup_denominator(fe d, bool *result, const ge_p3 *h)
+{
+    fe t;
+
+    fe_sub(t, h->z, h->y);
+    fe_mul(d, t, h->x);
+    if (fe_iszero(d) == false)
+    {
+        return true;
+    }
+
+    *result = fe_iszero(t);
+    fe_one(d);
+    return false;
+}
+
 /**
  * @brief Checks whether or not the group-element lies on the main subgroup.
  * 
@@ -403,12 +631,95 @@ int32_t ge_frombytes(ge_p3* h, const uint8_t* P)
  * @return false otherwise
  */
 bool ge_is_on_main_subgroup(const ge_p3* h)
+{
+    fe inv;
+    bool result;
+
+    if (ge_subgroup_denominator(inv, &result, h) == false)
+    {
+        return result;
+    }
+    fe_inv(inv, inv);
+
+    return ge_is_on_main_subgroup_inv(h, inv);
+}
+
+/**
+ * @brief Checks whether or not each of the group-elements lies on the
+ * main subgroup, sharing one field inversion per GE_SUBGROUP_BATCH_SIZE
+ * elements.
+ * 
+ * @param result the n output flags
+ * @param h the n group elements
+ * @param n the number of group elements
+ */
+void ge_are_on_main_subgroup(bool *result, const ge_p3 *h, size_t n)
+{
+    fe den[GE_SUBGROUP_BATCH_SIZE];
+    fe acc[GE_SUBGROUP_BATCH_SIZE];
+    fe inv;
+    bool regular[GE_SUBGROUP_BATCH_SIZE];
+    size_t i, j, count;
+
+    for (i = 0; i < n; i += count)
+    {
+        count = n - i;
+        if (count > GE_SUBGROUP_BATCH_SIZE)
+        {
+            count = GE_SUBGROUP_BATCH_SIZE;
+        }
+
+        fe_one(inv);
+        for (j = 0; j < count; ++j)
+        {
+            regular[j] = ge_subgroup_denominator(den[j], &result[i + j], &h[i + j]);
+            fe_mul(inv, inv, den[j]);
+            fe_copy(acc[j], inv);
+        }
+
+        fe_inv(inv, inv);
+
+        /* Walk back, peeling one denominator off inv at a time */
+        for (j = count; j-- > 0;)
+        {
+            if (j > 0)
+            {
+                fe_mul(acc[j], acc[j - 1], inv);
+            }
+            else
+            {
+                fe_copy(acc[j], inv);
+            }
+            fe_mul(inv, inv, den[j]);
+            if (regular[j])
+            {
+                result[i + j] = ge_is_on_main_subgroup_inv(&h[i + j], acc[j]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Checks whether or not the group-element lies on the main subgroup
+ * by multiplying it by the group order.
+ * 
+ * @note Slower than ge_is_on_main_subgroup, kept as its reference.
+ * 
+ * @param h the group element
+ * @return true if the group element lies on the main subgroup
+ * @return false otherwise
+ */
+bool ge_is_on_main_subgroup_mul_l(const ge_p3* h)
 {
     ge_p3 pl;
+    fe t;
 
     ge_mul_l(&pl, h);
 
-    return fe_iszero(pl.x);
+    /* [l] h must be the identity, not merely have x = 0 like (0, -1) */
+    fe_sub(t, pl.y, pl.z);
+
+    return fe_iszero(pl.x) && fe_iszero(t);
 }
 
 /**
@@ -0,0 +1,435 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+/**
+ * @file ghash.c
+ *
+ * @brief GHASH universal hash of AES-GCM.
+ *
+ * On x86 CPUs with the carry-less multiply instruction, blocks are
+ * processed four at a time: the four products with H^4..H^1 are
+ * summed before a single reduction (aggregated reduction). The
+ * portable constant-time backend is used otherwise.
+ */
+
+#include <string.h>
+#include "cpu_features.h"
+#include "ghash.h"
+#include "utils.h"
+
+#if defined(VGP_X86_INTRINSICS)
+#include <immintrin.h>
+#endif
+
+#define GHASH_BACKEND_PORTABLE  0
+#define GHASH_BACKEND_PCLMUL    1
+
+static uint64_t big_endian_load64(const uint8_t *x)
+{
+    return ((uint64_t)x[0] << 56)
+        | ((uint64_t)x[1] << 48)
+        | ((uint64_t)x[2] << 40)
+        | ((uint64_t)x[3] << 32)
+        | ((uint64_t)x[4] << 24)
+        | ((uint64_t)x[5] << 16)
+        | ((uint64_t)x[6] <<  8)
+        | ((uint64_t)x[7]);
+}
+
+static void big_endian_store64(uint8_t *x, uint64_t u)
+{
+    x[7] = u & 0xFF; u >>= 8;
+    x[6] = u & 0xFF; u >>= 8;
+    x[5] = u & 0xFF; u >>= 8;
+    x[4] = u & 0xFF; u >>= 8;
+    x[3] = u & 0xFF; u >>= 8;
+    x[2] = u & 0xFF; u >>= 8;
+    x[1] = u & 0xFF; u >>= 8;
+    x[0] = u & 0xFF;
+}
+
+/**
+ * @brief Carry-less multiplication of two 64-bit words, keeping the
+ * low 64 bits of the product.
+ *
+ * The operands are split into four interleaved parts with holes of
+ * three bits, so that the carries of the integer multiplications
+ * never spill into the bits which are kept. Integer multiplication
+ * is assumed to be constant-time.
+ */
+static uint64_t bmul64(uint64_t x, uint64_t y)
+{
+    uint64_t x0, x1, x2, x3;
+    uint64_t y0, y1, y2, y3;
+    uint64_t z0, z1, z2, z3;
+
+    x0 = x & 0x1111111111111111ULL;
+    x1 = x & 0x2222222222222222ULL;
+    x2 = x & 0x4444444444444444ULL;
+    x3 = x & 0x8888888888888888ULL;
+    y0 = y & 0x1111111111111111ULL;
+    y1 = y & 0x2222222222222222ULL;
+    y2 = y & 0x4444444444444444ULL;
+    y3 = y & 0x8888888888888888ULL;
+    z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+    z0 &= 0x1111111111111111ULL;
+    z1 &= 0x2222222222222222ULL;
+    z2 &= 0x4444444444444444ULL;
+    z3 &= 0x8888888888888888ULL;
+
+    return z0 | z1 | z2 | z3;
+}
+
+/**
+ * @brief Reverses the bit order of a 64-bit word.
+ */
+static uint64_t rev64(uint64_t x)
+{
+    x = ((x & 0x5555555555555555ULL) <<  1) | ((x >>  1) & 0x5555555555555555ULL);
+    x = ((x & 0x3333333333333333ULL) <<  2) | ((x >>  2) & 0x3333333333333333ULL);
+    x = ((x & 0x0F0F0F0F0F0F0F0FULL) <<  4) | ((x >>  4) & 0x0F0F0F0F0F0F0F0FULL);
+    x = ((x & 0x00FF00FF00FF00FFULL) <<  8) | ((x >>  8) & 0x00FF00FF00FF00FFULL);
+    x = ((x & 0x0000FFFF0000FFFFULL) << 16) | ((x >> 16) & 0x0000FFFF0000FFFFULL);
+
+    return (x << 32) | (x >> 32);
+}
+
+/**
+ * @brief Precomputes the words of H and of its bit-reversal used
+ * by the Karatsuba multiplication of the portable backend.
+ */
+static void portable_init(ghash_key *key)
+{
+    uint64_t h0, h1;
+
+    h1 = big_endian_load64(key->h);
+    h0 = big_endian_load64(key->h + 8);
+    key->h_words[0] = h0;
+    key->h_words[1] = h1;
+    key->h_words[2] = h0 ^ h1;
+    key->h_words[3] = rev64(h0);
+    key->h_words[4] = rev64(h1);
+    key->h_words[5] = key->h_words[3] ^ key->h_words[4];
+}
+
+/**
+ * @brief Portable constant-time GHASH, following BearSSL's ctmul64.
+ *
+ * Each 128x128 multiplication is a Karatsuba over three 64x64
+ * carry-less multiplications; the high halves of these products
+ * are obtained by multiplying the bit-reversed operands.
+ */
+static void portable_update(const ghash_key *key,
+                            uint8_t *y,
+                            const uint8_t *data,
+                            size_t len)
+{
+    const uint8_t *src;
+    uint8_t last[GHASH_BLOCK_SIZE];
+    uint64_t y0, y1, y2, y0r, y1r, y2r;
+    uint64_t h0, h1, h2, h0r, h1r, h2r;
+    uint64_t z0, z1, z2, z0h, z1h, z2h;
+    uint64_t v0, v1, v2, v3;
+
+    h0  = key->h_words[0];
+    h1  = key->h_words[1];
+    h2  = key->h_words[2];
+    h0r = key->h_words[3];
+    h1r = key->h_words[4];
+    h2r = key->h_words[5];
+    y1 = big_endian_load64(y);
+    y0 = big_endian_load64(y + 8);
+
+    while (len > 0)
+    {
+        if (len >= GHASH_BLOCK_SIZE)
+        {
+            src = data;
+            data += GHASH_BLOCK_SIZE;
+            len -= GHASH_BLOCK_SIZE;
+        }
+        else
+        {
+            memset(last, 0, sizeof(last));
+            memcpy(last, data, len);
+            src = last;
+            len = 0;
+        }
+        y1 ^= big_endian_load64(src);
+        y0 ^= big_endian_load64(src + 8);
+
+        y0r = rev64(y0);
+        y1r = rev64(y1);
+        y2 = y0 ^ y1;
+        y2r = y0r ^ y1r;
+
+        z0 = bmul64(y0, h0);
+        z1 = bmul64(y1, h1);
+        z2 = bmul64(y2, h2);
+        z0h = bmul64(y0r, h0r);
+        z1h = bmul64(y1r, h1r);
+        z2h = bmul64(y2r, h2r);
+        z2 ^= z0 ^ z1;
+        z2h ^= z0h ^ z1h;
+        z0h = rev64(z0h) >> 1;
+        z1h = rev64(z1h) >> 1;
+        z2h = rev64(z2h) >> 1;
+
+        v0 = z0;
+        v1 = z0h ^ z2;
+        v2 = z1 ^ z2h;
+        v3 = z1h;
+
+        /* The product of reflected operands is shifted by one bit */
+        v3 = (v3 << 1) | (v2 >> 63);
+        v2 = (v2 << 1) | (v1 >> 63);
+        v1 = (v1 << 1) | (v0 >> 63);
+        v0 = (v0 << 1);
+
+        /* Reduction modulo x^128 + x^7 + x^2 + x + 1 */
+        v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+        v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+        v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+        v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+
+        y0 = v2;
+        y1 = v3;
+    }
+
+    big_endian_store64(y, y1);
+    big_endian_store64(y + 8, y0);
+
+    crypto_memzero(last, sizeof(last));
+}
+
+#if defined(VGP_X86_INTRINSICS)
+
+/**
+ * The carry-less multiply backend works on byte-reversed blocks,
+ * in which bit i of the register is the coefficient of x^(127-i).
+ */
+#define BYTE_REVERSE(x) _mm_shuffle_epi8((x), \
+    _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15))
+
+/**
+ * @brief Accumulates the unreduced 256-bit product a*b into the
+ * low, middle and high 128-bit parts lo, mid and hi.
+ */
+#define CLMUL_ACCUMULATE(lo, mid, hi, a, b) { \
+    lo  = _mm_xor_si128(lo, _mm_clmulepi64_si128(a, b, 0x00)); \
+    hi  = _mm_xor_si128(hi, _mm_clmulepi64_si128(a, b, 0x11)); \
+    mid = _mm_xor_si128(mid, _mm_clmulepi64_si128(a, b, 0x10)); \
+    mid = _mm_xor_si128(mid, _mm_clmulepi64_si128(a, b, 0x01)); \
+    }
+
+/**
+ * @brief Reduces an accumulated product modulo the GCM polynomial.
+ *
+ * The product of two bit-reflected operands is reflected over 255
+ * bits, it is first shifted left by one bit and then reduced as in
+ * Intel's "Carry-Less Multiplication and Its Usage for Computing
+ * the GCM Mode" white paper.
+ */
+VGP_TARGET("pclmul,ssse3")
+static __m128i clmul_reduce(__m128i lo, __m128i mid, __m128i hi)
+{
+    __m128i t2, t3, t4, t5, t6, t7, t8, t9;
+
+    t3 = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    t6 = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    t7 = _mm_srli_epi32(t3, 31);
+    t8 = _mm_srli_epi32(t6, 31);
+    t3 = _mm_slli_epi32(t3, 1);
+    t6 = _mm_slli_epi32(t6, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    t3 = _mm_or_si128(t3, t7);
+    t6 = _mm_or_si128(t6, t8);
+    t6 = _mm_or_si128(t6, t9);
+
+    t7 = _mm_slli_epi32(t3, 31);
+    t8 = _mm_slli_epi32(t3, 30);
+    t9 = _mm_slli_epi32(t3, 25);
+    t7 = _mm_xor_si128(t7, t8);
+    t7 = _mm_xor_si128(t7, t9);
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    t3 = _mm_xor_si128(t3, t7);
+
+    t2 = _mm_srli_epi32(t3, 1);
+    t4 = _mm_srli_epi32(t3, 2);
+    t5 = _mm_srli_epi32(t3, 7);
+    t2 = _mm_xor_si128(t2, t4);
+    t2 = _mm_xor_si128(t2, t5);
+    t2 = _mm_xor_si128(t2, t8);
+    t3 = _mm_xor_si128(t3, t2);
+
+    return _mm_xor_si128(t6, t3);
+}
+
+VGP_TARGET("pclmul,ssse3")
+static __m128i clmul_mul(__m128i a, __m128i b)
+{
+    __m128i lo, mid, hi;
+
+    lo = mid = hi = _mm_setzero_si128();
+    CLMUL_ACCUMULATE(lo, mid, hi, a, b);
+
+    return clmul_reduce(lo, mid, hi);
+}
+
+VGP_TARGET("pclmul,ssse3")
+static void clmul_init(ghash_key *key)
+{
+    __m128i h1, h2, h3, h4;
+
+    h1 = BYTE_REVERSE(_mm_loadu_si128((const __m128i *)key->h));
+    h2 = clmul_mul(h1, h1);
+    h3 = clmul_mul(h2, h1);
+    h4 = clmul_mul(h3, h1);
+
+    _mm_storeu_si128((__m128i *)key->h_pow[0], h1);
+    _mm_storeu_si128((__m128i *)key->h_pow[1], h2);
+    _mm_storeu_si128((__m128i *)key->h_pow[2], h3);
+    _mm_storeu_si128((__m128i *)key->h_pow[3], h4);
+}
+
+VGP_TARGET("pclmul,ssse3")
+static void clmul_update(const ghash_key *key,
+                         uint8_t *y,
+                         const uint8_t *data,
+                         size_t len)
+{
+    __m128i h1, h2, h3, h4;
+    __m128i x0, x1, x2, x3;
+    __m128i lo, mid, hi, acc;
+    uint8_t last[GHASH_BLOCK_SIZE];
+
+    h1 = _mm_loadu_si128((const __m128i *)key->h_pow[0]);
+    h2 = _mm_loadu_si128((const __m128i *)key->h_pow[1]);
+    h3 = _mm_loadu_si128((const __m128i *)key->h_pow[2]);
+    h4 = _mm_loadu_si128((const __m128i *)key->h_pow[3]);
+    acc = BYTE_REVERSE(_mm_loadu_si128((const __m128i *)y));
+
+    /* (acc + X0)*H^4 + X1*H^3 + X2*H^2 + X3*H, one reduction */
+    while (len >= 4 * GHASH_BLOCK_SIZE)
+    {
+        x0 = BYTE_REVERSE(_mm_loadu_si128((const __m128i *)data));
+        x1 = BYTE_REVERSE(_mm_loadu_si128((const __m128i *)data + 1));
+        x2 = BYTE_REVERSE(_mm_loadu_si128((const __m128i *)data + 2));
+        x3 = BYTE_REVERSE(_mm_loadu_si128((const __m128i *)data + 3));
+        x0 = _mm_xor_si128(x0, acc);
+
+        lo = mid = hi = _mm_setzero_si128();
+        CLMUL_ACCUMULATE(lo, mid, hi, x0, h4);
+        CLMUL_ACCUMULATE(lo, mid, hi, x1, h3);
+        CLMUL_ACCUMULATE(lo, mid, hi, x2, h2);
+        CLMUL_ACCUMULATE(lo, mid, hi, x3, h1);
+        acc = clmul_reduce(lo, mid, hi);
+
+        data += 4 * GHASH_BLOCK_SIZE;
+        len -= 4 * GHASH_BLOCK_SIZE;
+    }
+
+    while (len >= GHASH_BLOCK_SIZE)
+    {
+        x0 = BYTE_REVERSE(_mm_loadu_si128((const __m128i *)data));
+        acc = clmul_mul(_mm_xor_si128(acc, x0), h1);
+
+        data += GHASH_BLOCK_SIZE;
+        len -= GHASH_BLOCK_SIZE;
+    }
+
+    if (len > 0)
+    {
+        memset(last, 0, sizeof(last));
+        memcpy(last, data, len);
+        x0 = BYTE_REVERSE(_mm_loadu_si128((const __m128i *)last));
+        acc = clmul_mul(_mm_xor_si128(acc, x0), h1);
+        crypto_memzero(last, sizeof(last));
+    }
+
+    _mm_storeu_si128((__m128i *)y, BYTE_REVERSE(acc));
+}
+
+#endif
+
+void ghash_init(ghash_key *key, const uint8_t *h)
+{
+    memcpy(key->h, h, sizeof(key->h));
+    memset(key->h_pow, 0, sizeof(key->h_pow));
+    key->backend = GHASH_BACKEND_PORTABLE;
+    portable_init(key);
+
+#if defined(VGP_X86_INTRINSICS)
+    if ((cpu_features() & (CPU_FEATURE_PCLMUL | CPU_FEATURE_SSSE3)) ==
+        (CPU_FEATURE_PCLMUL | CPU_FEATURE_SSSE3))
+    {
+        key->backend = GHASH_BACKEND_PCLMUL;
+        clmul_init(key);
+    }
+#endif
+}
+
+void ghash_update(const ghash_key *key,
+                  uint8_t *y,
+                  const uint8_t *data,
+                  size_t len)
+{
+#if defined(VGP_X86_INTRINSICS)
+    if (key->backend == GHASH_BACKEND_PCLMUL)
+    {
+        clmul_update(key, y, data, len);
+        return;
+    }
+#endif
+    portable_update(key, y, data, len);
+}
+
+/**
+ * @brief Computes r = a * b in GF(2^128), r may overlap a or b.
+ */
+static void gf128_mul(uint8_t *r, const uint8_t *a, const uint8_t *b)
+{
+    ghash_key tmp;
+    uint8_t y[GHASH_BLOCK_SIZE];
+
+    memcpy(tmp.h, b, sizeof(tmp.h));
+    portable_init(&tmp);
+    memset(y, 0, sizeof(y));
+    portable_update(&tmp, y, a, sizeof(y));
+    memcpy(r, y, sizeof(y));
+
+    crypto_memzero(&tmp, sizeof(tmp));
+    crypto_memzero(y, sizeof(y));
+}
+
+void ghash_mul_power(const ghash_key *key, uint8_t *y, uint64_t n)
+{
+    uint8_t power[GHASH_BLOCK_SIZE];
+    uint8_t square[GHASH_BLOCK_SIZE];
+
+    /* The unit element is x^0, i.e. the most significant bit */
+    memset(power, 0, sizeof(power));
+    power[0] = 0x80;
+    memcpy(square, key->h, sizeof(square));
+
+    while (n > 0)
+    {
+        if (n & 1)
+        {
+            gf128_mul(power, power, square);
+        }
+        gf128_mul(square, square, square);
+        n >>= 1;
+    }
+    gf128_mul(y, y, power);
+
+    crypto_memzero(power, sizeof(power));
+    crypto_memzero(square, sizeof(square));
+}
@@ -0,0 +1,624 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+/**
+ * @file keccakf1600.c
+ *
+ * @brief The Keccak-f[1600] permutation.
+ *
+ * On 64-bit targets the 24 rounds are fully unrolled with the 25 lanes
+ * held in local variables, which the compiler can keep in registers,
+ * and rho and pi folded into the lane names. The lane complementing
+ * transform of the Keccak implementation overview (section 2.2) is
+ * applied: with lanes 1, 2, 8, 12, 17 and 20 stored complemented, chi
+ * needs a single NOT per plane instead of five. The lanes are
+ * complemented on entry and restored on exit.
+ *
+ * On 32-bit targets each lane is bit-interleaved into two 32-bit
+ * words holding its even and its odd bits, so that every 64-bit
+ * rotation becomes two 32-bit rotations. The lanes are interleaved on
+ * entry and restored on exit, the state layout is the same for both
+ * implementations. Defining VGP_KECCAK_BIT_INTERLEAVED selects this
+ * implementation on 64-bit targets too, for testing.
+ *
+ * keccakf1600_x4() runs four permutations at once in the 64-bit lanes
+ * of AVX2 registers when the CPU supports it, and one after the other
+ * otherwise.
+ */
+
+#include <stdint.h>
+#include "cpu_features.h"
+#include "keccakf1600.h"
+#include "utils.h"
+
+#if defined(VGP_X86_INTRINSICS)
+#include <immintrin.h>
+#endif
+
+#if UINTPTR_MAX == 0xFFFFFFFF || defined(VGP_KECCAK_BIT_INTERLEAVED)
+#define KECCAK_BIT_INTERLEAVED  1
+#endif
+
+#if !defined(KECCAK_BIT_INTERLEAVED) || defined(VGP_X86_INTRINSICS)
+static const uint64_t RC[24] = \
+{   1ULL, 0x8082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x808bULL, 0x80000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x8aULL, 0x88ULL, 0x80008009ULL, 0x8000000aULL,
+    0x8000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x80000001ULL, 0x8000000080008008ULL
+};
+#endif
+
+#if !defined(KECCAK_BIT_INTERLEAVED)
+
+#define ROL64(x, s) (((x) << (s)) | ((x) >> (64 - (s))))
+
+/**
+ * One round from the lanes A##yx to the lanes E##yx, where y is one of
+ * b, g, k, m, s and x one of a, e, i, o, u. Ba..Bu are the lanes of one
+ * output plane after theta, rho and pi.
+ */
+#define KECCAK_ROUND(A, E, rc)                  \
+    Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa; \
+    Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se; \
+    Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si; \
+    Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so; \
+    Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su; \
+    Da = Cu ^ ROL64(Ce, 1);                     \
+    De = Ca ^ ROL64(Ci, 1);                     \
+    Di = Ce ^ ROL64(Co, 1);                     \
+    Do = Ci ^ ROL64(Cu, 1);                     \
+    Du = Co ^ ROL64(Ca, 1);                     \
+                                                \
+    A##ba ^= Da; Ba = A##ba;                    \
+    A##ge ^= De; Be = ROL64(A##ge, 44);         \
+    A##ki ^= Di; Bi = ROL64(A##ki, 43);         \
+    A##mo ^= Do; Bo = ROL64(A##mo, 21);         \
+    A##su ^= Du; Bu = ROL64(A##su, 14);         \
+    E##ba = Ba ^ (Be | Bi) ^ (rc);              \
+    E##be = Be ^ (~Bi | Bo);                    \
+    E##bi = Bi ^ (Bo & Bu);                     \
+    E##bo = Bo ^ (Bu | Ba);                     \
+    E##bu = Bu ^ (Ba & Be);                     \
+                                                \
+    A##bo ^= Do; Ba = ROL64(A##bo, 28);         \
+    A##gu ^= Du; Be = ROL64(A##gu, 20);         \
+    A##ka ^= Da; Bi = ROL64(A##ka, 3);          \
+    A##me ^= De; Bo = ROL64(A##me, 45);         \
+    A##si ^= Di; Bu = ROL64(A##si, 61);         \
+    E##ga = Ba ^ (Be | Bi);                     \
+    E##ge = Be ^ (Bi & Bo);                     \
+    E##gi = Bi ^ (Bo | ~Bu);                    \
+    E##go = Bo ^ (Bu | Ba);                     \
+    E##gu = Bu ^ (Ba & Be);                     \
+                                                \
+    A##be ^= De; Ba = ROL64(A##be, 1);          \
+    A##gi ^= Di; Be = ROL64(A##gi, 6);          \
+    A##ko ^= Do; Bi = ROL64(A##ko, 25);         \
+    A##mu ^= Du; Bo = ROL64(A##mu, 8);          \
+    A##sa ^= Da; Bu = ROL64(A##sa, 18);         \
+    E##ka = Ba ^ (Be | Bi);                     \
+    E##ke = Be ^ (Bi & Bo);                     \
+    E##ki = Bi ^ (~Bo & Bu);                    \
+    E##ko = ~Bo ^ (Bu | Ba);                    \
+    E##ku = Bu ^ (Ba & Be);                     \
+                                                \
+    A##bu ^= Du; Ba = ROL64(A##bu, 27);         \
+    A##ga ^= Da; Be = ROL64(A##ga, 36);         \
+    A##ke ^= De; Bi = ROL64(A##ke, 10);         \
+    A##mi ^= Di; Bo = ROL64(A##mi, 15);         \
+    A##so ^= Do; Bu = ROL64(A##so, 56);         \
+    E##ma = Ba ^ (Be & Bi);                     \
+    E##me = Be ^ (Bi | Bo);                     \
+    E##mi = Bi ^ (~Bo | Bu);                    \
+    E##mo = ~Bo ^ (Bu & Ba);                    \
+    E##mu = Bu ^ (Ba | Be);                     \
+                                                \
+    A##bi ^= Di; Ba = ROL64(A##bi, 62);         \
+    A##go ^= Do; Be = ROL64(A##go, 55);         \
+    A##ku ^= Du; Bi = ROL64(A##ku, 39);         \
+    A##ma ^= Da; Bo = ROL64(A##ma, 41);         \
+    A##se ^= De; Bu = ROL64(A##se, 2);          \
+    E##sa = Ba ^ (~Be & Bi);                    \
+    E##se = ~Be ^ (Bi | Bo);                    \
+    E##si = Bi ^ (Bo & Bu);                     \
+    E##so = Bo ^ (Bu | Ba);                     \
+    E##su = Bu ^ (Ba & Be);
+
+void keccakf1600(uint64_t *state)
+{
+    uint64_t Aba, Abe, Abi, Abo, Abu;
+    uint64_t Aga, Age, Agi, Ago, Agu;
+    uint64_t Aka, Ake, Aki, Ako, Aku;
+    uint64_t Ama, Ame, Ami, Amo, Amu;
+    uint64_t Asa, Ase, Asi, Aso, Asu;
+    uint64_t Eba, Ebe, Ebi, Ebo, Ebu;
+    uint64_t Ega, Ege, Egi, Ego, Egu;
+    uint64_t Eka, Eke, Eki, Eko, Eku;
+    uint64_t Ema, Eme, Emi, Emo, Emu;
+    uint64_t Esa, Ese, Esi, Eso, Esu;
+    uint64_t Ba, Be, Bi, Bo, Bu;
+    uint64_t Ca, Ce, Ci, Co, Cu;
+    uint64_t Da, De, Di, Do, Du;
+
+    Aba = state[0];
+    Abe = ~state[1];
+    Abi = ~state[2];
+    Abo = state[3];
+    Abu = state[4];
+    Aga = state[5];
+    Age = state[6];
+    Agi = state[7];
+    Ago = ~state[8];
+    Agu = state[9];
+    Aka = state[10];
+    Ake = state[11];
+    Aki = ~state[12];
+    Ako = state[13];
+    Aku = state[14];
+    Ama = state[15];
+    Ame = state[16];
+    Ami = ~state[17];
+    Amo = state[18];
+    Amu = state[19];
+    Asa = ~state[20];
+    Ase = state[21];
+    Asi = state[22];
+    Aso = state[23];
+    Asu = state[24];
+
+    KECCAK_ROUND(A, E, RC[0])
+    KECCAK_ROUND(E, A, RC[1])
+    KECCAK_ROUND(A, E, RC[2])
+    KECCAK_ROUND(E, A, RC[3])
+    KECCAK_ROUND(A, E, RC[4])
+    KECCAK_ROUND(E, A, RC[5])
+    KECCAK_ROUND(A, E, RC[6])
+    KECCAK_ROUND(E, A, RC[7])
+    KECCAK_ROUND(A, E, RC[8])
+    KECCAK_ROUND(E, A, RC[9])
+    KECCAK_ROUND(A, E, RC[10])
+    KECCAK_ROUND(E, A, RC[11])
+    KECCAK_ROUND(A, E, RC[12])
+    KECCAK_ROUND(E, A, RC[13])
+    KECCAK_ROUND(A, E, RC[14])
+    KECCAK_ROUND(E, A, RC[15])
+    KECCAK_ROUND(A, E, RC[16])
+    KECCAK_ROUND(E, A, RC[17])
+    KECCAK_ROUND(A, E, RC[18])
+    KECCAK_ROUND(E, A, RC[19])
+    KECCAK_ROUND(A, E, RC[20])
+    KECCAK_ROUND(E, A, RC[21])
+    KECCAK_ROUND(A, E, RC[22])
+    KECCAK_ROUND(E, A, RC[23])
+
+    state[0] = Aba;
+    state[1] = ~Abe;
+    state[2] = ~Abi;
+    state[3] = Abo;
+    state[4] = Abu;
+    state[5] = Aga;
+    state[6] = Age;
+    state[7] = Agi;
+    state[8] = ~Ago;
+    state[9] = Agu;
+    state[10] = Aka;
+    state[11] = Ake;
+    state[12] = ~Aki;
+    state[13] = Ako;
+    state[14] = Aku;
+    state[15] = Ama;
+    state[16] = Ame;
+    state[17] = ~Ami;
+    state[18] = Amo;
+    state[19] = Amu;
+    state[20] = ~Asa;
+    state[21] = Ase;
+    state[22] = Asi;
+    state[23] = Aso;
+    state[24] = Asu;
+}
+
+#else
+
+static const uint32_t RC_BI[24][2] =
+{
+    { 0x00000001, 0x00000000 }, { 0x00000000, 0x00000089 },
+    { 0x00000000, 0x8000008B }, { 0x00000000, 0x80008080 },
+    { 0x00000001, 0x0000008B }, { 0x00000001, 0x00008000 },
+    { 0x00000001, 0x80008088 }, { 0x00000001, 0x80000082 },
+    { 0x00000000, 0x0000000B }, { 0x00000000, 0x0000000A },
+    { 0x00000001, 0x00008082 }, { 0x00000000, 0x00008003 },
+    { 0x00000001, 0x0000808B }, { 0x00000001, 0x8000000B },
+    { 0x00000001, 0x8000008A }, { 0x00000001, 0x80000081 },
+    { 0x00000000, 0x80000081 }, { 0x00000000, 0x80000008 },
+    { 0x00000000, 0x00000083 }, { 0x00000000, 0x80008003 },
+    { 0x00000001, 0x80008088 }, { 0x00000000, 0x80000088 },
+    { 0x00000001, 0x00008000 }, { 0x00000000, 0x80008082 }
+};
+
+#define ROL32(x, s) (((x) << (s)) | ((x) >> (32 - (s))))
+
+/* Moves the even bits of x to its low half and the odd bits to its high half */
+static uint32_t unshuffle32(uint32_t x)
+{
+    uint32_t t;
+
+    t = (x ^ (x >> 1)) & 0x22222222; x ^= t ^ (t << 1);
+    t = (x ^ (x >> 2)) & 0x0C0C0C0C; x ^= t ^ (t << 2);
+    t = (x ^ (x >> 4)) & 0x00F000F0; x ^= t ^ (t << 4);
+    t = (x ^ (x >> 8)) & 0x0000FF00; x ^= t ^ (t << 8);
+    return x;
+}
+
+/* The inverse of unshuffle32() */
+static uint32_t shuffle32(uint32_t x)
+{
+    uint32_t t;
+
+    t = (x ^ (x >> 8)) & 0x0000FF00; x ^= t ^ (t << 8);
+    t = (x ^ (x >> 4)) & 0x00F000F0; x ^= t ^ (t << 4);
+    t = (x ^ (x >> 2)) & 0x0C0C0C0C; x ^= t ^ (t << 2);
+    t = (x ^ (x >> 1)) & 0x22222222; x ^= t ^ (t << 1);
+    return x;
+}
+
+void keccakf1600(uint64_t *state)
+{
+    uint32_t Ae[25], Ao[25], Be[25], Bo[25];
+    uint32_t Ce[5], Co[5], De[5], Do[5];
+    uint32_t lo, hi;
+    uint32_t i, round;
+
+    for (i = 0; i < 25; ++i)
+    {
+        lo = unshuffle32((uint32_t)state[i]);
+        hi = unshuffle32((uint32_t)(state[i] >> 32));
+        Ae[i] = (lo & 0x0000FFFF) | (hi << 16);
+        Ao[i] = (lo >> 16) | (hi & 0xFFFF0000);
+    }
+
+    for (round = 0; round < 24; ++round)
+    {
+        /* Theta */
+        Ce[0] = Ae[0] ^ Ae[5] ^ Ae[10] ^ Ae[15] ^ Ae[20];
+        Co[0] = Ao[0] ^ Ao[5] ^ Ao[10] ^ Ao[15] ^ Ao[20];
+        Ce[1] = Ae[1] ^ Ae[6] ^ Ae[11] ^ Ae[16] ^ Ae[21];
+        Co[1] = Ao[1] ^ Ao[6] ^ Ao[11] ^ Ao[16] ^ Ao[21];
+        Ce[2] = Ae[2] ^ Ae[7] ^ Ae[12] ^ Ae[17] ^ Ae[22];
+        Co[2] = Ao[2] ^ Ao[7] ^ Ao[12] ^ Ao[17] ^ Ao[22];
+        Ce[3] = Ae[3] ^ Ae[8] ^ Ae[13] ^ Ae[18] ^ Ae[23];
+        Co[3] = Ao[3] ^ Ao[8] ^ Ao[13] ^ Ao[18] ^ Ao[23];
+        Ce[4] = Ae[4] ^ Ae[9] ^ Ae[14] ^ Ae[19] ^ Ae[24];
+        Co[4] = Ao[4] ^ Ao[9] ^ Ao[14] ^ Ao[19] ^ Ao[24];
+        De[0] = Ce[4] ^ ROL32(Co[1], 1);
+        Do[0] = Co[4] ^ Ce[1];
+        De[1] = Ce[0] ^ ROL32(Co[2], 1);
+        Do[1] = Co[0] ^ Ce[2];
+        De[2] = Ce[1] ^ ROL32(Co[3], 1);
+        Do[2] = Co[1] ^ Ce[3];
+        De[3] = Ce[2] ^ ROL32(Co[4], 1);
+        Do[3] = Co[2] ^ Ce[4];
+        De[4] = Ce[3] ^ ROL32(Co[0], 1);
+        Do[4] = Co[3] ^ Ce[0];
+        /* Rho and pi */
+        Be[0] = Ae[0] ^ De[0];
+        Bo[0] = Ao[0] ^ Do[0];
+        Be[10] = ROL32(Ao[1] ^ Do[1], 1);
+        Bo[10] = Ae[1] ^ De[1];
+        Be[20] = ROL32(Ae[2] ^ De[2], 31);
+        Bo[20] = ROL32(Ao[2] ^ Do[2], 31);
+        Be[5] = ROL32(Ae[3] ^ De[3], 14);
+        Bo[5] = ROL32(Ao[3] ^ Do[3], 14);
+        Be[15] = ROL32(Ao[4] ^ Do[4], 14);
+        Bo[15] = ROL32(Ae[4] ^ De[4], 13);
+        Be[16] = ROL32(Ae[5] ^ De[0], 18);
+        Bo[16] = ROL32(Ao[5] ^ Do[0], 18);
+        Be[1] = ROL32(Ae[6] ^ De[1], 22);
+        Bo[1] = ROL32(Ao[6] ^ Do[1], 22);
+        Be[11] = ROL32(Ae[7] ^ De[2], 3);
+        Bo[11] = ROL32(Ao[7] ^ Do[2], 3);
+        Be[21] = ROL32(Ao[8] ^ Do[3], 28);
+        Bo[21] = ROL32(Ae[8] ^ De[3], 27);
+        Be[6] = ROL32(Ae[9] ^ De[4], 10);
+        Bo[6] = ROL32(Ao[9] ^ Do[4], 10);
+        Be[7] = ROL32(Ao[10] ^ Do[0], 2);
+        Bo[7] = ROL32(Ae[10] ^ De[0], 1);
+        Be[17] = ROL32(Ae[11] ^ De[1], 5);
+        Bo[17] = ROL32(Ao[11] ^ Do[1], 5);
+        Be[2] = ROL32(Ao[12] ^ Do[2], 22);
+        Bo[2] = ROL32(Ae[12] ^ De[2], 21);
+        Be[12] = ROL32(Ao[13] ^ Do[3], 13);
+        Bo[12] = ROL32(Ae[13] ^ De[3], 12);
+        Be[22] = ROL32(Ao[14] ^ Do[4], 20);
+        Bo[22] = ROL32(Ae[14] ^ De[4], 19);
+        Be[23] = ROL32(Ao[15] ^ Do[0], 21);
+        Bo[23] = ROL32(Ae[15] ^ De[0], 20);
+        Be[8] = ROL32(Ao[16] ^ Do[1], 23);
+        Bo[8] = ROL32(Ae[16] ^ De[1], 22);
+        Be[18] = ROL32(Ao[17] ^ Do[2], 8);
+        Bo[18] = ROL32(Ae[17] ^ De[2], 7);
+        Be[3] = ROL32(Ao[18] ^ Do[3], 11);
+        Bo[3] = ROL32(Ae[18] ^ De[3], 10);
+        Be[13] = ROL32(Ae[19] ^ De[4], 4);
+        Bo[13] = ROL32(Ao[19] ^ Do[4], 4);
+        Be[14] = ROL32(Ae[20] ^ De[0], 9);
+        Bo[14] = ROL32(Ao[20] ^ Do[0], 9);
+        Be[24] = ROL32(Ae[21] ^ De[1], 1);
+        Bo[24] = ROL32(Ao[21] ^ Do[1], 1);
+        Be[9] = ROL32(Ao[22] ^ Do[2], 31);
+        Bo[9] = ROL32(Ae[22] ^ De[2], 30);
+        Be[19] = ROL32(Ae[23] ^ De[3], 28);
+        Bo[19] = ROL32(Ao[23] ^ Do[3], 28);
+        Be[4] = ROL32(Ae[24] ^ De[4], 7);
+        Bo[4] = ROL32(Ao[24] ^ Do[4], 7);
+        /* Chi */
+        Ae[0] = Be[0] ^ (~Be[1] & Be[2]);
+        Ao[0] = Bo[0] ^ (~Bo[1] & Bo[2]);
+        Ae[1] = Be[1] ^ (~Be[2] & Be[3]);
+        Ao[1] = Bo[1] ^ (~Bo[2] & Bo[3]);
+        Ae[2] = Be[2] ^ (~Be[3] & Be[4]);
+        Ao[2] = Bo[2] ^ (~Bo[3] & Bo[4]);
+        Ae[3] = Be[3] ^ (~Be[4] & Be[0]);
+        Ao[3] = Bo[3] ^ (~Bo[4] & Bo[0]);
+        Ae[4] = Be[4] ^ (~Be[0] & Be[1]);
+        Ao[4] = Bo[4] ^ (~Bo[0] & Bo[1]);
+        Ae[5] = Be[5] ^ (~Be[6] & Be[7]);
+        Ao[5] = Bo[5] ^ (~Bo[6] & Bo[7]);
+        Ae[6] = Be[6] ^ (~Be[7] & Be[8]);
+        Ao[6] = Bo[6] ^ (~Bo[7] & Bo[8]);
+        Ae[7] = Be[7] ^ (~Be[8] & Be[9]);
+        Ao[7] = Bo[7] ^ (~Bo[8] & Bo[9]);
+        Ae[8] = Be[8] ^ (~Be[9] & Be[5]);
+        Ao[8] = Bo[8] ^ (~Bo[9] & Bo[5]);
+        Ae[9] = Be[9] ^ (~Be[5] & Be[6]);
+        Ao[9] = Bo[9] ^ (~Bo[5] & Bo[6]);
+        Ae[10] = Be[10] ^ (~Be[11] & Be[12]);
+        Ao[10] = Bo[10] ^ (~Bo[11] & Bo[12]);
+        Ae[11] = Be[11] ^ (~Be[12] & Be[13]);
+        Ao[11] = Bo[11] ^ (~Bo[12] & Bo[13]);
+        Ae[12] = Be[12] ^ (~Be[13] & Be[14]);
+        Ao[12] = Bo[12] ^ (~Bo[13] & Bo[14]);
+        Ae[13] = Be[13] ^ (~Be[14] & Be[10]);
+        Ao[13] = Bo[13] ^ (~Bo[14] & Bo[10]);
+        Ae[14] = Be[14] ^ (~Be[10] & Be[11]);
+        Ao[14] = Bo[14] ^ (~Bo[10] & Bo[11]);
+        Ae[15] = Be[15] ^ (~Be[16] & Be[17]);
+        Ao[15] = Bo[15] ^ (~Bo[16] & Bo[17]);
+        Ae[16] = Be[16] ^ (~Be[17] & Be[18]);
+        Ao[16] = Bo[16] ^ (~Bo[17] & Bo[18]);
+        Ae[17] = Be[17] ^ (~Be[18] & Be[19]);
+        Ao[17] = Bo[17] ^ (~Bo[18] & Bo[19]);
+        Ae[18] = Be[18] ^ (~Be[19] & Be[15]);
+        Ao[18] = Bo[18] ^ (~Bo[19] & Bo[15]);
+        Ae[19] = Be[19] ^ (~Be[15] & Be[16]);
+        Ao[19] = Bo[19] ^ (~Bo[15] & Bo[16]);
+        Ae[20] = Be[20] ^ (~Be[21] & Be[22]);
+        Ao[20] = Bo[20] ^ (~Bo[21] & Bo[22]);
+        Ae[21] = Be[21] ^ (~Be[22] & Be[23]);
+        Ao[21] = Bo[21] ^ (~Bo[22] & Bo[23]);
+        Ae[22] = Be[22] ^ (~Be[23] & Be[24]);
+        Ao[22] = Bo[22] ^ (~Bo[23] & Bo[24]);
+        Ae[23] = Be[23] ^ (~Be[24] & Be[20]);
+        Ao[23] = Bo[23] ^ (~Bo[24] & Bo[20]);
+        Ae[24] = Be[24] ^ (~Be[20] & Be[21]);
+        Ao[24] = Bo[24] ^ (~Bo[20] & Bo[21]);
+        /* Iota */
+        Ae[0] ^= RC_BI[round][0];
+        Ao[0] ^= RC_BI[round][1];
+    }
+
+    for (i = 0; i < 25; ++i)
+    {
+        lo = shuffle32((Ae[i] & 0x0000FFFF) | (Ao[i] << 16));
+        hi = shuffle32((Ae[i] >> 16) | (Ao[i] & 0xFFFF0000));
+        state[i] = ((uint64_t)hi << 32) | lo;
+    }
+}
+
+#endif
+
+#if defined(VGP_X86_INTRINSICS)
+
+#define XOR5(a, b, c, d, e) \
+    _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(a, b), \
+                                      _mm256_xor_si256(c, d)), e)
+#define ROL64X4(x, s) \
+    _mm256_or_si256(_mm256_slli_epi64(x, s), _mm256_srli_epi64(x, 64 - (s)))
+
+/**
+ * The round of KECCAK_ROUND on four interleaved states, chi uses
+ * the AND-NOT instruction so no lane is complemented.
+ */
+#define KECCAK_ROUND_X4(A, E, rc)                                                    \
+    Ca = XOR5(A##ba, A##ga, A##ka, A##ma, A##sa);                                    \
+    Ce = XOR5(A##be, A##ge, A##ke, A##me, A##se);                                    \
+    Ci = XOR5(A##bi, A##gi, A##ki, A##mi, A##si);                                    \
+    Co = XOR5(A##bo, A##go, A##ko, A##mo, A##so);                                    \
+    Cu = XOR5(A##bu, A##gu, A##ku, A##mu, A##su);                                    \
+    Da = _mm256_xor_si256(Cu, ROL64X4(Ce, 1));                                       \
+    De = _mm256_xor_si256(Ca, ROL64X4(Ci, 1));                                       \
+    Di = _mm256_xor_si256(Ce, ROL64X4(Co, 1));                                       \
+    Do = _mm256_xor_si256(Ci, ROL64X4(Cu, 1));                                       \
+    Du = _mm256_xor_si256(Co, ROL64X4(Ca, 1));                                       \
+                                                                                     \
+    Ba = _mm256_xor_si256(A##ba, Da);                                                \
+    Be = ROL64X4(_mm256_xor_si256(A##ge, De), 44);                                   \
+    Bi = ROL64X4(_mm256_xor_si256(A##ki, Di), 43);                                   \
+    Bo = ROL64X4(_mm256_xor_si256(A##mo, Do), 21);                                   \
+    Bu = ROL64X4(_mm256_xor_si256(A##su, Du), 14);                                   \
+    E##ba = _mm256_xor_si256(_mm256_xor_si256(Ba, _mm256_andnot_si256(Be, Bi)), rc); \
+    E##be = _mm256_xor_si256(Be, _mm256_andnot_si256(Bi, Bo));                       \
+    E##bi = _mm256_xor_si256(Bi, _mm256_andnot_si256(Bo, Bu));                       \
+    E##bo = _mm256_xor_si256(Bo, _mm256_andnot_si256(Bu, Ba));                       \
+    E##bu = _mm256_xor_si256(Bu, _mm256_andnot_si256(Ba, Be));                       \
+                                                                                     \
+    Ba = ROL64X4(_mm256_xor_si256(A##bo, Do), 28);                                   \
+    Be = ROL64X4(_mm256_xor_si256(A##gu, Du), 20);                                   \
+    Bi = ROL64X4(_mm256_xor_si256(A##ka, Da), 3);                                    \
+    Bo = ROL64X4(_mm256_xor_si256(A##me, De), 45);                                   \
+    Bu = ROL64X4(_mm256_xor_si256(A##si, Di), 61);                                   \
+    E##ga = _mm256_xor_si256(Ba, _mm256_andnot_si256(Be, Bi));                       \
+    E##ge = _mm256_xor_si256(Be, _mm256_andnot_si256(Bi, Bo));                       \
+    E##gi = _mm256_xor_si256(Bi, _mm256_andnot_si256(Bo, Bu));                       \
+    E##go = _mm256_xor_si256(Bo, _mm256_andnot_si256(Bu, Ba));                       \
+    E##gu = _mm256_xor_si256(Bu, _mm256_andnot_si256(Ba, Be));                       \
+                                                                                     \
+    Ba = ROL64X4(_mm256_xor_si256(A##be, De), 1);                                    \
+    Be = ROL64X4(_mm256_xor_si256(A##gi, Di), 6);                                    \
+    Bi = ROL64X4(_mm256_xor_si256(A##ko, Do), 25);                                   \
+    Bo = ROL64X4(_mm256_xor_si256(A##mu, Du), 8);                                    \
+    Bu = ROL64X4(_mm256_xor_si256(A##sa, Da), 18);                                   \
+    E##ka = _mm256_xor_si256(Ba, _mm256_andnot_si256(Be, Bi));                       \
+    E##ke = _mm256_xor_si256(Be, _mm256_andnot_si256(Bi, Bo));                       \
+    E##ki = _mm256_xor_si256(Bi, _mm256_andnot_si256(Bo, Bu));                       \
+    E##ko = _mm256_xor_si256(Bo, _mm256_andnot_si256(Bu, Ba));                       \
+    E##ku = _mm256_xor_si256(Bu, _mm256_andnot_si256(Ba, Be));                       \
+                                                                                     \
+    Ba = ROL64X4(_mm256_xor_si256(A##bu, Du), 27);                                   \
+    Be = ROL64X4(_mm256_xor_si256(A##ga, Da), 36);                                   \
+    Bi = ROL64X4(_mm256_xor_si256(A##ke, De), 10);                                   \
+    Bo = ROL64X4(_mm256_xor_si256(A##mi, Di), 15);                                   \
+    Bu = ROL64X4(_mm256_xor_si256(A##so, Do), 56);                                   \
+    E##ma = _mm256_xor_si256(Ba, _mm256_andnot_si256(Be, Bi));                       \
+    E##me = _mm256_xor_si256(Be, _mm256_andnot_si256(Bi, Bo));                       \
+    E##mi = _mm256_xor_si256(Bi, _mm256_andnot_si256(Bo, Bu));                       \
+    E##mo = _mm256_xor_si256(Bo, _mm256_andnot_si256(Bu, Ba));                       \
+    E##mu = _mm256_xor_si256(Bu, _mm256_andnot_si256(Ba, Be));                       \
+                                                                                     \
+    Ba = ROL64X4(_mm256_xor_si256(A##bi, Di), 62);                                   \
+    Be = ROL64X4(_mm256_xor_si256(A##go, Do), 55);                                   \
+    Bi = ROL64X4(_mm256_xor_si256(A##ku, Du), 39);                                   \
+    Bo = ROL64X4(_mm256_xor_si256(A##ma, Da), 41);                                   \
+    Bu = ROL64X4(_mm256_xor_si256(A##se, De), 2);                                    \
+    E##sa = _mm256_xor_si256(Ba, _mm256_andnot_si256(Be, Bi));                       \
+    E##se = _mm256_xor_si256(Be, _mm256_andnot_si256(Bi, Bo));                       \
+    E##si = _mm256_xor_si256(Bi, _mm256_andnot_si256(Bo, Bu));                       \
+    E##so = _mm256_xor_si256(Bo, _mm256_andnot_si256(Bu, Ba));                       \
+    E##su = _mm256_xor_si256(Bu, _mm256_andnot_si256(Ba, Be));
+
+VGP_TARGET("avx2")
+static void keccakf1600_x4_avx2(uint64_t *state)
+{
+    __m256i Aba, Abe, Abi, Abo, Abu;
+    __m256i Aga, Age, Agi, Ago, Agu;
+    __m256i Aka, Ake, Aki, Ako, Aku;
+    __m256i Ama, Ame, Ami, Amo, Amu;
+    __m256i Asa, Ase, Asi, Aso, Asu;
+    __m256i Eba, Ebe, Ebi, Ebo, Ebu;
+    __m256i Ega, Ege, Egi, Ego, Egu;
+    __m256i Eka, Eke, Eki, Eko, Eku;
+    __m256i Ema, Eme, Emi, Emo, Emu;
+    __m256i Esa, Ese, Esi, Eso, Esu;
+    __m256i Ba, Be, Bi, Bo, Bu;
+    __m256i Ca, Ce, Ci, Co, Cu;
+    __m256i Da, De, Di, Do, Du;
+
+    Aba = _mm256_loadu_si256((const __m256i *)(state + 0));
+    Abe = _mm256_loadu_si256((const __m256i *)(state + 4));
+    Abi = _mm256_loadu_si256((const __m256i *)(state + 8));
+    Abo = _mm256_loadu_si256((const __m256i *)(state + 12));
+    Abu = _mm256_loadu_si256((const __m256i *)(state + 16));
+    Aga = _mm256_loadu_si256((const __m256i *)(state + 20));
+    Age = _mm256_loadu_si256((const __m256i *)(state + 24));
+    Agi = _mm256_loadu_si256((const __m256i *)(state + 28));
+    Ago = _mm256_loadu_si256((const __m256i *)(state + 32));
+    Agu = _mm256_loadu_si256((const __m256i *)(state + 36));
+    Aka = _mm256_loadu_si256((const __m256i *)(state + 40));
+    Ake = _mm256_loadu_si256((const __m256i *)(state + 44));
+    Aki = _mm256_loadu_si256((const __m256i *)(state + 48));
+    Ako = _mm256_loadu_si256((const __m256i *)(state + 52));
+    Aku = _mm256_loadu_si256((const __m256i *)(state + 56));
+    Ama = _mm256_loadu_si256((const __m256i *)(state + 60));
+    Ame = _mm256_loadu_si256((const __m256i *)(state + 64));
+    Ami = _mm256_loadu_si256((const __m256i *)(state + 68));
+    Amo = _mm256_loadu_si256((const __m256i *)(state + 72));
+    Amu = _mm256_loadu_si256((const __m256i *)(state + 76));
+    Asa = _mm256_loadu_si256((const __m256i *)(state + 80));
+    Ase = _mm256_loadu_si256((const __m256i *)(state + 84));
+    Asi = _mm256_loadu_si256((const __m256i *)(state + 88));
+    Aso = _mm256_loadu_si256((const __m256i *)(state + 92));
+    Asu = _mm256_loadu_si256((const __m256i *)(state + 96));
+
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[0]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[1]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[2]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[3]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[4]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[5]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[6]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[7]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[8]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[9]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[10]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[11]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[12]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[13]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[14]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[15]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[16]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[17]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[18]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[19]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[20]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[21]))
+    KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x((long long)RC[22]))
+    KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x((long long)RC[23]))
+
+    _mm256_storeu_si256((__m256i *)(state + 0), Aba);
+    _mm256_storeu_si256((__m256i *)(state + 4), Abe);
+    _mm256_storeu_si256((__m256i *)(state + 8), Abi);
+    _mm256_storeu_si256((__m256i *)(state + 12), Abo);
+    _mm256_storeu_si256((__m256i *)(state + 16), Abu);
+    _mm256_storeu_si256((__m256i *)(state + 20), Aga);
+    _mm256_storeu_si256((__m256i *)(state + 24), Age);
+    _mm256_storeu_si256((__m256i *)(state + 28), Agi);
+    _mm256_storeu_si256((__m256i *)(state + 32), Ago);
+    _mm256_storeu_si256((__m256i *)(state + 36), Agu);
+    _mm256_storeu_si256((__m256i *)(state + 40), Aka);
+    _mm256_storeu_si256((__m256i *)(state + 44), Ake);
+    _mm256_storeu_si256((__m256i *)(state + 48), Aki);
+    _mm256_storeu_si256((__m256i *)(state + 52), Ako);
+    _mm256_storeu_si256((__m256i *)(state + 56), Aku);
+    _mm256_storeu_si256((__m256i *)(state + 60), Ama);
+    _mm256_storeu_si256((__m256i *)(state + 64), Ame);
+    _mm256_storeu_si256((__m256i *)(state + 68), Ami);
+    _mm256_storeu_si256((__m256i *)(state + 72), Amo);
+    _mm256_storeu_si256((__m256i *)(state + 76), Amu);
+    _mm256_storeu_si256((__m256i *)(state + 80), Asa);
+    _mm256_storeu_si256((__m256i *)(state + 84), Ase);
+    _mm256_storeu_si256((__m256i *)(state + 88), Asi);
+    _mm256_storeu_si256((__m256i *)(state + 92), Aso);
+    _mm256_storeu_si256((__m256i *)(state + 96), Asu);
+}
+
+#endif
+
+void keccakf1600_x4(uint64_t *state)
+{
+    uint64_t s[25];
+    uint32_t i, j;
+
+#if defined(VGP_X86_INTRINSICS)
+    if (cpu_features() & CPU_FEATURE_AVX2)
+    {
+        keccakf1600_x4_avx2(state);
+        return;
+    }
+#endif
+
+    for (j = 0; j < 4; ++j)
+    {
+        for (i = 0; i < 25; ++i)
+        {
+            s[i] = state[4 * i + j];
+        }
+        keccakf1600(s);
+        for (i = 0; i < 25; ++i)
+        {
+            state[4 * i + j] = s[i];
+        }
+    }
+    crypto_memzero(s, sizeof(s));
+}
@@ -23,9 +23,17 @@ typedef long long ssize_t;
 # include <sys/syscall.h>
 # if !defined(SYS_getrandom)
 #  include <stdio.h>
+# else
+#  include <elf.h>
+#  include <link.h>
+#  include <pthread.h>
+#  include <string.h>
+#  include <sys/auxv.h>
+#  include <sys/mman.h>
 # endif /* SYS_getrandom */
 #endif
 #include "os_rand.h"
+#include "utils.h"
 
 #define MAX_BUFFER_SIZE     1048576
 
@@ -46,6 +54,371 @@ void os_randominit(const uint8_t* seed, size_t seed_size)
     (void) seed_size; /* avoid warning about unused parameter */
 }
 
+#if defined(__linux__) && defined(SYS_getrandom)
+
+/*
+ * On Linux the bytes come from the vgetrandom() function the kernel
+ * exports in the vDSO since 6.11, which generates them in user space
+ * from a per-thread opaque state. The state is allocated in memory
+ * mapped with the protection and flags the kernel asks for, which
+ * among other things wipes it in the child of a fork(). Kernels
+ * without it are served from a per-thread pool refilled by the
+ * getrandom system call, requests at least as large as the pool going
+ * to the system call directly. The pool is discarded in the child of
+ * a fork(), detected as in thread_rand.c.
+ */
+
+#define OS_RAND_POOL_SIZE           256
+#define VGETRANDOM_MAX_FREE_STATES  64
+
+typedef ssize_t (*vgetrandom_fn)(void *buf,
+                                 size_t len,
+                                 unsigned int flags,
+                                 void *opaque_state,
+                                 size_t opaque_len);
+
+/* struct vgetrandom_opaque_params of the kernel */
+typedef struct
+{
+    uint32_t size_of_opaque_state;
+    uint32_t mmap_prot;
+    uint32_t mmap_flags;
+    uint32_t reserved[13];
+} vgetrandom_params;
+
+typedef struct
+{
+    void *vgetrandom_state;
+    uint8_t pool[OS_RAND_POOL_SIZE];
+    size_t pool_pos;
+    uint32_t fork_generation;
+    uint32_t registered;
+} os_rand_thread_ctx;
+
+static __thread os_rand_thread_ctx _os_rand_thread;
+
+static pthread_once_t _os_rand_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _os_rand_key;
+static int _os_rand_key_created = 0;
+static volatile uint32_t _fork_generation = 0;
+
+static vgetrandom_fn _vgetrandom = NULL;
+static volatile bool _vgetrandom_disabled = false;
+static vgetrandom_params _vgetrandom_params;
+static pthread_mutex_t _vgetrandom_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t *_vgetrandom_page = NULL;
+static size_t _vgetrandom_page_left = 0;
+static void *_vgetrandom_free[VGETRANDOM_MAX_FREE_STATES];
+static size_t _vgetrandom_free_count = 0;
+
+/**
+ * @brief Looks up a function exported by the vDSO.
+ *
+ * @param name the name of the symbol
+ * @return the address of the function, 0 when not found
+ */
+static uintptr_t vdso_lookup(const char *name)
+{
+    const ElfW(Ehdr) *ehdr;
+    const ElfW(Phdr) *phdr;
+    const ElfW(Dyn) *dyn = NULL;
+    const ElfW(Sym) *symtab = NULL;
+    const char *strtab = NULL;
+    const ElfW(Word) *hash = NULL;
+    uintptr_t base = 0;
+    int base_found = 0;
+    size_t i;
+
+    ehdr = (const ElfW(Ehdr) *)getauxval(AT_SYSINFO_EHDR);
+    if (ehdr == NULL)
+    {
+        return 0;
+    }
+    phdr = (const ElfW(Phdr) *)((const uint8_t *)ehdr + ehdr->e_phoff);
+    for (i = 0; i < ehdr->e_phnum; ++i)
+    {
+        if (phdr[i].p_type == PT_LOAD && !base_found)
+        {
+            base = (uintptr_t)ehdr + phdr[i].p_offset - phdr[i].p_vaddr;
+            base_found = 1;
+        }
+        else if (phdr[i].p_type == PT_DYNAMIC)
+        {
+            dyn = (const ElfW(Dyn) *)((const uint8_t *)ehdr + phdr[i].p_offset);
+        }
+    }
+    if (!base_found || dyn == NULL)
+    {
+        return 0;
+    }
+    for (; dyn->d_tag != DT_NULL; ++dyn)
+    {
+        switch (dyn->d_tag)
+        {
+            case DT_STRTAB:
+                strtab = (const char *)(base + dyn->d_un.d_ptr);
+                break;
+            case DT_SYMTAB:
+                symtab = (const ElfW(Sym) *)(base + dyn->d_un.d_ptr);
+                break;
+            case DT_HASH:
+                hash = (const ElfW(Word) *)(base + dyn->d_un.d_ptr);
+                break;
+            default:
+                break;
+        }
+    }
+    if (strtab == NULL || symtab == NULL || hash == NULL)
+    {
+        return 0;
+    }
+    /* The second word of the hash table is the number of symbols */
+    for (i = 0; i < hash[1]; ++i)
+    {
+        if (ELF64_ST_TYPE(symtab[i].st_info) != STT_FUNC ||
+            symtab[i].st_shndx == SHN_UNDEF)
+        {
+            continue;
+        }
+        if (strcmp(strtab + symtab[i].st_name, name) == 0)
+        {
+            return base + symtab[i].st_value;
+        }
+    }
+    return 0;
+}
+
+static void os_rand_atfork_prepare(void)
+{
+    pthread_mutex_lock(&_vgetrandom_lock);
+}
+
+static void os_rand_atfork_parent(void)
+{
+    pthread_mutex_unlock(&_vgetrandom_lock);
+}
+
+static void os_rand_atfork_child(void)
+{
+    _fork_generation++;
+    pthread_mutex_unlock(&_vgetrandom_lock);
+}
+
+/* Thread exit: wipes the pool and recycles the vgetrandom() state */
+static void os_rand_thread_exit(void *ptr)
+{
+    os_rand_thread_ctx *ctx = (os_rand_thread_ctx *)ptr;
+
+    if (ctx->vgetrandom_state != NULL)
+    {
+        pthread_mutex_lock(&_vgetrandom_lock);
+        if (_vgetrandom_free_count < VGETRANDOM_MAX_FREE_STATES)
+        {
+            _vgetrandom_free[_vgetrandom_free_count++] = ctx->vgetrandom_state;
+        }
+        pthread_mutex_unlock(&_vgetrandom_lock);
+    }
+    crypto_memzero(ctx, sizeof(os_rand_thread_ctx));
+}
+
+static void os_rand_setup(void)
+{
+    uintptr_t addr;
+    vgetrandom_fn fn;
+
+    pthread_atfork(os_rand_atfork_prepare,
+                   os_rand_atfork_parent,
+                   os_rand_atfork_child);
+    _os_rand_key_created =
+        (pthread_key_create(&_os_rand_key, os_rand_thread_exit) == 0);
+
+    addr = vdso_lookup("__vdso_getrandom");
+    if (addr == 0)
+    {
+        addr = vdso_lookup("__kernel_getrandom");
+    }
+    fn = (vgetrandom_fn)addr;
+    /* Without a key the states of exited threads could not be recycled */
+    if (addr == 0 || !_os_rand_key_created)
+    {
+        return;
+    }
+    if (fn(NULL, 0, 0, &_vgetrandom_params, ~(size_t)0) != 0 ||
+        _vgetrandom_params.size_of_opaque_state == 0)
+    {
+        return;
+    }
+    _vgetrandom = fn;
+}
+
+/**
+ * @brief Allocates a vgetrandom() state, states are carved out of
+ * pages mapped as the kernel requires and never straddle a page.
+ *
+ * @return the state, NULL on failure
+ */
+static void *vgetrandom_state_alloc(void)
+{
+    void *state = NULL;
+    size_t page_size, state_size = _vgetrandom_params.size_of_opaque_state;
+
+    pthread_mutex_lock(&_vgetrandom_lock);
+    if (_vgetrandom_free_count > 0)
+    {
+        state = _vgetrandom_free[--_vgetrandom_free_count];
+    }
+    else
+    {
+        if (_vgetrandom_page_left < state_size)
+        {
+            page_size = (size_t)sysconf(_SC_PAGESIZE);
+            _vgetrandom_page = (state_size <= page_size) ?
+                mmap(NULL, page_size,
+                     (int)_vgetrandom_params.mmap_prot,
+                     (int)_vgetrandom_params.mmap_flags, -1, 0) :
+                MAP_FAILED;
+            if (_vgetrandom_page == MAP_FAILED)
+            {
+                _vgetrandom_page = NULL;
+                page_size = 0;
+            }
+            _vgetrandom_page_left = page_size;
+        }
+        if (_vgetrandom_page_left >= state_size)
+        {
+            state = _vgetrandom_page;
+            _vgetrandom_page += state_size;
+            _vgetrandom_page_left -= state_size;
+        }
+    }
+    pthread_mutex_unlock(&_vgetrandom_lock);
+    return state;
+}
+
+/* The getrandom system call, retried until buf is filled */
+static void getrandom_bytes(uint8_t* buf, size_t buf_size)
+{
+    ssize_t len;
+
+    while (buf_size > 0)
+    {
+        len = syscall(SYS_getrandom, buf,
+                      buf_size < MAX_BUFFER_SIZE ? buf_size : MAX_BUFFER_SIZE,
+                      0);
+        if (len < 1)
+        {
+            sleep(1);
+            continue;
+        }
+        buf += len;
+        buf_size -= (size_t)len;
+    }
+}
+
+/**
+ * @brief Fills buf with vgetrandom(), allocating the state of the
+ * calling thread on first use.
+ *
+ * @return true on success, false if the caller must fall back to the
+ * system call
+ */
+static bool vgetrandom_bytes(os_rand_thread_ctx *ctx,
+                             uint8_t* buf,
+                             size_t buf_size)
+{
+    ssize_t len;
+
+    if (_vgetrandom == NULL || _vgetrandom_disabled)
+    {
+        return false;
+    }
+    if (ctx->vgetrandom_state == NULL)
+    {
+        ctx->vgetrandom_state = vgetrandom_state_alloc();
+        if (ctx->vgetrandom_state == NULL)
+        {
+            return false;
+        }
+    }
+    while (buf_size > 0)
+    {
+        len = _vgetrandom(buf, buf_size, 0, ctx->vgetrandom_state,
+                          _vgetrandom_params.size_of_opaque_state);
+        if (len < 1)
+        {
+            getrandom_bytes(buf, buf_size);
+            break;
+        }
+        buf += len;
+        buf_size -= (size_t)len;
+    }
+    return true;
+}
+
+void os_randombytes(uint8_t* buf, size_t buf_size)
+{
+    os_rand_thread_ctx *ctx = &_os_rand_thread;
+    size_t n;
+
+    pthread_once(&_os_rand_once, os_rand_setup);
+    if (!ctx->registered)
+    {
+        if (_os_rand_key_created)
+        {
+            pthread_setspecific(_os_rand_key, ctx);
+        }
+        ctx->pool_pos = OS_RAND_POOL_SIZE;
+        ctx->fork_generation = _fork_generation;
+        ctx->registered = 1;
+    }
+    if (vgetrandom_bytes(ctx, buf, buf_size))
+    {
+        return;
+    }
+    if (buf_size >= OS_RAND_POOL_SIZE)
+    {
+        getrandom_bytes(buf, buf_size);
+        return;
+    }
+    if (ctx->fork_generation != _fork_generation)
+    {
+        crypto_memzero(ctx->pool, OS_RAND_POOL_SIZE);
+        ctx->pool_pos = OS_RAND_POOL_SIZE;
+        ctx->fork_generation = _fork_generation;
+    }
+    while (buf_size > 0)
+    {
+        if (ctx->pool_pos == OS_RAND_POOL_SIZE)
+        {
+            getrandom_bytes(ctx->pool, OS_RAND_POOL_SIZE);
+            ctx->pool_pos = 0;
+        }
+        n = OS_RAND_POOL_SIZE - ctx->pool_pos;
+        if (n > buf_size)
+        {
+            n = buf_size;
+        }
+        memcpy(buf, ctx->pool + ctx->pool_pos, n);
+        /* Bytes handed out never stay in the pool */
+        crypto_memzero(ctx->pool + ctx->pool_pos, n);
+        ctx->pool_pos += n;
+        buf += n;
+        buf_size -= n;
+    }
+}
+
+void os_rand_disable_vgetrandom(bool disable)
+{
+    _vgetrandom_disabled = disable;
+}
+
+#else
+
+void os_rand_disable_vgetrandom(bool disable)
+{
+    (void) disable; /* avoid warning about unused parameter */
+}
+
 void os_randombytes(uint8_t* buf, size_t buf_size)
 {
     ssize_t sz, len;
@@ -90,3 +463,5 @@ void os_randombytes(uint8_t* buf, size_t buf_size)
     fclose(fptr);
 #endif
 }
+
+#endif
@@ -4,11 +4,12 @@
 #include "rand.h"
 #include "os_rand.h"
 #include "shake256_rand.h"
+#include "thread_rand.h"
 
 void (*bdap_randominit) 
-    (const uint8_t* seed, size_t seed_size) = os_randominit;
+    (const uint8_t* seed, size_t seed_size) = thread_randominit;
 void (*bdap_randombytes)
-    (uint8_t *buf, size_t buf_size) = os_randombytes;
+    (uint8_t *buf, size_t buf_size) = thread_randombytes;
 
 void use_shake256_rand()
 {
@@ -20,4 +21,49 @@ void use_os_rand()
 {
     bdap_randominit = os_randominit;
     bdap_randombytes = os_randombytes;
-}
\ No newline at end of file
+}
+
+void use_thread_rand()
+{
+    bdap_randominit = thread_randominit;
+    bdap_randombytes = thread_randombytes;
+}
+
+static void bdap_rng_os_randombytes(void *state, uint8_t *buf, size_t buf_size)
+{
+    (void) state; /* avoid warning about unused parameter */
+    os_randombytes(buf, buf_size);
+}
+
+static void bdap_rng_shake256_randombytes(void *state,
+                                          uint8_t *buf,
+                                          size_t buf_size)
+{
+    shake256_rand_generate((shake256_rand_ctx *)state, buf, buf_size);
+}
+
+void bdap_rng_randombytes(const bdap_rng *rng, uint8_t *buf, size_t buf_size)
+{
+    if (rng == NULL)
+    {
+        bdap_randombytes(buf, buf_size);
+        return;
+    }
+    rng->randombytes(rng->state, buf, buf_size);
+}
+
+void bdap_rng_os(bdap_rng *rng)
+{
+    rng->randombytes = bdap_rng_os_randombytes;
+    rng->state = NULL;
+}
+
+void bdap_rng_shake256(bdap_rng *rng,
+                       shake256_rand_ctx *ctx,
+                       const uint8_t *seed,
+                       size_t seed_size)
+{
+    shake256_rand_init(ctx, seed, seed_size);
+    rng->randombytes = bdap_rng_shake256_randombytes;
+    rng->state = ctx;
+}
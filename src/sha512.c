@@ -6,9 +6,21 @@
  * 
  * @brief SUPERCOP implementation of SHA-512
  *
+ * The compression function works on the state words directly, a
+ * streaming context only converting them to bytes for the digest. The
+ * times-4 function hashes four equal-length inputs with the state
+ * words and the message schedules of the four lanes held in the
+ * 64-bit elements of AVX2 registers.
  */
 
+#include <string.h>
+#include "cpu_features.h"
 #include "sha512.h"
+#include "utils.h"
+
+#if defined(VGP_X86_INTRINSICS)
+#include <immintrin.h>
+#endif
 
 #define SHR(x,c)    ((x) >> (c))
 #define ROTR(x,c)   (((x) >> (c)) | ((x) << (64 - (c))))
@@ -75,11 +87,11 @@ static void big_endian_store(uint8_t* out, uint64_t in)
     out[0] = in & 0xFF;
 }
 
-static size_t sha512_block(uint8_t *statebytes,
-                           const uint8_t *in,
-                           size_t in_len)
+/* Compresses nblocks blocks of 128 bytes into the state */
+static void sha512_blocks(uint64_t *state,
+                          const uint8_t *in,
+                          size_t nblocks)
 {
-    uint64_t state[8];
     uint64_t a, b, c, d;
     uint64_t e, f, g, h;
     uint64_t w0, w1, w2, w3, w4;
@@ -87,24 +99,16 @@ static size_t sha512_block(uint8_t *statebytes,
     uint64_t w10, w11, w12, w13;
     uint64_t w14, w15, T1, T2;
 
-    a = big_endian_load(statebytes + 0);
-    state[0] = a;
-    b = big_endian_load(statebytes + 8);
-    state[1] = b;
-    c = big_endian_load(statebytes + 16);
-    state[2] = c;
-    d = big_endian_load(statebytes + 24);
-    state[3] = d;
-    e = big_endian_load(statebytes + 32);
-    state[4] = e;
-    f = big_endian_load(statebytes + 40);
-    state[5] = f;
-    g = big_endian_load(statebytes + 48);
-    state[6] = g;
-    h = big_endian_load(statebytes + 56);
-    state[7] = h;
-
-    while (in_len >= 128)
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    for (; nblocks > 0; --nblocks)
     {
         w0  = big_endian_load(in + 0);
         w1  = big_endian_load(in + 8);
@@ -235,87 +239,292 @@ static size_t sha512_block(uint8_t *statebytes,
         state[7] = h;
 
         in += 128;
-        in_len -= 128;
     }
+}
+
+static const uint64_t IV[8] = \
+{   0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+/**
+ * Pads the last tail_len (< 128) bytes of a message of bytes bytes
+ * into padded and returns the number of blocks, 1 or 2
+ */
+static size_t sha512_pad(uint8_t *padded,
+                         const uint8_t *tail,
+                         size_t tail_len,
+                         uint64_t bytes)
+{
+    size_t nblocks = (tail_len < 112) ? 1 : 2;
+    uint8_t *length = padded + 128 * nblocks - 16;
+
+    memcpy(padded, tail, tail_len);
+    padded[tail_len] = 0x80;
+    memset(padded + tail_len + 1, 0, 128 * nblocks - tail_len - 1);
+    length[7] = (bytes >> 61) & 0xFF;
+    big_endian_store(length + 8, bytes << 3);
+
+    return nblocks;
+}
+
+void sha512_init(sha512_ctx *ctx)
+{
+    memcpy(ctx->state, IV, sizeof(IV));
+    ctx->bytes = 0;
+    ctx->buf_len = 0;
+}
+
+void sha512_update(sha512_ctx *ctx, const uint8_t *in, size_t in_len)
+{
+    size_t n;
+
+    ctx->bytes += in_len;
+    if (ctx->buf_len > 0)
+    {
+        n = SHA512_BLOCK_SIZE - ctx->buf_len;
+        if (n > in_len)
+        {
+            n = in_len;
+        }
+        memcpy(ctx->buf + ctx->buf_len, in, n);
+        ctx->buf_len += n;
+        in += n;
+        in_len -= n;
+        if (ctx->buf_len < SHA512_BLOCK_SIZE)
+        {
+            return;
+        }
+        sha512_blocks(ctx->state, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+    sha512_blocks(ctx->state, in, in_len / SHA512_BLOCK_SIZE);
+    in += in_len & ~(size_t)(SHA512_BLOCK_SIZE - 1);
+    in_len &= SHA512_BLOCK_SIZE - 1;
+    memcpy(ctx->buf, in, in_len);
+    ctx->buf_len = in_len;
+}
 
-    big_endian_store(statebytes +  0, state[0]);
-    big_endian_store(statebytes +  8, state[1]);
-    big_endian_store(statebytes + 16, state[2]);
-    big_endian_store(statebytes + 24, state[3]);
-    big_endian_store(statebytes + 32, state[4]);
-    big_endian_store(statebytes + 40, state[5]);
-    big_endian_store(statebytes + 48, state[6]);
-    big_endian_store(statebytes + 56, state[7]);
+void sha512_final(sha512_ctx *ctx, uint8_t *out)
+{
+    uint8_t padded[2 * SHA512_BLOCK_SIZE];
+    size_t nblocks;
+    int32_t i;
 
-    return in_len;
+    nblocks = sha512_pad(padded, ctx->buf, ctx->buf_len, ctx->bytes);
+    sha512_blocks(ctx->state, padded, nblocks);
+    for (i = 0; i < 8; ++i)
+    {
+        big_endian_store(out + 8 * i, ctx->state[i]);
+    }
+    crypto_memzero(padded, sizeof(padded));
+    crypto_memzero(ctx, sizeof(sha512_ctx));
 }
 
 void sha512(uint8_t* out,
             const uint8_t* in,
             size_t in_len)
 {
-    int32_t i;
-    uint64_t bytes = (uint64_t)in_len;
-    uint8_t padded[256];
-    uint8_t h[64] = {
-        0x6a, 0x09, 0xe6, 0x67, 0xf3, 0xbc, 0xc9, 0x08,
-        0xbb, 0x67, 0xae, 0x85, 0x84, 0xca, 0xa7, 0x3b,
-        0x3c, 0x6e, 0xf3, 0x72, 0xfe, 0x94, 0xf8, 0x2b,
-        0xa5, 0x4f, 0xf5, 0x3a, 0x5f, 0x1d, 0x36, 0xf1,
-        0x51, 0x0e, 0x52, 0x7f, 0xad, 0xe6, 0x82, 0xd1,
-        0x9b, 0x05, 0x68, 0x8c, 0x2b, 0x3e, 0x6c, 0x1f,
-        0x1f, 0x83, 0xd9, 0xab, 0xfb, 0x41, 0xbd, 0x6b,
-        0x5b, 0xe0, 0xcd, 0x19, 0x13, 0x7e, 0x21, 0x79
-    };
-
-    sha512_block(h, in, in_len);
-    in += in_len;
-    in_len &= 0x7f;
-    in -= in_len;
-
-    for (i = 0; i < (int32_t)in_len; ++i)
+    sha512_ctx ctx;
+
+    sha512_init(&ctx);
+    sha512_update(&ctx, in, in_len);
+    sha512_final(&ctx, out);
+}
+
+/**
+ * Compresses nblocks blocks of each of the four inputs into the
+ * interleaved states, word i of the state of lane j being
+ * state[4 * i + j]
+ */
+static void sha512_x4_blocks_scalar(uint64_t *state,
+                                    const uint8_t *const *in,
+                                    size_t offset,
+                                    size_t nblocks)
+{
+    uint64_t lane[8];
+    int32_t i, j;
+
+    for (j = 0; j < 4; ++j)
     {
-        padded[i] = in[i];
+        for (i = 0; i < 8; ++i)
+        {
+            lane[i] = state[4 * i + j];
+        }
+        sha512_blocks(lane, in[j] + offset, nblocks);
+        for (i = 0; i < 8; ++i)
+        {
+            state[4 * i + j] = lane[i];
+        }
     }
-    padded[in_len] = 0x80;
+    crypto_memzero(lane, sizeof(lane));
+}
+
+#if defined(VGP_X86_INTRINSICS)
+
+static const uint64_t K[80] = \
+{   0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+#define ROTR_X4(x, c)   _mm256_or_si256(_mm256_srli_epi64(x, c), \
+                                        _mm256_slli_epi64(x, 64 - (c)))
+#define XOR3_X4(x, y, z) \
+                        _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define S0_X4(x)        XOR3_X4(ROTR_X4(x, 28), ROTR_X4(x, 34), ROTR_X4(x, 39))
+#define S1_X4(x)        XOR3_X4(ROTR_X4(x, 14), ROTR_X4(x, 18), ROTR_X4(x, 41))
+#define S2_X4(x)        XOR3_X4(ROTR_X4(x,  1), ROTR_X4(x,  8), \
+                                _mm256_srli_epi64(x, 7))
+#define S3_X4(x)        XOR3_X4(ROTR_X4(x, 19), ROTR_X4(x, 61), \
+                                _mm256_srli_epi64(x, 6))
+
+VGP_TARGET("avx2")
+static void sha512_x4_blocks_avx2(uint64_t *state,
+                                  const uint8_t *const *in,
+                                  size_t offset,
+                                  size_t nblocks)
+{
+    const __m256i bswap = _mm256_setr_epi8(
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    __m256i s[8], v[8], w[16];
+    __m256i r0, r1, r2, r3, t0, t1, t2, t3, T1, T2;
+    int32_t i, t;
 
-    if (in_len < 112)
+    for (i = 0; i < 8; ++i)
+    {
+        s[i] = _mm256_loadu_si256((const __m256i *)(state + 4 * i));
+    }
+    for (; nblocks > 0; --nblocks, offset += 128)
     {
-        for (i = (int32_t)in_len + 1; i < 119; ++i)
+        /* Transposes the words of the four blocks, four at a time */
+        for (i = 0; i < 16; i += 4)
+        {
+            r0 = _mm256_loadu_si256((const __m256i *)(in[0] + offset + 8 * i));
+            r1 = _mm256_loadu_si256((const __m256i *)(in[1] + offset + 8 * i));
+            r2 = _mm256_loadu_si256((const __m256i *)(in[2] + offset + 8 * i));
+            r3 = _mm256_loadu_si256((const __m256i *)(in[3] + offset + 8 * i));
+            t0 = _mm256_unpacklo_epi64(r0, r1);
+            t1 = _mm256_unpackhi_epi64(r0, r1);
+            t2 = _mm256_unpacklo_epi64(r2, r3);
+            t3 = _mm256_unpackhi_epi64(r2, r3);
+            w[i + 0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t0, t2, 0x20), bswap);
+            w[i + 1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t1, t3, 0x20), bswap);
+            w[i + 2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t0, t2, 0x31), bswap);
+            w[i + 3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t1, t3, 0x31), bswap);
+        }
+        for (i = 0; i < 8; ++i)
+        {
+            v[i] = s[i];
+        }
+        for (t = 0; t < 80; ++t)
+        {
+            if (t >= 16)
+            {
+                w[t & 15] = _mm256_add_epi64(
+                    _mm256_add_epi64(w[t & 15], S3_X4(w[(t - 2) & 15])),
+                    _mm256_add_epi64(w[(t - 7) & 15], S2_X4(w[(t - 15) & 15])));
+            }
+            /* Ch(e,f,g) and Maj(a,b,c) = (a & b) ^ (c & (a ^ b)) */
+            T1 = _mm256_xor_si256(_mm256_and_si256(v[4], v[5]),
+                                  _mm256_andnot_si256(v[4], v[6]));
+            T1 = _mm256_add_epi64(_mm256_add_epi64(v[7], S1_X4(v[4])),
+                                  _mm256_add_epi64(T1, w[t & 15]));
+            T1 = _mm256_add_epi64(T1, _mm256_set1_epi64x((long long)K[t]));
+            T2 = _mm256_xor_si256(_mm256_and_si256(v[0], v[1]),
+                                  _mm256_and_si256(v[2], _mm256_xor_si256(v[0], v[1])));
+            T2 = _mm256_add_epi64(S0_X4(v[0]), T2);
+            v[7] = v[6];
+            v[6] = v[5];
+            v[5] = v[4];
+            v[4] = _mm256_add_epi64(v[3], T1);
+            v[3] = v[2];
+            v[2] = v[1];
+            v[1] = v[0];
+            v[0] = _mm256_add_epi64(T1, T2);
+        }
+        for (i = 0; i < 8; ++i)
         {
-            padded[i] = 0;
+            s[i] = _mm256_add_epi64(s[i], v[i]);
         }
-        padded[119] = (bytes >> 61) & 0xFF;
-        padded[120] = (bytes >> 53) & 0xFF;
-        padded[121] = (bytes >> 45) & 0xFF;
-        padded[122] = (bytes >> 37) & 0xFF;
-        padded[123] = (bytes >> 29) & 0xFF;
-        padded[124] = (bytes >> 21) & 0xFF;
-        padded[125] = (bytes >> 13) & 0xFF;
-        padded[126] = (bytes >>  5) & 0xFF;
-        padded[127] = (bytes <<  3) & 0xFF;
-        sha512_block(h, padded, 128);
     }
-    else
+    for (i = 0; i < 8; ++i)
     {
-        for (i = (int32_t)in_len + 1; i < 247; ++i)
+        _mm256_storeu_si256((__m256i *)(state + 4 * i), s[i]);
+    }
+    crypto_memzero(w, sizeof(w));
+    crypto_memzero(v, sizeof(v));
+}
+
+#endif
+
+static void sha512_x4_blocks(uint64_t *state,
+                             const uint8_t *const *in,
+                             size_t offset,
+                             size_t nblocks)
+{
+#if defined(VGP_X86_INTRINSICS)
+    if (cpu_features() & CPU_FEATURE_AVX2)
+    {
+        sha512_x4_blocks_avx2(state, in, offset, nblocks);
+        return;
+    }
+#endif
+    sha512_x4_blocks_scalar(state, in, offset, nblocks);
+}
+
+void sha512_x4(uint8_t *const *out,
+               const uint8_t *const *in,
+               size_t in_len)
+{
+    uint64_t state[4 * 8];
+    uint8_t padded[4][2 * SHA512_BLOCK_SIZE];
+    const uint8_t *tails[4];
+    size_t nblocks = 0, tail_len = in_len & (SHA512_BLOCK_SIZE - 1);
+    int32_t i, j;
+
+    for (i = 0; i < 8; ++i)
+    {
+        for (j = 0; j < 4; ++j)
         {
-            padded[i] = 0;
+            state[4 * i + j] = IV[i];
         }
-        padded[247] = (bytes >> 61) & 0xFF;
-        padded[248] = (bytes >> 53) & 0xFF;
-        padded[249] = (bytes >> 45) & 0xFF;
-        padded[250] = (bytes >> 37) & 0xFF;
-        padded[251] = (bytes >> 29) & 0xFF;
-        padded[252] = (bytes >> 21) & 0xFF;
-        padded[253] = (bytes >> 13) & 0xFF;
-        padded[254] = (bytes >>  5) & 0xFF;
-        padded[255] = (bytes <<  3) & 0xFF;
-        sha512_block(h, padded, 256);
     }
-
-    for (i = 0; i < 64; ++i)
+    sha512_x4_blocks(state, in, 0, in_len / SHA512_BLOCK_SIZE);
+    for (j = 0; j < 4; ++j)
     {
-        out[i] = h[i];
+        nblocks = sha512_pad(padded[j], in[j] + in_len - tail_len,
+                             tail_len, (uint64_t)in_len);
+        tails[j] = padded[j];
+    }
+    sha512_x4_blocks(state, tails, 0, nblocks);
+    for (j = 0; j < 4; ++j)
+    {
+        for (i = 0; i < 8; ++i)
+        {
+            big_endian_store(out[j] + 8 * i, state[4 * i + j]);
+        }
     }
+    crypto_memzero(padded, sizeof(padded));
+    crypto_memzero(state, sizeof(state));
 }
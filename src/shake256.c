@@ -1,149 +1,164 @@
 // Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
 // See LICENSE.md file for license, copying and use information.
 
-/** libkeccak-tiny
+/**
+ * @file shake256.c
  *
- * A single-file implementation of SHA-3 and SHAKE.
+ * @brief FIPS-202 SHAKE-256 on top of the Keccak-f[1600] permutation.
  *
- * Implementor: David Leon Gil
- * License: CC0, attribution kindly requested. Blame taken too,
- * but not liability.
- * 
- * Reference: https://github.com/coruus/keccak-tiny
+ * The input is xored into the state and the output read from it a
+ * lane at a time, only the bytes before the first lane boundary and
+ * after the last one are handled individually. The times-4 functions
+ * run four sponges over the interleaved states of keccakf1600_x4().
  */
 
 #include <stdint.h>
 #include <string.h>
+#include "keccakf1600.h"
 #include "shake256.h"
+#include "utils.h"
 
-/******** The Keccak-f[1600] permutation ********/
-
-/*** Constants. ***/
-static const uint8_t rho[24] = \
-{    1,  3,   6, 10, 15, 21,
-    28, 36, 45, 55,  2, 14,
-    27, 41, 56,  8, 25, 43,
-    62, 18, 39, 61, 20, 44
-};
-static const uint8_t pi[24] = \
-{   10,  7, 11, 17, 18, 3,
-     5, 16,  8, 21, 24, 4,
-    15, 23, 19, 13, 12, 2,
-    20, 14, 22,  9, 6,  1
-};
-static const uint64_t RC[24] = \
-{   1ULL, 0x8082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
-    0x808bULL, 0x80000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
-    0x8aULL, 0x88ULL, 0x80008009ULL, 0x8000000aULL,
-    0x8000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
-    0x8000000000008002ULL, 0x8000000000000080ULL, 0x800aULL, 0x800000008000000aULL,
-    0x8000000080008081ULL, 0x8000000000008080ULL, 0x80000001ULL, 0x8000000080008008ULL
-};
-
-/*** Helper macros to unroll the permutation. ***/
-#define rol(x, s) (((x) << s) | ((x) >> (64 - s)))
-#define REPEAT6(e) e e e e e e
-#define REPEAT24(e) REPEAT6(e e e e)
-#define REPEAT5(e) e e e e e
-#define FOR5(v, s, e) \
-    v = 0;            \
-    REPEAT5(e; v += s;)
-
-/*** Keccak-f[1600] ***/
-static inline void keccakf(void* state)
+static uint64_t little_endian_load64(const uint8_t *x)
 {
-    uint64_t* a = (uint64_t*)state;
-    uint64_t b[5] = {0};
-    uint64_t t = 0;
-    uint8_t x, y, i = 0;
-
-    REPEAT24(
-        /* Theta */
-        FOR5(x, 1,
-             b[x] = 0;
-             FOR5(y, 5,
-                  b[x] ^= a[x + y]; ))
-        FOR5(x, 1,
-             FOR5(y, 5,
-                  a[y + x] ^= b[(x + 4) % 5] ^ rol(b[(x + 1) % 5], 1); ))
-        /* Rho and pi */
-        t = a[1];
-        x = 0;
-        REPEAT24(b[0] = a[pi[x]];
-                 a[pi[x]] = rol(t, rho[x]);
-                 t = b[0];
-                 x++;)
-        /* Chi */
-        FOR5(y,
-             5,
-             FOR5(x, 1,
-                  b[x] = a[y + x];)
-             FOR5(x, 1,
-                  a[y + x] = b[x] ^ ((~b[(x + 1) % 5]) & b[(x + 2) % 5]); ))
-        /* Iota */
-        a[0] ^= RC[i];
-        i++; )
+    return ((uint64_t)x[0])
+        | ((uint64_t)x[1] <<  8)
+        | ((uint64_t)x[2] << 16)
+        | ((uint64_t)x[3] << 24)
+        | ((uint64_t)x[4] << 32)
+        | ((uint64_t)x[5] << 40)
+        | ((uint64_t)x[6] << 48)
+        | ((uint64_t)x[7] << 56);
 }
 
-/******** The FIPS202-defined functions. ********/
-
-/*** Some helper macros. ***/
-
-#define _(S) do { S } while (0)
-#define FOR(i, ST, L, S) \
-    _(for (size_t i = 0; i < L; i += ST) { S; }) 
-#define mkapply_ds(NAME, S)                          \
-    static inline void NAME(uint8_t* dst,            \
-                            const uint8_t* src,      \
-                            size_t len) {            \
-    FOR(i, 1, len, S);                               \
-  }
-#define mkapply_sd(NAME, S)                          \
-    static inline void NAME(const uint8_t* src,      \
-                            uint8_t* dst,            \
-                            size_t len) {            \
-    FOR(i, 1, len, S);                               \
-  }
-
-mkapply_ds(xorin, dst[i] ^= src[i])  /* xorin */
-mkapply_sd(setout, dst[i] = src[i])  /* setout */
-
-#define P keccakf
-#define Plen 200
-
-/* Fold P*F over the full blocks of an input. */
-#define foldP(I, L, F)    \
-    while (L >= rate) {   \
-        F(a, I, rate);    \
-        P(a);             \
-        I += rate;        \
-        L -= rate;        \
-    }
-
-/** The sponge-based hash construction. **/
-static inline int32_t hash(uint8_t* out, size_t outlen,
-                           const uint8_t* in, size_t inlen,
-                           size_t rate, uint8_t delim)
+static void little_endian_store64(uint8_t *x, uint64_t u)
 {
-    uint8_t a[Plen] = {0};
-    if ((out == NULL) || ((in == NULL) && inlen != 0) || (rate >= Plen))
+    x[0] = u & 0xFF; u >>= 8;
+    x[1] = u & 0xFF; u >>= 8;
+    x[2] = u & 0xFF; u >>= 8;
+    x[3] = u & 0xFF; u >>= 8;
+    x[4] = u & 0xFF; u >>= 8;
+    x[5] = u & 0xFF; u >>= 8;
+    x[6] = u & 0xFF; u >>= 8;
+    x[7] = u & 0xFF;
+}
+
+/**
+ * Xors len bytes of src into the state a from the byte offset pos,
+ * lane i of the state being a[i * stride]
+ */
+static void xorin(uint64_t *a,
+                  size_t stride,
+                  size_t pos,
+                  const uint8_t *src,
+                  size_t len)
+{
+    for (; len > 0 && (pos & 7) != 0; --len, ++pos)
     {
-        return -1;
+        a[(pos >> 3) * stride] ^= (uint64_t)*src++ << (8 * (pos & 7));
+    }
+    for (; len >= 8; len -= 8, pos += 8, src += 8)
+    {
+        a[(pos >> 3) * stride] ^= little_endian_load64(src);
+    }
+    for (; len > 0; --len, ++pos)
+    {
+        a[(pos >> 3) * stride] ^= (uint64_t)*src++ << (8 * (pos & 7));
+    }
+}
+
+/**
+ * Reads len bytes of the state a from the byte offset pos into dst,
+ * lane i of the state being a[i * stride]
+ */
+static void setout(const uint64_t *a,
+                   size_t stride,
+                   size_t pos,
+                   uint8_t *dst,
+                   size_t len)
+{
+    for (; len > 0 && (pos & 7) != 0; --len, ++pos)
+    {
+        *dst++ = (uint8_t)(a[(pos >> 3) * stride] >> (8 * (pos & 7)));
+    }
+    for (; len >= 8; len -= 8, pos += 8, dst += 8)
+    {
+        little_endian_store64(dst, a[(pos >> 3) * stride]);
+    }
+    for (; len > 0; --len, ++pos)
+    {
+        *dst++ = (uint8_t)(a[(pos >> 3) * stride] >> (8 * (pos & 7)));
+    }
+}
+
+/* Xors in the domain separation bits and the padding at offset pos */
+static void pad(uint64_t *a, size_t stride, size_t pos)
+{
+    a[(pos >> 3) * stride] ^= (uint64_t)0x1f << (8 * (pos & 7));
+    a[((SHAKE256_RATE - 1) >> 3) * stride] ^= (uint64_t)0x80 << 56;
+}
+
+void shake256_init(shake256_ctx *ctx)
+{
+    memset(ctx, 0, sizeof(shake256_ctx));
+}
+
+void shake256_absorb(shake256_ctx *ctx, const uint8_t *in, size_t in_len)
+{
+    size_t n;
+
+    while (in_len > 0)
+    {
+        n = SHAKE256_RATE - ctx->pos;
+        if (n > in_len)
+        {
+            n = in_len;
+        }
+        xorin(ctx->a, 1, ctx->pos, in, n);
+        ctx->pos += n;
+        in += n;
+        in_len -= n;
+        if (ctx->pos == SHAKE256_RATE)
+        {
+            keccakf1600(ctx->a);
+            ctx->pos = 0;
+        }
+    }
+}
+
+void shake256_finalize(shake256_ctx *ctx)
+{
+    if (ctx->finalized)
+    {
+        return;
+    }
+    pad(ctx->a, 1, ctx->pos);
+    keccakf1600(ctx->a);
+    ctx->pos = 0;
+    ctx->finalized = 1;
+}
+
+void shake256_squeeze(shake256_ctx *ctx, uint8_t *out, size_t out_len)
+{
+    size_t n;
+
+    shake256_finalize(ctx);
+    while (out_len > 0)
+    {
+        if (ctx->pos == SHAKE256_RATE)
+        {
+            keccakf1600(ctx->a);
+            ctx->pos = 0;
+        }
+        n = SHAKE256_RATE - ctx->pos;
+        if (n > out_len)
+        {
+            n = out_len;
+        }
+        setout(ctx->a, 1, ctx->pos, out, n);
+        ctx->pos += n;
+        out += n;
+        out_len -= n;
     }
-    /* Absorb input. */
-    foldP(in, inlen, xorin);
-    /* Xor in the DS and pad frame. */
-    a[inlen] ^= delim;
-    a[rate - 1] ^= 0x80;
-    /* Xor in the last block. */
-    xorin(a, in, inlen);
-    /* Apply P */
-    P(a);
-    /* Squeeze output. */
-    foldP(out, outlen, setout);
-    setout(a, out, outlen);
-    memset(a, 0, 200);
-    return 0;
 }
 
 int32_t shake256(uint8_t* out,
@@ -151,5 +166,122 @@ int32_t shake256(uint8_t* out,
                  const uint8_t *in,
                  size_t in_len)
 {
-    return hash(out, out_len, in, in_len, 136, 0x1f);
+    shake256_ctx ctx;
+
+    if ((out == NULL) || ((in == NULL) && in_len != 0))
+    {
+        return -1;
+    }
+    shake256_init(&ctx);
+    shake256_absorb(&ctx, in, in_len);
+    shake256_squeeze(&ctx, out, out_len);
+    crypto_memzero(&ctx, sizeof(ctx));
+    return 0;
+}
+
+void shake256_x4_init(shake256_x4_ctx *ctx)
+{
+    memset(ctx, 0, sizeof(shake256_x4_ctx));
+}
+
+void shake256_x4_absorb(shake256_x4_ctx *ctx,
+                        const uint8_t *const *in,
+                        size_t in_len)
+{
+    size_t n, offset = 0;
+    uint32_t j;
+
+    while (in_len > 0)
+    {
+        n = SHAKE256_RATE - ctx->pos;
+        if (n > in_len)
+        {
+            n = in_len;
+        }
+        for (j = 0; j < 4; ++j)
+        {
+            xorin(ctx->a + j, 4, ctx->pos, in[j] + offset, n);
+        }
+        ctx->pos += n;
+        offset += n;
+        in_len -= n;
+        if (ctx->pos == SHAKE256_RATE)
+        {
+            keccakf1600_x4(ctx->a);
+            ctx->pos = 0;
+        }
+    }
+}
+
+void shake256_x4_finalize(shake256_x4_ctx *ctx)
+{
+    uint32_t j;
+
+    if (ctx->finalized)
+    {
+        return;
+    }
+    for (j = 0; j < 4; ++j)
+    {
+        pad(ctx->a + j, 4, ctx->pos);
+    }
+    keccakf1600_x4(ctx->a);
+    ctx->pos = 0;
+    ctx->finalized = 1;
+}
+
+void shake256_x4_squeeze(shake256_x4_ctx *ctx,
+                         uint8_t *const *out,
+                         size_t out_len)
+{
+    size_t n, offset = 0;
+    uint32_t j;
+
+    shake256_x4_finalize(ctx);
+    while (out_len > 0)
+    {
+        if (ctx->pos == SHAKE256_RATE)
+        {
+            keccakf1600_x4(ctx->a);
+            ctx->pos = 0;
+        }
+        n = SHAKE256_RATE - ctx->pos;
+        if (n > out_len)
+        {
+            n = out_len;
+        }
+        for (j = 0; j < 4; ++j)
+        {
+            setout(ctx->a + j, 4, ctx->pos, out[j] + offset, n);
+        }
+        ctx->pos += n;
+        offset += n;
+        out_len -= n;
+    }
+}
+
+int32_t shake256_x4(uint8_t *const *out,
+                    size_t out_len,
+                    const uint8_t *const *in,
+                    size_t in_len)
+{
+    shake256_x4_ctx ctx;
+    uint32_t j;
+
+    if (out == NULL || in == NULL)
+    {
+        return -1;
+    }
+    for (j = 0; j < 4; ++j)
+    {
+        if ((out[j] == NULL) || ((in[j] == NULL) && in_len != 0))
+        {
+            return -1;
+        }
+    }
+    shake256_x4_init(&ctx);
+    shake256_x4_absorb(&ctx, in, in_len);
+    shake256_x4_squeeze(&ctx, out, out_len);
+    crypto_memzero(&ctx, sizeof(ctx));
+    return 0;
 }
@@ -1,60 +1,79 @@
 // Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
 // See LICENSE.md file for license, copying and use information.
 
-#include <stdlib.h>
+/**
+ * @file shake256_rand.c
+ *
+ * @brief SHAKE256 sponge-based deterministic random bit generator.
+ *
+ * The seed is absorbed once and the output is squeezed from the
+ * sponge state, which is kept across calls. Every
+ * SHAKE256_RAND_RATCHET_INTERVAL bytes of output the generator
+ * ratchets: a key is squeezed and the sponge is re-initialised from
+ * that key alone. As the permutation is invertible, this is what
+ * prevents a compromised state from revealing the output produced
+ * before the last ratchet.
+ */
+
 #include <string.h>
-#if !defined(_MSC_VER)
-# include <unistd.h>
-#endif
 #include "shake256.h"
 #include "shake256_rand.h"
 #include "utils.h"
 
-#define INTERNAL_BUFFER_SIZE        4096
+static shake256_rand_ctx _shake256_rand;
 
-#if defined(_MSC_VER)
-typedef long long ssize_t;
-#endif
+static void shake256_rand_ratchet(shake256_rand_ctx *ctx)
+{
+    uint8_t key[SHAKE256_RAND_RATCHET_KEY_SIZE];
 
-static uint8_t _shake256_buffer[INTERNAL_BUFFER_SIZE];
-static uint8_t _buffer[INTERNAL_BUFFER_SIZE];
-static ssize_t _bytes_available = 0;
+    shake256_squeeze(&ctx->state, key, sizeof(key));
+    shake256_init(&ctx->state);
+    shake256_absorb(&ctx->state, key, sizeof(key));
+    shake256_finalize(&ctx->state);
+    crypto_memzero(key, sizeof(key));
+    ctx->bytes_since_ratchet = 0;
+}
 
-void shake256_randominit(const uint8_t* seed, size_t seed_size)
+void shake256_rand_init(shake256_rand_ctx *ctx,
+                        const uint8_t *seed,
+                        size_t seed_size)
 {
-    crypto_memzero(_shake256_buffer, sizeof(_shake256_buffer));
-    shake256(_shake256_buffer, INTERNAL_BUFFER_SIZE, seed, seed_size);
-    _bytes_available = INTERNAL_BUFFER_SIZE;
+    shake256_init(&ctx->state);
+    shake256_absorb(&ctx->state, seed, seed_size);
+    shake256_finalize(&ctx->state);
+    ctx->bytes_since_ratchet = 0;
 }
 
-void shake256_randombytes(uint8_t* buf, size_t buf_size)
+void shake256_rand_generate(shake256_rand_ctx *ctx,
+                            uint8_t *buf,
+                            size_t buf_size)
 {
-    uint8_t *ptr = buf;
-    ssize_t size;
-    ssize_t bytes_left = (ssize_t)buf_size;
-    while (bytes_left > 0)
+    size_t size;
+
+    while (buf_size > 0)
     {
-        size = bytes_left;
-        if (size > _bytes_available)
+        size = SHAKE256_RAND_RATCHET_INTERVAL - ctx->bytes_since_ratchet;
+        if (size > buf_size)
         {
-            size = _bytes_available;
+            size = buf_size;
         }
-        memcpy(ptr,
-               &_shake256_buffer[INTERNAL_BUFFER_SIZE - _bytes_available],
-               (size_t)size);
-        ptr += size;
-        bytes_left -= size;
-        _bytes_available -= size;
-        /* Refill SHAKE256 internal buffer if necessary */
-        if (_bytes_available <= 0)
+        shake256_squeeze(&ctx->state, buf, size);
+        buf += size;
+        buf_size -= size;
+        ctx->bytes_since_ratchet += size;
+        if (ctx->bytes_since_ratchet == SHAKE256_RAND_RATCHET_INTERVAL)
         {
-            memcpy(_buffer, _shake256_buffer, sizeof(_shake256_buffer));
-            shake256(_shake256_buffer,
-                     INTERNAL_BUFFER_SIZE,
-                     _buffer,
-                     INTERNAL_BUFFER_SIZE);
-            crypto_memzero(_buffer, sizeof(_buffer));
-            _bytes_available = INTERNAL_BUFFER_SIZE;   
+            shake256_rand_ratchet(ctx);
         }
     }
 }
+
+void shake256_randominit(const uint8_t* seed, size_t seed_size)
+{
+    shake256_rand_init(&_shake256_rand, seed, seed_size);
+}
+
+void shake256_randombytes(uint8_t* buf, size_t buf_size)
+{
+    shake256_rand_generate(&_shake256_rand, buf, buf_size);
+}
@@ -0,0 +1,151 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+/**
+ * @file thread_rand.c
+ *
+ * @brief Per-thread random number generators.
+ *
+ * The generator of a thread lives in thread-local storage. A fork()
+ * is detected with a child handler registered by pthread_atfork(),
+ * which advances a process-wide fork generation: a generator seeded
+ * in an older generation reseeds before producing any output, so the
+ * parent and the child never share a stream. The generator state is
+ * wiped when its thread exits.
+ */
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+#include <string.h>
+#include "os_rand.h"
+#include "shake256.h"
+#include "shake256_rand.h"
+#include "thread_rand.h"
+#include "utils.h"
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL    __declspec(thread)
+#else
+#define THREAD_LOCAL    __thread
+#endif
+
+#define THREAD_RAND_SEED_SIZE           64
+#define THREAD_RAND_RESEED_INTERVAL     (1024 * 1024)
+
+typedef struct
+{
+    shake256_rand_ctx drbg;
+    size_t bytes_since_reseed;
+    uint32_t fork_generation;
+    uint32_t seeded;
+} thread_rand_ctx;
+
+static THREAD_LOCAL thread_rand_ctx _thread_rand;
+
+#if defined(_WIN32)
+
+#define FORK_GENERATION     0
+
+#else
+
+#define FORK_GENERATION     _fork_generation
+
+static volatile uint32_t _fork_generation = 0;
+static pthread_once_t _thread_rand_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _thread_rand_key;
+static int _thread_rand_key_created = 0;
+
+static void thread_rand_atfork_child(void)
+{
+    _fork_generation++;
+}
+
+static void thread_rand_wipe(void *ptr)
+{
+    crypto_memzero(ptr, sizeof(thread_rand_ctx));
+}
+
+static void thread_rand_setup(void)
+{
+    pthread_atfork(NULL, NULL, thread_rand_atfork_child);
+    _thread_rand_key_created =
+        (pthread_key_create(&_thread_rand_key, thread_rand_wipe) == 0);
+}
+
+#endif
+
+/**
+ * @brief Seeds the generator with fresh OS entropy, the optional seed
+ * and, when it was already seeded, output of its previous state.
+ */
+static void thread_rand_reseed(thread_rand_ctx *ctx,
+                               const uint8_t *seed,
+                               size_t seed_size)
+{
+    uint8_t entropy[THREAD_RAND_SEED_SIZE];
+    uint8_t key[THREAD_RAND_SEED_SIZE];
+    shake256_ctx xof;
+
+    os_randombytes(entropy, sizeof(entropy));
+    shake256_init(&xof);
+    shake256_absorb(&xof, entropy, sizeof(entropy));
+    shake256_absorb(&xof, seed, seed_size);
+    if (ctx->seeded)
+    {
+        shake256_rand_generate(&ctx->drbg, key, sizeof(key));
+        shake256_absorb(&xof, key, sizeof(key));
+    }
+    shake256_squeeze(&xof, key, sizeof(key));
+    shake256_rand_init(&ctx->drbg, key, sizeof(key));
+
+#if !defined(_WIN32)
+    if (!ctx->seeded && _thread_rand_key_created)
+    {
+        pthread_setspecific(_thread_rand_key, ctx);
+    }
+#endif
+    ctx->bytes_since_reseed = 0;
+    ctx->fork_generation = FORK_GENERATION;
+    ctx->seeded = 1;
+
+    crypto_memzero(entropy, sizeof(entropy));
+    crypto_memzero(key, sizeof(key));
+    crypto_memzero(&xof, sizeof(xof));
+}
+
+void thread_randominit(const uint8_t* seed, size_t seed_size)
+{
+#if !defined(_WIN32)
+    pthread_once(&_thread_rand_once, thread_rand_setup);
+#endif
+    thread_rand_reseed(&_thread_rand, seed, seed_size);
+}
+
+void thread_randombytes(uint8_t *buf, size_t buf_size)
+{
+    thread_rand_ctx *ctx = &_thread_rand;
+    size_t size;
+
+#if !defined(_WIN32)
+    pthread_once(&_thread_rand_once, thread_rand_setup);
+#endif
+    while (buf_size > 0)
+    {
+        if (!ctx->seeded ||
+            ctx->fork_generation != FORK_GENERATION ||
+            ctx->bytes_since_reseed == THREAD_RAND_RESEED_INTERVAL)
+        {
+            thread_rand_reseed(ctx, NULL, 0);
+        }
+        size = THREAD_RAND_RESEED_INTERVAL - ctx->bytes_since_reseed;
+        if (size > buf_size)
+        {
+            size = buf_size;
+        }
+        shake256_rand_generate(&ctx->drbg, buf, size);
+        buf += size;
+        buf_size -= size;
+        ctx->bytes_since_reseed += size;
+    }
+}
@@ -4,7 +4,9 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <openssl/evp.h>
 #include "aes256.h"
+#include "cpu_features.h"
 #include "rand.h"
 #include "utils.h"
 
@@ -76,3 +78,64 @@ bool random_aes_test_vectors(int iterations)
 
     return status;
 }
+
+bool random_aes_multi_block_test(int iterations) 
+{
+    static const uint32_t backends[3] = {
+        0, CPU_FEATURE_AESNI, CPU_FEATURE_AESNI | CPU_FEATURE_SSSE3
+    };
+    int32_t it;
+    int openssl_len;
+    size_t num_blocks;
+    bool status = true;
+    uint8_t plaintext[11 * AES256_BLOCK_SIZE];
+    uint8_t ciphertext[11 * AES256_BLOCK_SIZE];
+    uint8_t expected[11 * AES256_BLOCK_SIZE];
+    uint8_t decrypted[11 * AES256_BLOCK_SIZE];
+    uint8_t key[AES256_KEY_SIZE];
+    aes256_key_schedule ctx;
+    EVP_CIPHER_CTX *evp_ctx = NULL;
+
+    for (it=0; it<iterations && status; it++)
+    {
+        bdap_randombytes(plaintext, sizeof(plaintext));
+        bdap_randombytes(key, sizeof(key));
+        num_blocks = 1 + (size_t)(it % 11);
+
+        /* Every backend is checked against OpenSSL */
+        if (!(evp_ctx = EVP_CIPHER_CTX_new()) ||
+            !EVP_EncryptInit_ex(evp_ctx, EVP_aes_256_ecb(), NULL, key, NULL) ||
+            !EVP_CIPHER_CTX_set_padding(evp_ctx, 0) ||
+            1 != EVP_EncryptUpdate(evp_ctx,
+                                   expected,
+                                   &openssl_len,
+                                   plaintext,
+                                   (int)(num_blocks * AES256_BLOCK_SIZE)))
+        {
+            status = false;
+        }
+        if (evp_ctx)
+        {
+            EVP_CIPHER_CTX_free(evp_ctx);
+            evp_ctx = NULL;
+        }
+
+        /* Cycle through the AES-NI, vector-permute and bit-sliced backends */
+        cpu_features_disable(backends[it % 3]);
+        aes256_init(&ctx, key);
+        aes256_encrypt_blocks(&ctx, ciphertext, plaintext, num_blocks);
+        status = status && (memcmp(expected,
+                                   ciphertext,
+                                   num_blocks * AES256_BLOCK_SIZE) == 0);
+
+        aes256_decrypt_blocks(&ctx, decrypted, ciphertext, num_blocks);
+        status = status && (memcmp(decrypted,
+                                   plaintext,
+                                   num_blocks * AES256_BLOCK_SIZE) == 0);
+    }
+
+    cpu_features_disable(0);
+    crypto_memzero(&ctx, sizeof(ctx));
+
+    return status;
+}
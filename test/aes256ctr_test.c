@@ -12,6 +12,7 @@
 #include <openssl/evp.h>
 #include "rand.h"
 #include "aes256ctr.h"
+#include "cpu_features.h"
 #include "utils.h"
 
 typedef struct
@@ -385,3 +386,119 @@ bail_openssl_test:
 
     return status;
 }
+
+bool openssl_aes256ctr_seek_test(int32_t iterations)
+{
+    int32_t it;
+    bool status = true;
+    EVP_CIPHER_CTX *ctx = NULL;
+    aes256ctr_ctx ctr;
+    int32_t openssl_len;
+    uint8_t plaintext[1000];
+    uint8_t ciphertext[sizeof(plaintext)];
+    uint8_t openssl_ciphertext[sizeof(plaintext)];
+    uint8_t key[AES256CTR_KEY_SIZE];
+    uint8_t iv[AES256CTR_IV_SIZE];
+    uint8_t random[2];
+    size_t offset, piece, start;
+
+    for (it=0; it<iterations && status; it++)
+    {
+        bdap_randombytes(key, sizeof(key));
+        bdap_randombytes(iv, sizeof(iv));
+        bdap_randombytes(plaintext, sizeof(plaintext));
+
+        /* Make the counter carry out of the low word, and on odd
+         * iterations wrap around 2^128 */
+        memset(iv + 8, 0xFF, 7);
+        if (it & 1)
+        {
+            memset(iv, 0xFF, 8);
+        }
+
+        if (!(ctx = EVP_CIPHER_CTX_new()) ||
+            !EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, key, iv) ||
+            1 != EVP_EncryptUpdate(ctx,
+                                   openssl_ciphertext,
+                                   &openssl_len,
+                                   plaintext,
+                                   sizeof(plaintext)))
+        {
+            status = false;
+        }
+        if (ctx)
+        {
+            EVP_CIPHER_CTX_free(ctx);
+            ctx = NULL;
+        }
+
+        /* Process from a random block in random pieces */
+        bdap_randombytes(random, 1);
+        start = 16 * (random[0] % (sizeof(plaintext) / 16));
+        aes256ctr_init(&ctr, key, iv);
+        aes256ctr_update(&ctr, ciphertext, plaintext, 5);
+        aes256ctr_seek(&ctr, start / 16);
+        for (offset = start; offset < sizeof(plaintext); offset += piece)
+        {
+            bdap_randombytes(random, 2);
+            piece = 1 + random[1] % 100;
+            if (piece > sizeof(plaintext) - offset)
+            {
+                piece = sizeof(plaintext) - offset;
+            }
+            aes256ctr_update(&ctr, ciphertext + offset,
+                             plaintext + offset, piece);
+        }
+        aes256ctr_final(&ctr);
+
+        status = status &&
+                 (memcmp(ciphertext + start,
+                         openssl_ciphertext + start,
+                         sizeof(plaintext) - start) == 0);
+    }
+
+    return status;
+}
+
+bool aes256ctr_multi_key_random_test(int32_t iterations)
+{
+    static const uint32_t backends[3] = {
+        0, CPU_FEATURE_AESNI, CPU_FEATURE_AESNI | CPU_FEATURE_SSSE3
+    };
+    int32_t it;
+    bool status = true;
+    uint8_t plaintext[11 * 100];
+    uint8_t ciphertext[sizeof(plaintext)];
+    uint8_t expected[100];
+    uint8_t keys[11 * AES256CTR_KEY_SIZE];
+    uint8_t ivs[11 * AES256CTR_IV_SIZE];
+    uint8_t random[2];
+    size_t n, num_keys, msg_len, unused;
+
+    for (it=0; it<iterations && status; it++)
+    {
+        /* Cycle through the AES-NI, vector-permute and bit-sliced backends */
+        cpu_features_disable(backends[it % 3]);
+
+        bdap_randombytes(random, sizeof(random));
+        num_keys = 1 + random[0] % 11;
+        msg_len = random[1] % 101;
+        bdap_randombytes(keys, sizeof(keys));
+        bdap_randombytes(ivs, sizeof(ivs));
+        bdap_randombytes(plaintext, sizeof(plaintext));
+
+        aes256ctr_encrypt_multi_key(ciphertext, plaintext, msg_len,
+                                    ivs, keys, num_keys);
+
+        for (n = 0; n < num_keys && status; ++n)
+        {
+            aes256ctr_encrypt(expected, &unused, plaintext + n * msg_len,
+                              msg_len, ivs + n * AES256CTR_IV_SIZE,
+                              keys + n * AES256CTR_KEY_SIZE);
+            status = memcmp(ciphertext + n * msg_len, expected, msg_len) == 0;
+        }
+    }
+    cpu_features_disable(0);
+
+    return status;
+}
@@ -11,6 +11,8 @@
 #include <string.h>
 #include <openssl/evp.h>
 #include "aes256gcm.h"
+#include "cpu_features.h"
+#include "rand.h"
 #include "utils.h"
 
 typedef struct
@@ -472,3 +474,290 @@ bail_test:
 
     return result;
 }
+
+/**
+ * Compares random encryptions against OpenSSL, alternating between
+ * the hardware and the portable backends.
+ */
+bool openssl_aes256gcm_random_test(int iterations)
+{
+    static const uint32_t backends[3] = {
+        0,
+        CPU_FEATURE_AESNI | CPU_FEATURE_PCLMUL,
+        CPU_FEATURE_AESNI | CPU_FEATURE_PCLMUL | CPU_FEATURE_SSSE3
+    };
+    int32_t it;
+    int32_t buf_size;
+    bool result = true;
+    EVP_CIPHER_CTX *ctx = NULL;
+    uint8_t key[AES256GCM_KEY_SIZE];
+    uint8_t nonce[AES256GCM_NONCE_SIZE];
+    uint8_t aad[64];
+    uint8_t plaintext[300];
+    uint8_t ciphertext[sizeof(plaintext) + AES256GCM_TAG_SIZE];
+    uint8_t expected[sizeof(plaintext) + AES256GCM_TAG_SIZE];
+    uint8_t decrypted[sizeof(plaintext)];
+    uint8_t length[2];
+    size_t msg_len, aad_len, c_len, m_len;
+
+    for (it = 0; it < iterations && result; it++)
+    {
+        result = false;
+        cpu_features_disable(backends[it % 3]);
+
+        bdap_randombytes(key, sizeof(key));
+        bdap_randombytes(nonce, sizeof(nonce));
+        bdap_randombytes(aad, sizeof(aad));
+        bdap_randombytes(plaintext, sizeof(plaintext));
+        bdap_randombytes(length, sizeof(length));
+        msg_len = length[0] + (length[1] & 0x1f);
+        aad_len = length[1] % (sizeof(aad) + 1);
+
+        if (0 != aes256gcm_encrypt(ciphertext, &c_len, plaintext, msg_len,
+                                   aad, aad_len, nonce, key))
+        {
+            goto bail_test;
+        }
+
+        if (!(ctx = EVP_CIPHER_CTX_new()) ||
+            !EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, nonce) ||
+            !EVP_EncryptUpdate(ctx, NULL, &buf_size, aad, (int32_t)aad_len) ||
+            !EVP_EncryptUpdate(ctx, expected, &buf_size,
+                               plaintext, (int32_t)msg_len) ||
+            !EVP_EncryptFinal_ex(ctx, expected + buf_size, &buf_size) ||
+            !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG,
+                                 AES256GCM_TAG_SIZE, expected + msg_len))
+        {
+            goto bail_test;
+        }
+
+        if (c_len != msg_len + AES256GCM_TAG_SIZE ||
+            memcmp(ciphertext, expected, c_len) != 0)
+        {
+            goto bail_test;
+        }
+
+        if (0 != aes256gcm_decrypt(decrypted, &m_len, ciphertext, c_len,
+                                   aad, aad_len, nonce, key) ||
+            m_len != msg_len ||
+            memcmp(decrypted, plaintext, msg_len) != 0)
+        {
+            goto bail_test;
+        }
+
+        crypto_memzero(decrypted, sizeof(decrypted));
+        if (0 != aes256gcm_decrypt_single_pass(decrypted, &m_len,
+                                               ciphertext, c_len,
+                                               aad, aad_len, nonce, key) ||
+            m_len != msg_len ||
+            memcmp(decrypted, plaintext, msg_len) != 0)
+        {
+            goto bail_test;
+        }
+
+        /* A corrupted tag must be rejected, and the single-pass
+         * output wiped */
+        ciphertext[c_len - 1] ^= 0x01;
+        if (aes256gcm_decrypt(decrypted, &m_len, ciphertext, c_len,
+                              aad, aad_len, nonce, key) == 0 ||
+            aes256gcm_decrypt_single_pass(decrypted, &m_len,
+                                          ciphertext, c_len,
+                                          aad, aad_len, nonce, key) == 0)
+        {
+            goto bail_test;
+        }
+        memset(expected, 0, msg_len);
+        result = memcmp(decrypted, expected, msg_len) == 0;
+bail_test:
+        if (ctx)
+        {
+            EVP_CIPHER_CTX_free(ctx);
+            ctx = NULL;
+        }
+    }
+
+    cpu_features_disable(0);
+
+#if SIZE_MAX > 0xFFFFFFFF
+    /* A ciphertext over the GCM limit is rejected before anything is
+     * read or written */
+    result = result &&
+        aes256gcm_decrypt_single_pass(decrypted, &m_len, ciphertext, SIZE_MAX,
+                                      aad, 0, nonce, key) != 0;
+#endif
+
+    return result;
+}
+
+/**
+ * Feeds the AAD and the message to the incremental API in random
+ * pieces and compares with the one-shot functions.
+ */
+bool aes256gcm_streaming_random_test(int iterations)
+{
+    int32_t it;
+    bool result = true;
+    aes256gcm_ctx ctx;
+    uint8_t key[AES256GCM_KEY_SIZE];
+    uint8_t nonce[AES256GCM_NONCE_SIZE];
+    uint8_t aad[100];
+    uint8_t plaintext[500];
+    uint8_t ciphertext[sizeof(plaintext) + AES256GCM_TAG_SIZE];
+    uint8_t expected[sizeof(plaintext) + AES256GCM_TAG_SIZE];
+    uint8_t decrypted[sizeof(plaintext)];
+    uint8_t random[2];
+    size_t msg_len, aad_len, c_len, offset, piece;
+
+    for (it = 0; it < iterations && result; it++)
+    {
+        bdap_randombytes(key, sizeof(key));
+        bdap_randombytes(nonce, sizeof(nonce));
+        bdap_randombytes(aad, sizeof(aad));
+        bdap_randombytes(plaintext, sizeof(plaintext));
+        bdap_randombytes(random, sizeof(random));
+        msg_len = ((size_t)random[0] << 1) % (sizeof(plaintext) + 1);
+        aad_len = random[1] % (sizeof(aad) + 1);
+
+        aes256gcm_encrypt(expected, &c_len, plaintext, msg_len,
+                          aad, aad_len, nonce, key);
+
+        aes256gcm_init(&ctx, key, nonce);
+        for (offset = 0; offset < aad_len; offset += piece)
+        {
+            bdap_randombytes(random, 1);
+            piece = 1 + random[0] % 40;
+            if (piece > aad_len - offset)
+            {
+                piece = aad_len - offset;
+            }
+            aes256gcm_update_aad(&ctx, aad + offset, piece);
+        }
+        for (offset = 0; offset < msg_len; offset += piece)
+        {
+            bdap_randombytes(random, 1);
+            piece = 1 + random[0] % 200;
+            if (piece > msg_len - offset)
+            {
+                piece = msg_len - offset;
+            }
+            aes256gcm_encrypt_update(&ctx, ciphertext + offset,
+                                     plaintext + offset, piece);
+        }
+        aes256gcm_encrypt_final(&ctx, ciphertext + msg_len);
+
+        result = memcmp(ciphertext, expected, c_len) == 0;
+
+        aes256gcm_init(&ctx, key, nonce);
+        aes256gcm_update_aad(&ctx, aad, aad_len);
+        if (aes256gcm_update_aad(&ctx, aad, 0) != 0)
+        {
+            result = false;
+        }
+        for (offset = 0; offset < msg_len; offset += piece)
+        {
+            bdap_randombytes(random, 1);
+            piece = 1 + random[0] % 200;
+            if (piece > msg_len - offset)
+            {
+                piece = msg_len - offset;
+            }
+            aes256gcm_decrypt_update(&ctx, decrypted + offset,
+                                     ciphertext + offset, piece);
+        }
+        if (msg_len > 0 && aes256gcm_update_aad(&ctx, aad, aad_len) == 0)
+        {
+            result = false;
+        }
+        result = result &&
+            aes256gcm_decrypt_verify(&ctx, ciphertext + msg_len) == 0 &&
+            memcmp(decrypted, plaintext, msg_len) == 0;
+    }
+
+#if SIZE_MAX > 0xFFFFFFFF
+    /* A message over the GCM limit is rejected before it is read, with
+     * the ciphertext size cleared */
+    c_len = 1;
+    result = result &&
+        aes256gcm_encrypt(ciphertext, &c_len, plaintext, SIZE_MAX,
+                          aad, 0, nonce, key) != 0 &&
+        c_len == 0;
+#endif
+
+    return result;
+}
+
+bool aes256gcm_parallel_random_test(int iterations)
+{
+    int32_t it;
+    bool result = true;
+    bool single_pass;
+    uint8_t key[AES256GCM_KEY_SIZE];
+    uint8_t nonce[AES256GCM_NONCE_SIZE];
+    uint8_t aad[100];
+    /* Long enough for 5 threads of AES256GCM_MIN_THREAD_BYTES */
+    static uint8_t plaintext[5 * AES256GCM_MIN_THREAD_BYTES + 100];
+    static uint8_t ciphertext[sizeof(plaintext) + AES256GCM_TAG_SIZE];
+    static uint8_t expected[sizeof(plaintext) + AES256GCM_TAG_SIZE];
+    static uint8_t decrypted[sizeof(plaintext)];
+    uint8_t random[5];
+    size_t msg_len, aad_len, c_len, m_len;
+    uint32_t num_threads;
+
+    for (it = 0; it < iterations && result; it++)
+    {
+        bdap_randombytes(key, sizeof(key));
+        bdap_randombytes(nonce, sizeof(nonce));
+        bdap_randombytes(aad, sizeof(aad));
+        bdap_randombytes(plaintext, sizeof(plaintext));
+        bdap_randombytes(random, sizeof(random));
+        msg_len = (((size_t)random[0] << 16) | ((size_t)random[1] << 8) |
+                   random[2]) % (sizeof(plaintext) + 1);
+        aad_len = random[3] % (sizeof(aad) + 1);
+        num_threads = 1 + random[4] % 5;
+        single_pass = (it & 1) != 0;
+
+        aes256gcm_encrypt(expected, &c_len, plaintext, msg_len,
+                          aad, aad_len, nonce, key);
+
+        result = aes256gcm_encrypt_parallel(ciphertext, &c_len, plaintext,
+                                            msg_len, aad, aad_len, nonce,
+                                            key, num_threads) == 0 &&
+            c_len == msg_len + AES256GCM_TAG_SIZE &&
+            memcmp(ciphertext, expected, c_len) == 0;
+
+        result = result &&
+            aes256gcm_decrypt_parallel(decrypted, &m_len, ciphertext, c_len,
+                                       aad, aad_len, nonce, key,
+                                       num_threads, single_pass) == 0 &&
+            m_len == msg_len &&
+            memcmp(decrypted, plaintext, msg_len) == 0;
+
+        /* A tampered tag must be rejected, and with single_pass the
+         * plaintext wiped */
+        ciphertext[msg_len] ^= 0x01;
+        memset(decrypted, 0xAA, sizeof(decrypted));
+        result = result &&
+            aes256gcm_decrypt_parallel(decrypted, &m_len, ciphertext, c_len,
+                                       aad, aad_len, nonce, key,
+                                       num_threads, single_pass) != 0;
+        if (result && single_pass)
+        {
+            for (m_len = 0; m_len < msg_len; ++m_len)
+            {
+                result = result && decrypted[m_len] == 0;
+            }
+        }
+    }
+
+#if SIZE_MAX > 0xFFFFFFFF
+    /* A message over the GCM limit is rejected before it is read, with
+     * the ciphertext size cleared */
+    c_len = 1;
+    result = result &&
+        aes256gcm_encrypt_parallel(ciphertext, &c_len, plaintext, SIZE_MAX,
+                                   aad, 0, nonce, key, 2) != 0 &&
+        c_len == 0;
+#endif
+
+    return result;
+}
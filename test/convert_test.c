@@ -6,6 +6,7 @@
 #include <string.h>
 #include "curve25519.h"
 #include "ed25519.h"
+#include "rand.h"
 #include "utils.h"
 
 typedef struct
@@ -428,3 +429,67 @@ bool ed25519_to_curve25519_random_conversion_test(int iterations)
 
 	return result;
 }
+
+/**
+ * The batch conversion must match ed25519_to_curve25519_public_key() key
+ * by key, on a mix of valid keys, random bytes and small order points.
+ */
+bool ed25519_to_curve25519_batch_random_test(int iterations)
+{
+    static const uint8_t small_order[ED25519_PUBLIC_KEY_SIZE] = {1};
+    int32_t idx, expected_result;
+    size_t i, n;
+    bool result = true;
+    bool valid[16];
+    bool expected_valid[16];
+    uint8_t ed25519_sk[ED25519_PRIVATE_KEY_SIZE];
+    uint8_t ed25519_pk[16][ED25519_PUBLIC_KEY_SIZE];
+    uint8_t curve25519_pk[16][CURVE25519_PUBLIC_KEY_SIZE];
+    uint8_t expected_pk[16][CURVE25519_PUBLIC_KEY_SIZE];
+    const uint8_t *in_ptrs[16];
+    uint8_t *out_ptrs[16];
+
+    for (idx = 0; result && idx < iterations; ++idx)
+    {
+        bdap_randombytes((uint8_t *)&n, sizeof(n));
+        n %= 17;
+        expected_result = 0;
+        for (i = 0; i < n; ++i)
+        {
+            bdap_randombytes(ed25519_sk, 1);
+            switch (ed25519_sk[0] % 8)
+            {
+            case 0:
+                bdap_randombytes(ed25519_pk[i], ED25519_PUBLIC_KEY_SIZE);
+                break;
+            case 1:
+                memcpy(ed25519_pk[i], small_order, ED25519_PUBLIC_KEY_SIZE);
+                break;
+            default:
+                ed25519_keypair(ed25519_pk[i], ed25519_sk);
+                break;
+            }
+            in_ptrs[i] = ed25519_pk[i];
+            out_ptrs[i] = curve25519_pk[i];
+
+            memset(expected_pk[i], 0, CURVE25519_PUBLIC_KEY_SIZE);
+            expected_valid[i] =
+                (0 == ed25519_to_curve25519_public_key(expected_pk[i], ed25519_pk[i]));
+            if (!expected_valid[i])
+            {
+                memset(expected_pk[i], 0, CURVE25519_PUBLIC_KEY_SIZE);
+                expected_result = -1;
+            }
+        }
+
+        result = (expected_result ==
+                  ed25519_to_curve25519_public_keys(out_ptrs, in_ptrs, valid, n));
+        for (i = 0; result && i < n; ++i)
+        {
+            result = (valid[i] == expected_valid[i]) &&
+                (0 == memcmp(curve25519_pk[i], expected_pk[i], CURVE25519_PUBLIC_KEY_SIZE));
+        }
+    }
+
+    return result;
+}
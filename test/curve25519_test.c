@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <string.h>
+#include "cpu_features.h"
 #include "curve25519.h"
 #include "utils.h"
 #include "rand.h"
@@ -303,3 +304,84 @@ bool curve25519_random_keypair_test()
 
     return result;
 }
+
+/**
+ * The times-4 exchange of 1 to 4 points must match curve25519_dh(), with
+ * and without AVX2, and reject a batch with a point of small order.
+ */
+bool curve25519_dh_x4_random_test(int32_t iterations)
+{
+    static const uint8_t small_order[CURVE25519_POINT_SIZE] = {1};
+    int32_t it;
+    uint32_t j, count;
+    bool result = true;
+    uint8_t n[CURVE25519_SCALAR_SIZE];
+    uint8_t sk[CURVE25519_PRIVATE_KEY_SIZE];
+    uint8_t p[4][CURVE25519_POINT_SIZE];
+    uint8_t q[4][CURVE25519_POINT_SIZE];
+    uint8_t expected[CURVE25519_POINT_SIZE];
+    const uint8_t *p_ptrs[4];
+    uint8_t *q_ptrs[4];
+
+    for (it = 0; result && it < iterations; ++it)
+    {
+        /* Alternate between the AVX2 and the scalar ladders */
+        cpu_features_disable((it & 1) ? CPU_FEATURE_AVX2 : 0);
+
+        count = 1 + (uint32_t)(it >> 1) % 4;
+
+        bdap_randombytes(n, sizeof(n));
+        memset(q, 0, sizeof(q));
+        for (j = 0; j < 4; ++j)
+        {
+            curve25519_random_keypair(p[j], sk);
+            p_ptrs[j] = p[j];
+            q_ptrs[j] = q[j];
+        }
+
+        /* Lanes past count are neither read nor written */
+        result = curve25519_dh_x4(q_ptrs, n, p_ptrs, count);
+        for (j = 0; result && j < 4; ++j)
+        {
+            if (j < count)
+            {
+                result = curve25519_dh(expected, n, p[j]);
+            }
+            else
+            {
+                memset(expected, 0, sizeof(expected));
+            }
+            result = result &&
+                (memcmp(q[j], expected, CURVE25519_POINT_SIZE) == 0);
+        }
+
+        p_ptrs[count - 1] = small_order;
+        result = result && !curve25519_dh_x4(q_ptrs, n, p_ptrs, count);
+    }
+    cpu_features_disable(0);
+
+    return result;
+}
+
+/**
+ * The fixed-base public-key must match the ladder on the base-point.
+ */
+bool curve25519_public_key_random_test(int32_t iterations)
+{
+    static const uint8_t basepoint[CURVE25519_POINT_SIZE] = {9};
+    int32_t it;
+    bool result = true;
+    uint8_t sk[CURVE25519_PRIVATE_KEY_SIZE];
+    uint8_t pk[CURVE25519_PUBLIC_KEY_SIZE];
+    uint8_t expected[CURVE25519_PUBLIC_KEY_SIZE];
+
+    for (it = 0; result && it < iterations; ++it)
+    {
+        bdap_randombytes(sk, sizeof(sk));
+        result = curve25519_public_key_from_private_key(pk, sk) &&
+            curve25519_dh(expected, sk, basepoint) &&
+            (memcmp(pk, expected, CURVE25519_PUBLIC_KEY_SIZE) == 0);
+    }
+
+    return result;
+}
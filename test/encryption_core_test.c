@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include "cpu_features.h"
 #include "rand.h"
 #include "encryption_core.h"
 #include "ed25519.h"
@@ -184,3 +185,228 @@ bool bdap_random_test()
 
     return result;
 }
+
+/**
+ * Every recipient of groups of 1 to 9 must decrypt, which covers the
+ * partial groups of the times-4 steps, with and without AVX2.
+ */
+bool bdap_recipient_groups_test()
+{
+    int32_t idx;
+    bool result = true;
+    uint16_t r, num_recipients;
+    uint8_t ed25519_pk[9][ED25519_PUBLIC_KEY_SIZE];
+    uint8_t ed25519_sk[9][ED25519_PRIVATE_KEY_SIZE];
+    uint8_t plaintext[100];
+    uint8_t decrypted[sizeof(plaintext)];
+    uint8_t *ciphertext = NULL;
+    const uint8_t *ed25519_pk_ptr[9];
+    size_t ciphertext_size = 0;
+
+    for (r = 0; r < 9; r++)
+    {
+        ed25519_keypair(ed25519_pk[r], ed25519_sk[r]);
+        ed25519_pk_ptr[r] = ed25519_pk[r];
+    }
+    bdap_randombytes(plaintext, sizeof(plaintext));
+
+    for (idx = 0; result && idx < 18; idx++)
+    {
+        cpu_features_disable((idx & 1) ? CPU_FEATURE_AVX2 : 0);
+
+        num_recipients = (uint16_t)(1 + idx / 2);
+        ciphertext_size = bdap_ciphertext_size(num_recipients, sizeof(plaintext));
+        ciphertext = (uint8_t *)calloc(ciphertext_size, sizeof(uint8_t));
+
+        result = bdap_encrypt(ciphertext, num_recipients, ed25519_pk_ptr,
+                              plaintext, sizeof(plaintext), NULL);
+        for (r = 0; result && r < num_recipients; r++)
+        {
+            memset(decrypted, 0, sizeof(decrypted));
+            result = bdap_decrypt(decrypted, ed25519_sk[r],
+                                  ciphertext, ciphertext_size, NULL) &&
+                     memcmp(decrypted, plaintext, sizeof(plaintext)) == 0;
+        }
+
+        free(ciphertext);
+    }
+    cpu_features_disable(0);
+
+    return result;
+}
+
+bool bdap_single_pass_decrypt_test()
+{
+    int32_t idx;
+    bool result = true;
+    uint8_t seed[24];
+    uint8_t ed25519_pk[ED25519_PUBLIC_KEY_SIZE];
+    uint8_t ed25519_sk[ED25519_PRIVATE_KEY_SIZE];
+    uint8_t plaintext[1000];
+    uint8_t zeros[sizeof(plaintext)];
+    uint8_t decrypted[sizeof(plaintext)];
+    uint8_t *ciphertext = NULL;
+    const uint8_t *ed25519_pk_ptr = ed25519_pk;
+    size_t plaintext_size = 0;
+    size_t ciphertext_size = 0;
+
+    memset(zeros, 0, sizeof(zeros));
+
+    for (idx = 0; result && idx < 8; idx++)
+    {
+        hex_string_to_byte_array(seed, seed_pool[idx]);
+        bdap_randominit(seed, sizeof(seed));
+
+        ed25519_keypair(ed25519_pk, ed25519_sk);
+        bdap_randombytes((uint8_t *)&plaintext_size, sizeof(plaintext_size));
+        plaintext_size %= sizeof(plaintext);
+        bdap_randombytes(plaintext, plaintext_size);
+
+        ciphertext_size = bdap_ciphertext_size(1, plaintext_size);
+        ciphertext = (uint8_t *)calloc(ciphertext_size, sizeof(uint8_t));
+
+        result = bdap_encrypt(ciphertext, 1, &ed25519_pk_ptr,
+                              plaintext, plaintext_size, NULL) &&
+                 bdap_decrypt_ex(decrypted, ed25519_sk,
+                                 ciphertext, ciphertext_size,
+                                 BDAP_DECRYPT_SINGLE_PASS, NULL) &&
+                 memcmp(decrypted, plaintext, plaintext_size) == 0;
+
+        /* A tampered payload is rejected and the output wiped */
+        ciphertext[ciphertext_size - 1] ^= 0x80;
+        result = result &&
+                 !bdap_decrypt_ex(decrypted, ed25519_sk,
+                                  ciphertext, ciphertext_size,
+                                  BDAP_DECRYPT_SINGLE_PASS, NULL) &&
+                 memcmp(decrypted, zeros, plaintext_size) == 0;
+
+        free(ciphertext);
+    }
+
+    return result;
+}
+
+bool bdap_parallel_test()
+{
+    int32_t idx;
+    bool result = true;
+    uint8_t seed[24];
+    uint8_t ed25519_pk[ED25519_PUBLIC_KEY_SIZE];
+    uint8_t ed25519_sk[ED25519_PRIVATE_KEY_SIZE];
+    uint8_t *plaintext = NULL;
+    uint8_t *decrypted = NULL;
+    uint8_t *ciphertext = NULL;
+    uint8_t *expected = NULL;
+    const uint8_t *ed25519_pk_ptr = ed25519_pk;
+    size_t plaintext_size = 0;
+    size_t ciphertext_size = 0;
+
+    for (idx = 0; result && idx < 2; idx++)
+    {
+        hex_string_to_byte_array(seed, seed_pool[idx]);
+        plaintext_size = BDAP_PARALLEL_THRESHOLD + 17 * idx;
+        ciphertext_size = bdap_ciphertext_size(1, plaintext_size);
+        plaintext = (uint8_t *)calloc(plaintext_size, sizeof(uint8_t));
+        decrypted = (uint8_t *)calloc(plaintext_size, sizeof(uint8_t));
+        ciphertext = (uint8_t *)calloc(ciphertext_size, sizeof(uint8_t));
+        expected = (uint8_t *)calloc(ciphertext_size, sizeof(uint8_t));
+
+        /* The same random stream yields the same ciphertext with and
+         * without the parallel option */
+        bdap_randominit(seed, sizeof(seed));
+        ed25519_keypair(ed25519_pk, ed25519_sk);
+        bdap_randombytes(plaintext, plaintext_size);
+        result = bdap_encrypt(expected, 1, &ed25519_pk_ptr,
+                              plaintext, plaintext_size, NULL);
+
+        bdap_randominit(seed, sizeof(seed));
+        ed25519_keypair(ed25519_pk, ed25519_sk);
+        bdap_randombytes(plaintext, plaintext_size);
+        result = result &&
+                 bdap_encrypt_ex(ciphertext, 1, &ed25519_pk_ptr,
+                                 plaintext, plaintext_size,
+                                 BDAP_ENCRYPT_PARALLEL, NULL, NULL) &&
+                 memcmp(ciphertext, expected, ciphertext_size) == 0;
+
+        result = result &&
+                 bdap_decrypt_ex(decrypted, ed25519_sk,
+                                 ciphertext, ciphertext_size,
+                                 BDAP_DECRYPT_PARALLEL, NULL) &&
+                 memcmp(decrypted, plaintext, plaintext_size) == 0;
+
+        /* A tampered payload is rejected */
+        ciphertext[ciphertext_size - 1] ^= 0x80;
+        result = result &&
+                 !bdap_decrypt_ex(decrypted, ed25519_sk,
+                                  ciphertext, ciphertext_size,
+                                  BDAP_DECRYPT_PARALLEL |
+                                  BDAP_DECRYPT_SINGLE_PASS, NULL);
+
+        free(plaintext);
+        free(decrypted);
+        free(ciphertext);
+        free(expected);
+    }
+
+    return result;
+}
+
+bool bdap_rng_provider_test()
+{
+    int32_t idx;
+    bool result = true;
+    uint8_t seed[24];
+    uint8_t other_seed[24];
+    uint8_t plaintext[100];
+    uint8_t decrypted[100];
+    uint8_t ed25519_pk[2][ED25519_PUBLIC_KEY_SIZE];
+    uint8_t ed25519_sk[2][ED25519_PRIVATE_KEY_SIZE];
+    uint8_t curve25519_pk[2][CURVE25519_PUBLIC_KEY_SIZE];
+    uint8_t curve25519_sk[2][CURVE25519_PRIVATE_KEY_SIZE];
+    uint8_t ciphertext[2][2 + 32 + 39 + 100 + 16];
+    const uint8_t *ed25519_pk_ptr = NULL;
+    shake256_rand_ctx ctx;
+    bdap_rng rng;
+
+    memset(plaintext, 0x5a, sizeof(plaintext));
+    for (idx = 0; result && idx < 4; idx++)
+    {
+        hex_string_to_byte_array(seed, seed_pool[idx]);
+        hex_string_to_byte_array(other_seed, seed_pool[idx + 4]);
+
+        /* The global generator */
+        bdap_randominit(seed, sizeof(seed));
+        ed25519_keypair(ed25519_pk[0], ed25519_sk[0]);
+        curve25519_random_keypair(curve25519_pk[0], curve25519_sk[0]);
+        ed25519_pk_ptr = ed25519_pk[0];
+        result = bdap_encrypt(ciphertext[0], 1, &ed25519_pk_ptr,
+                              plaintext, sizeof(plaintext), NULL);
+
+        /* A provider with the same seed, while the global generator
+         * is used with another one */
+        bdap_rng_shake256(&rng, &ctx, seed, sizeof(seed));
+        bdap_randominit(other_seed, sizeof(other_seed));
+        ed25519_keypair_ex(ed25519_pk[1], ed25519_sk[1], &rng);
+        bdap_randombytes(decrypted, sizeof(decrypted));
+        curve25519_random_keypair_ex(curve25519_pk[1], curve25519_sk[1], &rng);
+        bdap_randombytes(decrypted, sizeof(decrypted));
+        ed25519_pk_ptr = ed25519_pk[1];
+        result = result &&
+                 bdap_encrypt_ex(ciphertext[1], 1, &ed25519_pk_ptr,
+                                 plaintext, sizeof(plaintext),
+                                 0, &rng, NULL);
+
+        result = result &&
+                 memcmp(ed25519_sk[0], ed25519_sk[1], sizeof(ed25519_sk[0])) == 0 &&
+                 memcmp(curve25519_sk[0], curve25519_sk[1], sizeof(curve25519_sk[0])) == 0 &&
+                 memcmp(ciphertext[0], ciphertext[1], sizeof(ciphertext[0])) == 0;
+
+        result = result &&
+                 bdap_decrypt(decrypted, ed25519_sk[1],
+                              ciphertext[1], sizeof(ciphertext[1]), NULL) &&
+                 memcmp(decrypted, plaintext, sizeof(plaintext)) == 0;
+    }
+    crypto_memzero(&ctx, sizeof(ctx));
+
+    return result;
+}
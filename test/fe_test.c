@@ -0,0 +1,110 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "fe.h"
+#include "rand.h"
+
+/* p = 2^255 - 19, little-endian */
+static const uint8_t p_bytes[32] =
+{
+    0xed, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+};
+
+/**
+ * fe_inv must match fe_inv_fermat on s, and z * z^-1 must be one unless
+ * s encodes zero.
+ */
+static bool fe_inv_check(const uint8_t *s)
+{
+    static const uint8_t one[32] = {1};
+    static const uint8_t zero[32] = {0};
+    uint8_t a[32], b[32], c[32];
+    fe z, x, y;
+
+    fe_frombytes(z, s);
+    fe_inv(x, z);
+    fe_inv_fermat(y, z);
+    fe_tobytes(a, x);
+    fe_tobytes(b, y);
+    fe_mul(y, x, z);
+    fe_tobytes(c, y);
+
+    return (memcmp(a, b, sizeof(a)) == 0) &&
+        (memcmp(c, one, sizeof(c)) == 0 || memcmp(a, zero, sizeof(a)) == 0);
+}
+
+/* Subtracts the small value k from the little-endian number s */
+static void sub_small(uint8_t *s, uint32_t k)
+{
+    int32_t i;
+    int32_t borrow = (int32_t)k;
+
+    for (i = 0; i < 32; ++i)
+    {
+        borrow = s[i] - borrow;
+        s[i] = (uint8_t)borrow;
+        borrow = (borrow < 0) ? (-borrow + 255) / 256 : 0;
+    }
+}
+
+/**
+ * The safegcd and Fermat inversions on the small values, the values
+ * just below p and 2^255, the non-canonical encodings p to 2^255 - 1,
+ * the powers of two and their neighbours, and random elements.
+ */
+bool fe_inv_test(int32_t iterations)
+{
+    int32_t it, k;
+    bool result = true;
+    uint8_t s[32];
+
+    for (k = 0; result && k < 1024; ++k)
+    {
+        memset(s, 0, sizeof(s));
+        s[0] = (uint8_t)k;
+        s[1] = (uint8_t)(k >> 8);
+        result = fe_inv_check(s);
+
+        memcpy(s, p_bytes, sizeof(s));
+        sub_small(s, (uint32_t)k);
+        result = result && fe_inv_check(s);
+
+        /* Non-canonical encodings p + k and 2^256 - 1 - k */
+        memcpy(s, p_bytes, sizeof(s));
+        s[0] = (uint8_t)(0xed + (k % 19));
+        result = result && fe_inv_check(s);
+
+        memset(s, 0xff, sizeof(s));
+        sub_small(s, (uint32_t)k);
+        result = result && fe_inv_check(s);
+    }
+
+    for (k = 0; result && k < 256; ++k)
+    {
+        memset(s, 0, sizeof(s));
+        s[k / 8] = (uint8_t)(1 << (k % 8));
+        result = fe_inv_check(s);
+
+        sub_small(s, 1);
+        result = result && fe_inv_check(s);
+
+        memset(s, 0, sizeof(s));
+        s[k / 8] = (uint8_t)(1 << (k % 8));
+        s[0] |= 1;
+        result = result && fe_inv_check(s);
+    }
+
+    for (it = 0; result && it < iterations * 100; ++it)
+    {
+        bdap_randombytes(s, sizeof(s));
+        result = fe_inv_check(s);
+    }
+
+    return result;
+}
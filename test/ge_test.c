@@ -0,0 +1,76 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ed25519.h"
+#include "ge.h"
+#include "rand.h"
+
+/**
+ * ge_is_on_main_subgroup and ge_are_on_main_subgroup must match the
+ * multiplication by the group order on the identity, the point of order
+ * 2, Ed25519 public-keys and random points, which carry every torsion
+ * component.
+ */
+bool ge_subgroup_random_test(int32_t iterations)
+{
+    static const uint8_t identity[32] = {1};
+    static const uint8_t order_2[32] =
+    {
+        0xec, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+    };
+    int32_t it;
+    size_t j, n;
+    bool result = true;
+    bool batch[2 * GE_SUBGROUP_BATCH_SIZE + 1];
+    uint8_t s[32];
+    uint8_t sk[ED25519_PRIVATE_KEY_SIZE];
+    ge_p3 h[2 * GE_SUBGROUP_BATCH_SIZE + 1];
+
+    result = (ge_frombytes(&h[0], identity) == 0) &&
+        ge_is_on_main_subgroup(&h[0]) &&
+        (ge_frombytes(&h[1], order_2) == 0) &&
+        !ge_is_on_main_subgroup(&h[1]) &&
+        !ge_is_on_main_subgroup_mul_l(&h[1]);
+
+    for (it = 0; result && it < iterations; ++it)
+    {
+        bdap_randombytes((uint8_t *)&n, sizeof(n));
+        n %= sizeof(h) / sizeof(h[0]) + 1;
+        for (j = 0; j < n; ++j)
+        {
+            bdap_randombytes(s, 1);
+            switch (s[0] % 8)
+            {
+            case 0:
+                ed25519_keypair(s, sk);
+                break;
+            case 1:
+                memcpy(s, (s[0] & 8) ? identity : order_2, sizeof(s));
+                break;
+            default:
+                do
+                {
+                    bdap_randombytes(s, sizeof(s));
+                } while (ge_frombytes(&h[j], s) != 0);
+                break;
+            }
+            result = result && (ge_frombytes(&h[j], s) == 0);
+        }
+
+        ge_are_on_main_subgroup(batch, h, n);
+        for (j = 0; result && j < n; ++j)
+        {
+            result = (ge_is_on_main_subgroup(&h[j]) ==
+                      ge_is_on_main_subgroup_mul_l(&h[j])) &&
+                (batch[j] == ge_is_on_main_subgroup_mul_l(&h[j]));
+        }
+    }
+
+    return result;
+}
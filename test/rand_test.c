@@ -0,0 +1,137 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#include "os_rand.h"
+#include "thread_rand.h"
+
+#define NUM_THREADS     4
+#define OUTPUT_SIZE     64
+
+typedef void (*randombytes_fn)(uint8_t *buf, size_t buf_size);
+
+static uint8_t outputs[NUM_THREADS + 1][OUTPUT_SIZE];
+static randombytes_fn generator;
+
+#if !defined(_WIN32)
+static void *rand_job(void *arg)
+{
+    generator((uint8_t *)arg, OUTPUT_SIZE);
+    return NULL;
+}
+#endif
+
+static bool all_distinct(uint8_t (*blocks)[OUTPUT_SIZE], int32_t count)
+{
+    int32_t i, j;
+
+    for (i = 0; i < count; ++i)
+    {
+        for (j = i + 1; j < count; ++j)
+        {
+            if (memcmp(blocks[i], blocks[j], OUTPUT_SIZE) == 0)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Each thread, and a child process after a fork, must get a stream
+ * of its own.
+ */
+static bool distinct_streams_test(randombytes_fn fn)
+{
+    int32_t i;
+    bool result = true;
+#if !defined(_WIN32)
+    pthread_t threads[NUM_THREADS];
+    int fds[2];
+    pid_t pid;
+    uint8_t child_output[OUTPUT_SIZE];
+#endif
+
+    generator = fn;
+#if !defined(_WIN32)
+    for (i = 0; i < NUM_THREADS; ++i)
+    {
+        if (pthread_create(&threads[i], NULL, rand_job, outputs[i]) != 0)
+        {
+            return false;
+        }
+    }
+    generator(outputs[NUM_THREADS], OUTPUT_SIZE);
+    for (i = 0; i < NUM_THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    result = all_distinct(outputs, NUM_THREADS + 1);
+
+    /* The parent and the child continue from the same state */
+    if (result && pipe(fds) == 0)
+    {
+        pid = fork();
+        if (pid == 0)
+        {
+            generator(child_output, OUTPUT_SIZE);
+            _exit(write(fds[1], child_output, OUTPUT_SIZE) == OUTPUT_SIZE ? 0 : 1);
+        }
+        generator(outputs[0], OUTPUT_SIZE);
+        result = (pid > 0) &&
+            (read(fds[0], outputs[1], OUTPUT_SIZE) == OUTPUT_SIZE) &&
+            all_distinct(outputs, 2);
+        if (pid > 0)
+        {
+            waitpid(pid, NULL, 0);
+        }
+        close(fds[0]);
+        close(fds[1]);
+    }
+#else
+    for (i = 0; i <= NUM_THREADS; ++i)
+    {
+        generator(outputs[i], OUTPUT_SIZE);
+    }
+    result = all_distinct(outputs, NUM_THREADS + 1);
+#endif
+
+    return result;
+}
+
+bool thread_rand_test()
+{
+    return distinct_streams_test(thread_randombytes);
+}
+
+/**
+ * Requests are shorter than the pool os_randombytes() buffers when the
+ * kernel has no vgetrandom().
+ */
+bool os_rand_test()
+{
+    return distinct_streams_test(os_randombytes);
+}
+
+/**
+ * As os_rand_test() with the getrandom pool forced, which covers the
+ * pool wipe in the child of a fork() on kernels with vgetrandom().
+ */
+bool os_rand_fallback_test()
+{
+    bool result;
+
+    os_rand_disable_vgetrandom(true);
+    result = distinct_streams_test(os_randombytes);
+    os_rand_disable_vgetrandom(false);
+
+    return result;
+}
@@ -0,0 +1,211 @@
+// Copyright (c) 2018-2019 Duality Blockchain Solutions Developers
+// See LICENSE.md file for license, copying and use information.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include "cpu_features.h"
+#include "rand.h"
+#include "sha512.h"
+#include "utils.h"
+
+typedef struct
+{
+    const char *msg;
+    int32_t repeat;
+    const char *out_hex;
+} sha512_test_vector;
+
+/* FIPS 180-2 examples, and the longest one and two block paddings */
+static sha512_test_vector kat_vectors[] =
+{
+    {
+        "",
+        1,
+        "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+        "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e"
+    },
+    {
+        "abc",
+        1,
+        "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+        "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"
+    },
+    {
+        "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+        "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+        1,
+        "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+        "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909"
+    },
+    {
+        "a",
+        111,
+        "fa9121c7b32b9e01733d034cfc78cbf67f926c7ed83e82200ef8681819692176"
+        "0b4beff48404df811b953828274461673c68d04e297b0eb7b2b4d60fc6b566a2"
+    },
+    {
+        "a",
+        112,
+        "c01d080efd492776a1c43bd23dd99d0a2e626d481e16782e75d54c2503b5dc32"
+        "bd05f0f1ba33e568b88fd2d970929b719ecbb152f58f130a407c8830604b70ca"
+    }
+};
+
+static const uint8_t test_seed[32] =
+{
+    0x2c, 0x9e, 0x51, 0x07, 0xd3, 0x48, 0xa1, 0x6f,
+    0x83, 0x1b, 0xe4, 0x5a, 0x90, 0x37, 0xc2, 0x6d,
+    0x15, 0xf8, 0x4e, 0xb9, 0x62, 0x0c, 0xa7, 0x3d,
+    0xd1, 0x74, 0x2f, 0x98, 0x0b, 0xe6, 0x53, 0xca
+};
+
+/**
+ * The one-shot, streaming and times-4 functions on the known answers,
+ * the latter with and without AVX2.
+ */
+bool sha512_kat_test()
+{
+    uint32_t count, features;
+    int32_t i, j;
+    size_t msg_len;
+    bool result = true;
+    uint8_t msg[256];
+    uint8_t expected[SHA512_DIGEST_SIZE];
+    uint8_t out[4][SHA512_DIGEST_SIZE];
+    const uint8_t *in_ptrs[4];
+    uint8_t *out_ptrs[4];
+    sha512_ctx ctx;
+
+    for (count = 0;
+         result && count < sizeof(kat_vectors) / sizeof(kat_vectors[0]);
+         ++count)
+    {
+        msg_len = 0;
+        for (i = 0; i < kat_vectors[count].repeat; ++i)
+        {
+            memcpy(msg + msg_len, kat_vectors[count].msg,
+                   strlen(kat_vectors[count].msg));
+            msg_len += strlen(kat_vectors[count].msg);
+        }
+        hex_string_to_byte_array(expected, kat_vectors[count].out_hex);
+
+        sha512(out[0], msg, msg_len);
+        result = (memcmp(out[0], expected, SHA512_DIGEST_SIZE) == 0);
+
+        sha512_init(&ctx);
+        for (i = 0; i < (int32_t)msg_len; ++i)
+        {
+            sha512_update(&ctx, msg + i, 1);
+        }
+        sha512_final(&ctx, out[0]);
+        result = result &&
+            (memcmp(out[0], expected, SHA512_DIGEST_SIZE) == 0);
+
+        for (features = 0; features <= CPU_FEATURE_AVX2;
+             features += CPU_FEATURE_AVX2)
+        {
+            cpu_features_disable(features);
+            for (j = 0; j < 4; ++j)
+            {
+                in_ptrs[j] = msg;
+                out_ptrs[j] = out[j];
+            }
+            sha512_x4(out_ptrs, in_ptrs, msg_len);
+            for (j = 0; j < 4; ++j)
+            {
+                result = result &&
+                    (memcmp(out[j], expected, SHA512_DIGEST_SIZE) == 0);
+            }
+        }
+        cpu_features_disable(0);
+    }
+
+    return result;
+}
+
+/**
+ * Random messages hashed in random chunks must match OpenSSL.
+ */
+bool sha512_streaming_random_test(int32_t iterations)
+{
+    int32_t it;
+    size_t msg_len, offset, chunk;
+    bool result = true;
+    uint8_t msg[1024];
+    uint8_t out[SHA512_DIGEST_SIZE];
+    uint8_t expected[SHA512_DIGEST_SIZE];
+    sha512_ctx ctx;
+
+    bdap_randominit(test_seed, sizeof(test_seed));
+    for (it = 0; result && it < iterations; ++it)
+    {
+        bdap_randombytes((uint8_t *)&msg_len, sizeof(msg_len));
+        msg_len %= sizeof(msg) + 1;
+        bdap_randombytes(msg, msg_len);
+
+        sha512_init(&ctx);
+        for (offset = 0; offset < msg_len; offset += chunk)
+        {
+            bdap_randombytes((uint8_t *)&chunk, sizeof(chunk));
+            chunk %= 2 * SHA512_BLOCK_SIZE + 1;
+            if (chunk > msg_len - offset)
+            {
+                chunk = msg_len - offset;
+            }
+            sha512_update(&ctx, msg + offset, chunk);
+        }
+        sha512_final(&ctx, out);
+
+        if (1 != EVP_Digest(msg, msg_len, expected, NULL, EVP_sha512(), NULL))
+        {
+            result = false;
+            break;
+        }
+        result = (memcmp(out, expected, SHA512_DIGEST_SIZE) == 0);
+        sha512(out, msg, msg_len);
+        result = result && (memcmp(out, expected, SHA512_DIGEST_SIZE) == 0);
+    }
+
+    return result;
+}
+
+bool sha512_x4_random_test(int32_t iterations)
+{
+    int32_t it;
+    uint32_t j;
+    size_t msg_len;
+    bool result = true;
+    uint8_t msg[4][512];
+    uint8_t out[4][SHA512_DIGEST_SIZE];
+    uint8_t expected[SHA512_DIGEST_SIZE];
+    const uint8_t *in_ptrs[4];
+    uint8_t *out_ptrs[4];
+
+    bdap_randominit(test_seed, sizeof(test_seed));
+    for (it = 0; result && it < iterations; ++it)
+    {
+        /* Alternate between the AVX2 and the scalar compressions */
+        cpu_features_disable((it & 1) ? CPU_FEATURE_AVX2 : 0);
+
+        bdap_randombytes((uint8_t *)&msg_len, sizeof(msg_len));
+        msg_len %= sizeof(msg[0]) + 1;
+        for (j = 0; j < 4; ++j)
+        {
+            bdap_randombytes(msg[j], msg_len);
+            in_ptrs[j] = msg[j];
+            out_ptrs[j] = out[j];
+        }
+
+        sha512_x4(out_ptrs, in_ptrs, msg_len);
+        for (j = 0; result && j < 4; ++j)
+        {
+            sha512(expected, msg[j], msg_len);
+            result = (memcmp(out[j], expected, SHA512_DIGEST_SIZE) == 0);
+        }
+    }
+    cpu_features_disable(0);
+
+    return result;
+}
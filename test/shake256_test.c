@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include "cpu_features.h"
+#include "rand.h"
+#include "shake256.h"
 #include "shake256_rand.h"
 #include "utils.h"
 
@@ -36,11 +39,11 @@ static shake256random_test_vector test_vectors[] =
             },
             {
                 4090,
-                "b610af91a6c89313ca5ab7672648141791c9d44e11ff555ef63382206fa4debd5280342a1cd1"
+                "409c4dd5583fe200e47b59a9e60bdddfadd347eac8f9fbc636f47cbf9053b7fe8f20614bf151"
             },
             {
                 8180,
-                "61e4d1b26749f92b2a52ae822548dc32db071a753b34"
+                "8acc7d9e7354b0ed33a08a405a20ec9dc7836e0f1bce"
             }
         }
     },
@@ -49,24 +52,65 @@ static shake256random_test_vector test_vectors[] =
         {
             {
                 4092,
-                "7eca8d20cf6ab905604f6442d9e9050b5872886ddaa72addb78c6e64d571"
+                "7eca8d205924ff227b78969732935f40c0b53bd07486a47a9399e917bd89"
             },
             {
                 783,
-                "3571333acf0b00ab60866da297b717a3",
+                "f8bc6dd2a8b589050dc6ac6da8036a13",
             },
             {
                 8365,
-                "5a3caaf9e5e49783a1d03833f394cbcbaf71c350b22061dada",
+                "baaea008ac5d8d65f2b3e73428ae6ca5fb99583182ccf03622",
             },
             {
                 4513,
-                "5a693b69868c691714dc87e22f353b0d84b3fe23"
+                "2cdd418357e72493c45f5e2e08f52ee7f76cbc00"
             }
         }
     }
 };
 
+typedef struct
+{
+    const char *msg_hex;
+    size_t out_offset;
+    const char *out_hex;
+} shake256_test_vector;
+
+/* FIPS-202 SHAKE-256, the 1600-bit message is the NIST example of
+ * 200 bytes 0xA3, read at the end of a 512-byte output */
+static shake256_test_vector kat_vectors[] =
+{
+    {
+        "",
+        0,
+        "46b9dd2b0ba88d13233b3feb743eeb243fcd52ea62b81b82b50c27646ed5762f"
+    },
+    {
+        "616263",
+        0,
+        "483366601360a8771c6863080cc4114d8db44530f8f1e1ee4f94ea37e78b5739"
+    },
+    {
+        "a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3"
+        "a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3"
+        "a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3"
+        "a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3"
+        "a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3"
+        "a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3a3"
+        "a3a3a3a3a3a3a3a3",
+        480,
+        "6a1a9d7846436e4dca5728b6f760eef0ca92bf0be5615e96959d767197a0beeb"
+    }
+};
+
+static uint8_t test_seed[] = {
+    0x2d, 0x9a, 0x61, 0xc4, 0x07, 0x5e, 0xb3, 0x18,
+    0xe1, 0x4f, 0x92, 0x6c, 0x3b, 0xd0, 0x75, 0xa8,
+    0x5c, 0x13, 0xee, 0x40, 0x87, 0x29, 0xf6, 0xbd,
+    0x0a, 0x64, 0xc8, 0x3f, 0x91, 0x52, 0xda, 0x1e
+};
+
 uint8_t *hex_to_array(const char* hex, size_t *size)
 {
     uint8_t *out = NULL;
@@ -103,7 +147,6 @@ bool shake256_random_test()
          count < (int)(sizeof(test_vectors) / sizeof(shake256random_test_vector));
          count++)
     {
-        result = false;
         ptr = &test_vectors[count];
 
         seed = hex_to_array(ptr->seed_hex, &size);
@@ -111,7 +154,7 @@ bool shake256_random_test()
         free(seed);
         bytes_generated = 0;
 
-        for (index=0; index<SIZE_PER_VECTOR; index++)
+        for (index=0; result && index<SIZE_PER_VECTOR; index++)
         {
             offset = ptr->values[index].offset;
             buffer = hex_to_array(ptr->values[index].xof_hex, &size);
@@ -134,5 +177,157 @@ bool shake256_random_test()
         }
     }
 
-    return true;
+    return result;
+}
+
+bool shake256_kat_test()
+{
+    uint32_t count;
+    size_t msg_len, out_len, i, n;
+    bool result = true;
+    uint8_t *msg = NULL;
+    uint8_t *expected = NULL;
+    uint8_t out[512];
+    uint8_t incremental[512];
+    shake256_ctx ctx;
+    const shake256_test_vector *ptr;
+
+    for (count = 0;
+         result && count < sizeof(kat_vectors) / sizeof(kat_vectors[0]);
+         count++)
+    {
+        ptr = &kat_vectors[count];
+        msg_len = strlen(ptr->msg_hex) / 2;
+        msg = calloc(msg_len + 1, sizeof(uint8_t));
+        expected = hex_to_array(ptr->out_hex, &out_len);
+        if (msg == NULL || expected == NULL)
+        {
+            result = false;
+            goto bail_kat_test;
+        }
+        hex_string_to_byte_array(msg, ptr->msg_hex);
+
+        /* One-shot */
+        shake256(out, ptr->out_offset + out_len, msg, msg_len);
+        result = (memcmp(out + ptr->out_offset, expected, out_len) == 0);
+
+        /* Byte-wise absorb, squeeze in pieces of growing size */
+        shake256_init(&ctx);
+        for (i = 0; i < msg_len; ++i)
+        {
+            shake256_absorb(&ctx, msg + i, 1);
+        }
+        shake256_finalize(&ctx);
+        for (i = 0, n = 1; i < ptr->out_offset + out_len; i += n, ++n)
+        {
+            if (n > ptr->out_offset + out_len - i)
+            {
+                n = ptr->out_offset + out_len - i;
+            }
+            shake256_squeeze(&ctx, incremental + i, n);
+        }
+        result = result &&
+            (memcmp(incremental + ptr->out_offset, expected, out_len) == 0);
+
+bail_kat_test:
+        free(msg);
+        free(expected);
+    }
+
+    return result;
+}
+
+bool shake256_streaming_random_test(int32_t iterations)
+{
+    int32_t it;
+    size_t msg_len, out_len, pos, n;
+    bool result = true;
+    uint8_t msg[1024];
+    uint8_t out[1024];
+    uint8_t incremental[1024];
+    shake256_ctx ctx;
+
+    bdap_randominit(test_seed, sizeof(test_seed));
+    for (it = 0; result && it < iterations; ++it)
+    {
+        bdap_randombytes((uint8_t *)&msg_len, sizeof(msg_len));
+        bdap_randombytes((uint8_t *)&out_len, sizeof(out_len));
+        msg_len %= sizeof(msg);
+        out_len = 1 + out_len % sizeof(out);
+        bdap_randombytes(msg, msg_len);
+
+        shake256(out, out_len, msg, msg_len);
+
+        /* Absorb and squeeze in chunks of random sizes */
+        shake256_init(&ctx);
+        for (pos = 0; pos < msg_len; pos += n)
+        {
+            bdap_randombytes((uint8_t *)&n, sizeof(n));
+            n %= 2 * SHAKE256_RATE;
+            if (n > msg_len - pos)
+            {
+                n = msg_len - pos;
+            }
+            shake256_absorb(&ctx, msg + pos, n);
+        }
+        for (pos = 0; pos < out_len; pos += n)
+        {
+            bdap_randombytes((uint8_t *)&n, sizeof(n));
+            n %= 2 * SHAKE256_RATE;
+            if (n > out_len - pos)
+            {
+                n = out_len - pos;
+            }
+            shake256_squeeze(&ctx, incremental + pos, n);
+        }
+
+        result = (memcmp(out, incremental, out_len) == 0);
+    }
+
+    return result;
+}
+
+bool shake256_x4_random_test(int32_t iterations)
+{
+    int32_t it;
+    uint32_t j;
+    size_t msg_len, out_len;
+    bool result = true;
+    uint8_t msg[4][512];
+    uint8_t out[4][512];
+    uint8_t expected[512];
+    const uint8_t *in_ptrs[4];
+    uint8_t *out_ptrs[4];
+
+    bdap_randominit(test_seed, sizeof(test_seed));
+    for (it = 0; result && it < iterations; ++it)
+    {
+        /* Alternate between the AVX2 and the scalar permutations */
+        cpu_features_disable((it & 1) ? CPU_FEATURE_AVX2 : 0);
+
+        bdap_randombytes((uint8_t *)&msg_len, sizeof(msg_len));
+        bdap_randombytes((uint8_t *)&out_len, sizeof(out_len));
+        msg_len %= sizeof(msg[0]);
+        out_len = 1 + out_len % sizeof(out[0]);
+        for (j = 0; j < 4; ++j)
+        {
+            bdap_randombytes(msg[j], msg_len);
+            in_ptrs[j] = msg[j];
+            out_ptrs[j] = out[j];
+        }
+
+        if (0 != shake256_x4(out_ptrs, out_len, in_ptrs, msg_len))
+        {
+            result = false;
+            break;
+        }
+        for (j = 0; result && j < 4; ++j)
+        {
+            shake256(expected, out_len, msg[j], msg_len);
+            result = (memcmp(out[j], expected, out_len) == 0);
+        }
+    }
+    cpu_features_disable(0);
+
+    return result;
 }
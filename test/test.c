@@ -27,18 +27,42 @@
 		printf("PASS\n"); fflush(stdout); \
 	}
 
+extern bool os_rand_test();
+extern bool os_rand_fallback_test();
+extern bool thread_rand_test();
 extern bool shake256_random_test();
+extern bool shake256_kat_test();
+extern bool shake256_streaming_random_test(int iterations);
+extern bool shake256_x4_random_test(int iterations);
+extern bool sha512_kat_test();
+extern bool sha512_streaming_random_test(int iterations);
+extern bool sha512_x4_random_test(int iterations);
 extern bool nist_aes_test_vector();
 extern bool random_aes_test_vectors(int iterations);
+extern bool random_aes_multi_block_test(int iterations);
 extern bool aes256ctr_nist_positive_test();
 extern bool aes256ctr_random_test(int iterations);
 extern bool openssl_aes256ctr_random_test(int iterations);
+extern bool openssl_aes256ctr_seek_test(int iterations);
+extern bool aes256ctr_multi_key_random_test(int iterations);
 extern bool aes256gcm_nist_positive_test();
 extern bool openssl_aes256gcm_nist_positive_test();
+extern bool openssl_aes256gcm_random_test(int iterations);
+extern bool aes256gcm_streaming_random_test(int iterations);
+extern bool aes256gcm_parallel_random_test(int iterations);
 extern bool curve25519_random_keypair_test();
+extern bool curve25519_dh_x4_random_test(int iterations);
+extern bool curve25519_public_key_random_test(int iterations);
 extern bool bdap_random_test();
+extern bool bdap_recipient_groups_test();
+extern bool bdap_single_pass_decrypt_test();
+extern bool bdap_parallel_test();
+extern bool bdap_rng_provider_test();
 extern bool ed25519_to_curve25519_conversion_test();
 extern bool ed25519_to_curve25519_random_conversion_test(int iterations);
+extern bool ed25519_to_curve25519_batch_random_test(int iterations);
+extern bool fe_inv_test(int iterations);
+extern bool ge_subgroup_random_test(int iterations);
 
 int main(int argc, char *argv[]) 
 {
@@ -48,17 +72,47 @@ int main(int argc, char *argv[])
         num_iterations = atoi(argv[1]);
     }
 
+    DO_TEST("OS random generator test: ",
+        os_rand_test());
+
+    DO_TEST("OS random generator getrandom fallback test: ",
+        os_rand_fallback_test());
+
+    DO_TEST("Thread-local random generator test: ",
+        thread_rand_test());
+
     use_shake256_rand();
 
     DO_TEST("SHAKE256 random test vectors: ",
         shake256_random_test());
 
+    DO_TEST("SHAKE256 known answer test: ",
+        shake256_kat_test());
+
+    DO_ITER_TEST("SHAKE256 streaming random test (%d iterations): ",
+        num_iterations, shake256_streaming_random_test(num_iterations));
+
+    DO_ITER_TEST("SHAKE256 times-4 random test (%d iterations): ",
+        num_iterations, shake256_x4_random_test(num_iterations));
+
+    DO_TEST("SHA512 known answer test: ",
+        sha512_kat_test());
+
+    DO_ITER_TEST("SHA512 streaming random test (%d iterations): ",
+        num_iterations, sha512_streaming_random_test(num_iterations));
+
+    DO_ITER_TEST("SHA512 times-4 random test (%d iterations): ",
+        num_iterations, sha512_x4_random_test(num_iterations));
+
     DO_TEST("NIST AES test vectors: ",
         nist_aes_test_vector());
 
     DO_ITER_TEST("Random AES test (%d iterations): ",
         num_iterations, random_aes_test_vectors(num_iterations));
 
+    DO_ITER_TEST("Random AES multi-block test (%d iterations): ",
+        num_iterations, random_aes_multi_block_test(num_iterations));
+
     DO_TEST("AES256-CTR NIST positive test: ",
         aes256ctr_nist_positive_test());
 
@@ -68,23 +122,65 @@ int main(int argc, char *argv[])
     DO_ITER_TEST("OpenSSL random AES256-CTR test (%d iterations): ",
         num_iterations, openssl_aes256ctr_random_test(num_iterations));
 
+    DO_ITER_TEST("OpenSSL AES256-CTR seek test (%d iterations): ",
+        num_iterations, openssl_aes256ctr_seek_test(num_iterations));
+
+    DO_ITER_TEST("Multi-key AES256-CTR random test (%d iterations): ",
+        num_iterations, aes256ctr_multi_key_random_test(num_iterations));
+
     DO_TEST("AES256-GCM NIST positive test: ",
         aes256gcm_nist_positive_test());
 
     DO_TEST("OpenSSL AES256-GCM NIST positive test: ",
         openssl_aes256gcm_nist_positive_test());
 
+    DO_ITER_TEST("OpenSSL random AES256-GCM test (%d iterations): ",
+        num_iterations, openssl_aes256gcm_random_test(num_iterations));
+
+    DO_ITER_TEST("Streaming AES256-GCM random test (%d iterations): ",
+        num_iterations, aes256gcm_streaming_random_test(num_iterations));
+
+    DO_ITER_TEST("Parallel AES256-GCM random test (%d iterations): ",
+        num_iterations, aes256gcm_parallel_random_test(num_iterations));
+
     DO_TEST("Curve25519 random keypair test: ",
         curve25519_random_keypair_test());
 
+    DO_ITER_TEST("Curve25519 times-4 DH random test (%d iterations): ",
+        num_iterations, curve25519_dh_x4_random_test(num_iterations));
+
+    DO_ITER_TEST("Curve25519 fixed-base public-key random test (%d iterations): ",
+        num_iterations, curve25519_public_key_random_test(num_iterations));
+
     DO_TEST("Ed25519 to Curve25519 conversion test: ",
         ed25519_to_curve25519_conversion_test());
 
     DO_ITER_TEST("Ed25519 to Curve25519 random conversion test (%d iterations): ",
         num_iterations, ed25519_to_curve25519_random_conversion_test(num_iterations));
 
+    DO_ITER_TEST("Ed25519 to Curve25519 batch conversion test (%d iterations): ",
+        num_iterations, ed25519_to_curve25519_batch_random_test(num_iterations));
+
+    DO_ITER_TEST("Field inversion safegcd and Fermat test (%d iterations): ",
+        num_iterations, fe_inv_test(num_iterations));
+
+    DO_ITER_TEST("Subgroup membership random test (%d iterations): ",
+        num_iterations, ge_subgroup_random_test(num_iterations));
+
     DO_TEST("BDAP E2E random test: ",
         bdap_random_test());
 
+    DO_TEST("BDAP recipient groups test: ",
+        bdap_recipient_groups_test());
+
+    DO_TEST("BDAP single-pass decrypt test: ",
+        bdap_single_pass_decrypt_test());
+
+    DO_TEST("BDAP parallel encrypt and decrypt test: ",
+        bdap_parallel_test());
+
+    DO_TEST("BDAP RNG provider test: ",
+        bdap_rng_provider_test());
+
     return 0;
 }